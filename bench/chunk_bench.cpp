@@ -0,0 +1,520 @@
+// Chunk path benchmark: runs file chunks through the ring and buffer
+// lending FileSender uses to build FileChunk messages, and takes them apart
+// the way StartTransferReactor does, once as it's done now and once as it
+// used to be. Counts payload bytes copied per byte moved, reading the file
+// included, and heap allocations per GB.
+//
+// Usage: chunk_bench [--size MB] [--level N]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/proto-gen/warp.pb.h"
+#include "../src/service/chunk_ring.cpp"
+#include "../src/service/receive_queue.cpp"
+#include "../src/service/zlib_deflate.cpp"
+
+using namespace srv;
+
+// Only this program counts its allocations, zlib's own mallocs
+// are left out. They happen once, when the streams are set up.
+static std::atomic<long long> g_allocations( 0 );
+
+// Payload bytes that ended up in another buffer on their way
+static std::atomic<long long> g_copiedBytes( 0 );
+
+void* operator new( size_t size )
+{
+    g_allocations++;
+
+    if ( void* ptr = std::malloc( size ? size : 1 ) )
+    {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete( void* ptr ) noexcept
+{
+    std::free( ptr );
+}
+
+void operator delete( void* ptr, size_t ) noexcept
+{
+    std::free( ptr );
+}
+
+namespace
+{
+
+const size_t CHUNK_SIZE = 1024 * 1024;
+const size_t FILE_SIZE = 5 * CHUNK_SIZE + 300 * 1024; // Ends with a tail
+const int QUEUE_DEPTH = 8;
+const int COMPRESS_THREADS = 2;
+const double GIGABYTE = 1024.0 * 1024.0 * 1024.0;
+
+struct Options
+{
+    size_t size;
+    int level;
+};
+
+struct Result
+{
+    double megabytesPerSecond;
+    double copiedPerByte;
+    double allocationsPerGB;
+};
+
+std::string generateData( size_t size )
+{
+    // Text with some repetition, compresses about like documents do
+    std::mt19937 eng( 1 );
+    const char* words[] = { "transfer ", "chunk ", "remote ", "stream ",
+        "file ", "the ", "of ", "and ", "a ", "warp\n" };
+
+    std::string data;
+    data.reserve( size );
+
+    while ( data.size() < size )
+    {
+        data += words[eng() % 10];
+    }
+
+    data.resize( size );
+    return data;
+}
+
+// A hand-off copied the payload unless it's still where it was
+void countCopy( const char* before, const std::string& after )
+{
+    if ( after.data() != before )
+    {
+        g_copiedBytes += after.size();
+    }
+}
+
+// What the sender puts on the wire, serialized like gRPC would
+std::vector<std::string> buildWire( const std::string& data, int level )
+{
+    ZlibDeflate compressor;
+    FileChunk chunk;
+    std::vector<std::string> wire;
+
+    chunk.set_relative_path( "Documents/report.txt" );
+    chunk.set_file_type( 1 );
+    chunk.set_file_mode( 0644 );
+
+    for ( size_t pos = 0; pos < data.size(); pos += CHUNK_SIZE )
+    {
+        size_t length = std::min( CHUNK_SIZE, data.size() - pos );
+
+        if ( level > 0 )
+        {
+            compressor.compress( data.data() + pos, length,
+                *chunk.mutable_chunk(), level );
+        }
+        else
+        {
+            chunk.set_chunk( data.data() + pos, length );
+        }
+
+        wire.push_back( chunk.SerializeAsString() );
+    }
+
+    return wire;
+}
+
+// Stands in for the file, so the data is actually looked at
+uint32_t consume( const std::string& data, uint32_t sum )
+{
+    for ( size_t i = 0; i < data.size(); i += 4096 )
+    {
+        sum = sum * 31 + (uint8_t)data[i];
+    }
+
+    return sum;
+}
+
+// Before: reconstructed from the reactor as it was. Payload and path
+// were copied out of the message on every chunk, and inflated into
+// a new string that was shrunk to fit afterwards.
+class LegacyReceiver
+{
+public:
+    uint32_t receive( const std::vector<std::string>& wire, bool compressed )
+    {
+        uint32_t sum = 0;
+
+        for ( const std::string& bytes : wire )
+        {
+            m_message.ParseFromString( bytes );
+
+            std::string original = m_message.chunk();
+            std::string relativePath = m_message.relative_path();
+            countCopy( m_message.chunk().data(), original );
+
+            if ( compressed )
+            {
+                std::string data = m_decompressor.decompress( original );
+                sum = consume( data, sum );
+            }
+            else
+            {
+                sum = consume( original, sum );
+            }
+
+            sum += (uint32_t)relativePath.size();
+        }
+
+        return sum;
+    }
+
+private:
+    FileChunk m_message;
+    ZlibDeflate m_decompressor;
+};
+
+// Now: the reactor's own ReceiveQueue and ChunkInflater. Messages are
+// parsed into a reused one, change hands through the queue by swapping,
+// and inflating reuses one output buffer.
+class CurrentReceiver
+{
+public:
+    CurrentReceiver()
+        : m_inflateOk( false )
+        , m_published( QUEUE_DEPTH )
+        , m_publishCount( 0 )
+        , m_takeCount( 0 )
+    {
+        m_queue.reset( QUEUE_DEPTH );
+    }
+
+    uint32_t receive( const std::vector<std::string>& wire, bool compressed )
+    {
+        uint32_t sum = 0;
+
+        for ( const std::string& bytes : wire )
+        {
+            m_message.ParseFromString( bytes );
+
+            // The writer falls behind by a full queue, like on a slow disk
+            if ( m_queue.isFull() )
+            {
+                sum = write( compressed, sum );
+            }
+
+            m_published[m_publishCount++ % m_published.size()]
+                = m_message.chunk().data();
+            m_queue.publish( m_message, true );
+        }
+
+        while ( !m_queue.isEmpty() )
+        {
+            sum = write( compressed, sum );
+        }
+
+        return sum;
+    }
+
+private:
+    ReceiveQueue m_queue;
+    ChunkInflater m_inflater;
+    FileChunk m_message;
+    FileChunk m_current;
+    std::string m_inflated;
+    bool m_inflateOk;
+
+    // Where payloads were parsed to, in the order they were published
+    std::vector<const char*> m_published;
+    size_t m_publishCount;
+    size_t m_takeCount;
+
+    uint32_t write( bool compressed, uint32_t sum )
+    {
+        m_queue.take( m_current, m_inflated, m_inflateOk );
+        countCopy( m_published[m_takeCount++ % m_published.size()],
+            m_current.chunk() );
+
+        if ( compressed )
+        {
+            m_inflater.inflate( m_current, m_inflated );
+            return consume( m_inflated, sum );
+        }
+
+        return consume( m_current.chunk(), sum );
+    }
+};
+
+// Runs chunks of the data through the real ChunkRing the way FileSender
+// does. A reader thread fills slots as if from disk, compressor threads
+// deflate them when a level is set, and the calling thread writes them.
+template <typename Compress, typename Write>
+void runRing( const std::string& data, int level, Compress compress,
+    Write write )
+{
+    ChunkRing ring( QUEUE_DEPTH, CHUNK_SIZE, level > 0 );
+
+    std::thread reader( [&]()
+        {
+            for ( size_t file = 0; file < data.size(); file += FILE_SIZE )
+            {
+                size_t fileEnd = std::min( file + FILE_SIZE, data.size() );
+
+                for ( size_t pos = file; pos < fileEnd; pos += CHUNK_SIZE )
+                {
+                    ChunkSlot* slot = ring.acquireFree();
+                    if ( !slot )
+                    {
+                        return;
+                    }
+
+                    // Stands in for reading the file, a copy either way
+                    size_t readCount = std::min( CHUNK_SIZE, fileEnd - pos );
+                    std::memcpy( &slot->data[0], data.data() + pos, readCount );
+                    g_copiedBytes += readCount;
+
+                    slot->kind = ChunkSlot::Kind::FILE_DATA;
+                    slot->length = readCount;
+                    slot->firstChunk = pos == file;
+                    slot->lastChunk = pos + readCount == fileEnd;
+                    ring.publish( slot );
+                }
+            }
+
+            ring.close();
+        } );
+
+    std::vector<std::thread> compressors;
+    for ( int i = 0; level > 0 && i < COMPRESS_THREADS; i++ )
+    {
+        compressors.emplace_back( [&]()
+            {
+                ZlibDeflate compressor;
+                ChunkSlot* slot;
+
+                while ( ( slot = ring.acquireForProcessing() ) != nullptr )
+                {
+                    compress( compressor, *slot );
+                    ring.markProcessed( slot );
+                }
+            } );
+    }
+
+    ChunkSlot* slot;
+    while ( ( slot = ring.acquireFilled() ) != nullptr )
+    {
+        write( *slot );
+        ring.release( slot );
+    }
+
+    reader.join();
+    for ( std::thread& compressor : compressors )
+    {
+        compressor.join();
+    }
+}
+
+// Before: reconstructed from FileSender as it was. Slots were copied
+// into a string to be deflated, the output got shrunk to fit, and
+// the payload was copied into the message along with the path.
+class LegacySender
+{
+public:
+    void send( const std::string& data, int level )
+    {
+        runRing( data, level,
+            [level]( ZlibDeflate& compressor, ChunkSlot& slot )
+            {
+                std::string input( slot.data.data(), slot.length );
+                countCopy( slot.data.data(), input );
+
+                slot.compressed = compressor.compress( input, level );
+
+                // deflateBound always leaves room, so a fitted buffer
+                // is one shrink_to_fit copied the output into
+                if ( slot.compressed.capacity() == slot.compressed.size() )
+                {
+                    g_copiedBytes += slot.compressed.size();
+                }
+            },
+            [this, level]( ChunkSlot& slot )
+            {
+                m_chunk.set_relative_path( "Documents/report.txt" );
+
+                if ( level > 0 )
+                {
+                    m_chunk.set_chunk( slot.compressed );
+                    countCopy( slot.compressed.data(), m_chunk.chunk() );
+                }
+                else
+                {
+                    m_chunk.set_chunk( slot.data.data(), slot.length );
+                    countCopy( slot.data.data(), m_chunk.chunk() );
+                }
+
+                m_chunk.SerializeToString( &m_wire );
+            } );
+    }
+
+private:
+    FileChunk m_chunk;
+    std::string m_wire;
+};
+
+// Now: the same code FileSender runs. Slots are deflated into their own
+// output buffers, which lendPayload hands to a reused message.
+class CurrentSender
+{
+public:
+    void send( const std::string& data, int level )
+    {
+        runRing( data, level,
+            [level]( ZlibDeflate& compressor, ChunkSlot& slot )
+            {
+                compressor.compress( slot.getPayload(), slot.length,
+                    slot.compressed, level );
+            },
+            [this, level]( ChunkSlot& slot )
+            {
+                if ( slot.firstChunk )
+                {
+                    m_chunk.set_relative_path( "Documents/report.txt" );
+                }
+
+                const char* before = level > 0 ? slot.compressed.data()
+                                               : slot.getPayload();
+                std::string* lentBuffer = slot.lendPayload( level > 0,
+                    *m_chunk.mutable_chunk() );
+                countCopy( before, m_chunk.chunk() );
+
+                m_chunk.SerializeToString( &m_wire );
+                slot.reclaimPayload( lentBuffer, *m_chunk.mutable_chunk() );
+            } );
+    }
+
+private:
+    FileChunk m_chunk;
+    std::string m_wire;
+};
+
+template <typename Func>
+Result measure( size_t bytes, Func func )
+{
+    // The first pass warms buffers up, like the start of a long transfer
+    func();
+
+    long long allocations = g_allocations;
+    long long copied = g_copiedBytes;
+    auto start = std::chrono::steady_clock::now();
+    func();
+    std::chrono::duration<double> elapsed
+        = std::chrono::steady_clock::now() - start;
+    allocations = g_allocations - allocations;
+    copied = g_copiedBytes - copied;
+
+    Result result;
+    result.megabytesPerSecond = bytes / ( 1024.0 * 1024.0 )
+        / std::max( elapsed.count(), 1e-9 );
+    result.copiedPerByte = (double)copied / bytes;
+    result.allocationsPerGB = allocations * GIGABYTE / bytes;
+
+    return result;
+}
+
+void printResult( const char* path, const char* name, const Result& result )
+{
+    std::printf( "%-8s %-8s %10.1f MB/s %8.3f copied/B %12.0f allocations/GB\n",
+        path, name, result.megabytesPerSecond, result.copiedPerByte,
+        result.allocationsPerGB );
+}
+
+bool parseOptions( int argc, char** argv, Options& options )
+{
+    options.size = 256 * 1024 * 1024;
+    options.level = 6;
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if ( !value )
+        {
+            return false;
+        }
+
+        if ( arg == "--size" )
+        {
+            options.size = (size_t)std::max( std::atoi( value ), 1 )
+                * 1024 * 1024;
+        }
+        else if ( arg == "--level" )
+        {
+            options.level = std::max( std::min( std::atoi( value ), 9 ), 1 );
+        }
+        else
+        {
+            return false;
+        }
+
+        i++;
+    }
+
+    return true;
+}
+
+};
+
+int main( int argc, char** argv )
+{
+    Options options;
+
+    if ( !parseOptions( argc, argv, options ) )
+    {
+        std::cerr << "Usage: chunk_bench [--size MB] [--level N]"
+                  << std::endl;
+        return 2;
+    }
+
+    std::string data = generateData( options.size );
+    std::vector<std::string> rawWire = buildWire( data, 0 );
+    std::vector<std::string> deflatedWire = buildWire( data, options.level );
+    LegacySender legacySender;
+    CurrentSender currentSender;
+    LegacyReceiver legacy;
+    CurrentReceiver current;
+
+    printResult( "send", "before", measure( data.size(), [&]()
+        { legacySender.send( data, 0 ); } ) );
+    printResult( "send", "now", measure( data.size(), [&]()
+        { currentSender.send( data, 0 ); } ) );
+    printResult( "deflate", "before", measure( data.size(), [&]()
+        { legacySender.send( data, options.level ); } ) );
+    printResult( "deflate", "now", measure( data.size(), [&]()
+        { currentSender.send( data, options.level ); } ) );
+
+    printResult( "receive", "before", measure( data.size(), [&]()
+        { legacy.receive( rawWire, false ); } ) );
+    printResult( "receive", "now", measure( data.size(), [&]()
+        { current.receive( rawWire, false ); } ) );
+    printResult( "inflate", "before", measure( data.size(), [&]()
+        { legacy.receive( deflatedWire, true ); } ) );
+    printResult( "inflate", "now", measure( data.size(), [&]()
+        { current.receive( deflatedWire, true ); } ) );
+
+    return 0;
+}
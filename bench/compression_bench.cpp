@@ -0,0 +1,638 @@
+// Compression benchmark: runs every codec path FileSender may pick over
+// generated corpora at each level and chunk size, and writes the numbers
+// as JSON. Used to pick defaults instead of guessing them.
+//
+// Usage: bench [--size MB] [--repeats N] [--levels 1,6,9]
+//              [--output results.json]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/service/zlib_deflate.cpp"
+
+using namespace srv;
+
+// Every operator new of the process. zlib itself allocates with malloc,
+// but only when ZlibDeflate sets its streams up, which happens once.
+static std::atomic<long long> g_allocations( 0 );
+
+void* operator new( size_t size )
+{
+    g_allocations++;
+
+    if ( void* ptr = std::malloc( size ? size : 1 ) )
+    {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete( void* ptr ) noexcept
+{
+    std::free( ptr );
+}
+
+void operator delete( void* ptr, size_t ) noexcept
+{
+    std::free( ptr );
+}
+
+namespace
+{
+
+struct Options
+{
+    size_t corpusSize;
+    int repeats;
+    std::vector<int> levels;
+    std::string output;
+};
+
+struct Corpus
+{
+    std::string name;
+    std::string data;
+};
+
+enum class CodecPath
+{
+    PER_CHUNK, // DeflateFraming::PER_CHUNK, the default
+    STREAMED, // Whole file as one stream, sync flushed per chunk
+    DICTIONARY // Every chunk primed with a preset dictionary
+};
+
+struct Result
+{
+    double compressMBps;
+    double decompressMBps;
+    size_t compressedBytes;
+    double compressAllocsPerChunk;
+    double decompressAllocsPerChunk;
+};
+
+const size_t CHUNK_SIZES[] = { 64 * 1024, 256 * 1024, 1024 * 1024 };
+const CodecPath CODEC_PATHS[]
+    = { CodecPath::PER_CHUNK, CodecPath::STREAMED, CodecPath::DICTIONARY };
+
+// Standard distributions differ between library implementations,
+// raw engine output doesn't. Corpora are the same on every platform.
+uint32_t pick( std::mt19937& eng, uint32_t count )
+{
+    return eng() % count;
+}
+
+std::string generateText( size_t size )
+{
+    std::mt19937 eng( 1 );
+    const char* syllables[] = { "a", "an", "ar", "be", "ca", "de", "di", "el",
+        "en", "er", "fo", "ga", "he", "in", "is", "ka", "la", "li", "ma", "me",
+        "na", "ne", "no", "on", "or", "pa", "ra", "re", "ri", "ro", "sa",
+        "se", "so", "ta", "te", "ti", "to", "un", "ur", "va", "wa", "ya" };
+    const uint32_t syllableCount = sizeof( syllables ) / sizeof( syllables[0] );
+
+    // A few thousand made up words, their order in the list is their rank
+    std::vector<std::string> words;
+    for ( int i = 0; i < 4000; i++ )
+    {
+        std::string word;
+        uint32_t length = 1 + pick( eng, 3 ) + ( i > 200 ? 1 : 0 );
+
+        for ( uint32_t j = 0; j < length; j++ )
+        {
+            word += syllables[pick( eng, syllableCount )];
+        }
+
+        words.push_back( word );
+    }
+
+    const uint32_t wordCount = (uint32_t)words.size();
+
+    std::string text;
+    size_t lineLength = 0;
+    bool sentenceStart = true;
+
+    while ( text.size() < size )
+    {
+        // Skewed towards the first words, like real text
+        std::string word
+            = words[pick( eng, pick( eng, pick( eng, wordCount ) + 1 ) + 1 )];
+
+        if ( sentenceStart )
+        {
+            word[0] = (char)( word[0] - 'a' + 'A' );
+            sentenceStart = false;
+        }
+
+        if ( pick( eng, 12 ) == 0 )
+        {
+            word += ".";
+            sentenceStart = true;
+        }
+        else if ( pick( eng, 10 ) == 0 )
+        {
+            word += ",";
+        }
+
+        if ( lineLength + word.size() > 72 )
+        {
+            text += "\n";
+            lineLength = 0;
+        }
+        else if ( lineLength > 0 )
+        {
+            text += " ";
+            lineLength++;
+        }
+
+        text += word;
+        lineLength += word.size();
+    }
+
+    text.resize( size );
+    return text;
+}
+
+std::string generateSource( size_t size )
+{
+    std::mt19937 eng( 2 );
+    const char* includes[] = { "<memory>", "<string>", "<vector>", "<mutex>",
+        "<map>", "\"utils.hpp\"", "\"event.hpp\"", "\"database_manager.hpp\"" };
+    const char* types[] = { "int", "bool", "std::string", "long long",
+        "std::wstring", "size_t" };
+
+    std::string source;
+
+    while ( source.size() < size )
+    {
+        std::string name;
+        for ( int i = 0; i < 8; i++ )
+        {
+            name += (char)( 'a' + pick( eng, 26 ) );
+        }
+
+        source += "// Copyright (c) The Example Project authors.\n"
+                  "// Licensed under the MIT license, see LICENSE.\n"
+                  "#include \"" + name + ".hpp\"\n\n";
+
+        uint32_t includeCount = 2 + pick( eng, 6 );
+        for ( uint32_t i = 0; i < includeCount; i++ )
+        {
+            source += std::string( "#include " ) + includes[pick( eng, 8 )]
+                + "\n";
+        }
+
+        source += "\nnamespace srv\n{\n\n";
+
+        uint32_t methodCount = 2 + pick( eng, 10 );
+        for ( uint32_t i = 0; i < methodCount; i++ )
+        {
+            std::string type = types[pick( eng, 6 )];
+            std::string member = "m_" + name.substr( 0, 2 + pick( eng, 6 ) );
+
+            source += "void " + name + "::set" + std::to_string( i ) + "( "
+                + type + " value )\n{\n"
+                + "    std::lock_guard<std::mutex> guard( m_mtx );\n\n"
+                + "    " + member + " = value;\n}\n\n"
+                + type + " " + name + "::get" + std::to_string( i )
+                + "()\n{\n    std::lock_guard<std::mutex> guard( m_mtx );\n\n"
+                + "    return " + member + ";\n}\n\n";
+        }
+
+        source += "};\n";
+    }
+
+    source.resize( size );
+    return source;
+}
+
+std::string generateMedia( size_t size, const std::string& text )
+{
+    // Stands in for JPEG, video and archives: deflated data is about
+    // as incompressible as they are, and not simply random
+    ZlibDeflate compressor;
+    std::string media;
+    std::string block;
+
+    for ( size_t pos = 0; media.size() < size; pos += 256 * 1024 )
+    {
+        compressor.compress( text.data() + pos % text.size(),
+            std::min( (size_t)256 * 1024, text.size() - pos % text.size() ),
+            block, 9 );
+        media += block;
+    }
+
+    media.resize( size );
+    return media;
+}
+
+std::string generateRandom( size_t size )
+{
+    std::mt19937 eng( 4 );
+    std::string data( size, '\0' );
+
+    for ( char& ch : data )
+    {
+        ch = (char)( eng() & 0xFF );
+    }
+
+    return data;
+}
+
+std::string generateSparse( size_t size )
+{
+    // Disk images and preallocated databases: mostly holes, with an
+    // occasional block of data
+    std::mt19937 eng( 5 );
+    std::string data( size, '\0' );
+
+    for ( size_t block = 0; block + 4096 <= size; block += 64 * 1024 )
+    {
+        if ( pick( eng, 16 ) != 0 )
+        {
+            continue;
+        }
+
+        for ( size_t i = 0; i < 4096; i++ )
+        {
+            data[block + i] = (char)( eng() & 0xFF );
+        }
+    }
+
+    return data;
+}
+
+std::vector<Corpus> generateCorpora( size_t size )
+{
+    std::vector<Corpus> corpora;
+
+    corpora.push_back( { "text", generateText( size ) } );
+    corpora.push_back( { "source", generateSource( size ) } );
+    corpora.push_back( { "media", generateMedia( size, corpora[0].data ) } );
+    corpora.push_back( { "random", generateRandom( size ) } );
+    corpora.push_back( { "sparse", generateSparse( size ) } );
+
+    return corpora;
+}
+
+const char* getPathName( CodecPath path )
+{
+    switch ( path )
+    {
+    case CodecPath::PER_CHUNK:
+        return "zlib-chunk";
+    case CodecPath::STREAMED:
+        return "zlib-stream";
+    case CodecPath::DICTIONARY:
+        return "zlib-dictionary";
+    }
+
+    return "";
+}
+
+std::string buildDictionary( const std::string& data )
+{
+    // Same sampling as FileSender: the first 4 kB of up to 64 files
+    std::vector<std::string> samples;
+
+    for ( size_t pos = 0; pos < data.size() && samples.size() < 64;
+          pos += 64 * 1024 )
+    {
+        samples.push_back( data.substr( pos, 4096 ) );
+    }
+
+    return ZlibDeflate::buildDictionary( samples );
+}
+
+class CodecRun
+{
+public:
+    CodecRun( const std::string& data, CodecPath path, int level,
+        size_t chunkSize, const std::string& dictionary )
+        : m_data( data )
+        , m_path( path )
+        , m_level( level )
+        , m_chunkSize( chunkSize )
+        , m_chunkCount( ( data.size() + chunkSize - 1 ) / chunkSize )
+        , m_compressed( m_chunkCount )
+    {
+        if ( path == CodecPath::DICTIONARY )
+        {
+            m_compressor.setDictionary( dictionary );
+            m_decompressor.setDictionary( dictionary );
+        }
+    }
+
+    // Untimed pass, sets the streams up and checks the round trip
+    bool verify()
+    {
+        compressAll();
+
+        std::string restored;
+        bool ok = decompressAll( &restored );
+
+        return ok && restored == m_data;
+    }
+
+    Result measure( int repeats )
+    {
+        Result result;
+        double compressSeconds = 0;
+        double decompressSeconds = 0;
+        long long compressAllocs = 0;
+        long long decompressAllocs = 0;
+
+        for ( int i = 0; i < repeats; i++ )
+        {
+            long long allocations = g_allocations;
+            double seconds = timed( [this]() { compressAll(); } );
+            allocations = g_allocations - allocations;
+
+            if ( i == 0 || seconds < compressSeconds )
+            {
+                compressSeconds = seconds;
+                compressAllocs = allocations;
+            }
+
+            allocations = g_allocations;
+            seconds = timed( [this]() { decompressAll( nullptr ); } );
+            allocations = g_allocations - allocations;
+
+            if ( i == 0 || seconds < decompressSeconds )
+            {
+                decompressSeconds = seconds;
+                decompressAllocs = allocations;
+            }
+        }
+
+        double megabytes = m_data.size() / ( 1024.0 * 1024.0 );
+
+        result.compressMBps = megabytes / compressSeconds;
+        result.decompressMBps = megabytes / decompressSeconds;
+        result.compressedBytes = 0;
+        for ( const std::string& chunk : m_compressed )
+        {
+            result.compressedBytes += chunk.size();
+        }
+        result.compressAllocsPerChunk = (double)compressAllocs / m_chunkCount;
+        result.decompressAllocsPerChunk
+            = (double)decompressAllocs / m_chunkCount;
+
+        return result;
+    }
+
+private:
+    const std::string& m_data;
+    CodecPath m_path;
+    int m_level;
+    size_t m_chunkSize;
+    size_t m_chunkCount;
+
+    ZlibDeflate m_compressor;
+    ZlibDeflate m_decompressor;
+    std::vector<std::string> m_compressed; // Keep their capacity
+    std::string m_inflated;
+
+    template <typename Func>
+    static double timed( Func func )
+    {
+        auto start = std::chrono::steady_clock::now();
+        func();
+        std::chrono::duration<double> elapsed
+            = std::chrono::steady_clock::now() - start;
+
+        return std::max( elapsed.count(), 1e-9 );
+    }
+
+    void compressAll()
+    {
+        if ( m_path == CodecPath::STREAMED )
+        {
+            m_compressor.beginDeflate( m_level );
+        }
+
+        for ( size_t i = 0; i < m_chunkCount; i++ )
+        {
+            size_t offset = i * m_chunkSize;
+            size_t length = std::min( m_chunkSize, m_data.size() - offset );
+            const char* input = m_data.data() + offset;
+
+            if ( m_path == CodecPath::STREAMED )
+            {
+                m_compressed[i].clear();
+                m_compressor.deflatePart( input, length, m_compressed[i],
+                    i + 1 == m_chunkCount ? ZlibDeflate::Flush::FINISH
+                                          : ZlibDeflate::Flush::SYNC );
+            }
+            else
+            {
+                m_compressor.compress( input, length, m_compressed[i],
+                    m_level, m_path == CodecPath::DICTIONARY );
+            }
+        }
+    }
+
+    bool decompressAll( std::string* restored )
+    {
+        if ( m_path == CodecPath::STREAMED && !m_decompressor.beginInflate() )
+        {
+            return false;
+        }
+
+        for ( const std::string& chunk : m_compressed )
+        {
+            bool ok;
+
+            if ( m_path == CodecPath::STREAMED )
+            {
+                bool finished;
+                m_inflated.clear();
+                ok = m_decompressor.inflatePart( chunk.data(), chunk.size(),
+                    m_inflated, finished );
+            }
+            else
+            {
+                ok = m_decompressor.decompress( chunk.data(), chunk.size(),
+                    m_inflated );
+            }
+
+            if ( !ok )
+            {
+                return false;
+            }
+
+            if ( restored )
+            {
+                *restored += m_inflated;
+            }
+        }
+
+        return true;
+    }
+};
+
+bool parseOptions( int argc, char** argv, Options& options )
+{
+    options.corpusSize = 8 * 1024 * 1024;
+    options.repeats = 3;
+    options.levels = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    options.output.clear();
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if ( !value )
+        {
+            return false;
+        }
+
+        if ( arg == "--size" )
+        {
+            options.corpusSize = (size_t)std::max( std::atoi( value ), 1 )
+                * 1024 * 1024;
+        }
+        else if ( arg == "--repeats" )
+        {
+            options.repeats = std::max( std::atoi( value ), 1 );
+        }
+        else if ( arg == "--levels" )
+        {
+            options.levels.clear();
+
+            std::stringstream list( value );
+            std::string level;
+            while ( std::getline( list, level, ',' ) )
+            {
+                options.levels.push_back(
+                    std::max( std::min( std::atoi( level.c_str() ), 9 ), 0 ) );
+            }
+        }
+        else if ( arg == "--output" )
+        {
+            options.output = value;
+        }
+        else
+        {
+            return false;
+        }
+
+        i++;
+    }
+
+    return !options.levels.empty();
+}
+
+void writeResult( std::ostream& out, const std::string& corpus,
+    CodecPath path, int level, size_t chunkSize, size_t corpusSize,
+    const Result& result )
+{
+    char line[512];
+
+    std::snprintf( line, sizeof( line ),
+        "    { \"corpus\": \"%s\", \"codec\": \"%s\", \"level\": %d, "
+        "\"chunkSize\": %zu, \"compressMBps\": %.1f, "
+        "\"decompressMBps\": %.1f, \"ratio\": %.3f, "
+        "\"compressedBytes\": %zu, \"compressAllocsPerChunk\": %.2f, "
+        "\"decompressAllocsPerChunk\": %.2f }",
+        corpus.c_str(), getPathName( path ), level, chunkSize,
+        result.compressMBps, result.decompressMBps,
+        (double)corpusSize / std::max( result.compressedBytes, (size_t)1 ),
+        result.compressedBytes, result.compressAllocsPerChunk,
+        result.decompressAllocsPerChunk );
+
+    out << line;
+}
+
+};
+
+int main( int argc, char** argv )
+{
+    Options options;
+
+    if ( !parseOptions( argc, argv, options ) )
+    {
+        std::cerr << "Usage: bench [--size MB] [--repeats N] "
+                     "[--levels 1,6,9] [--output results.json]"
+                  << std::endl;
+        return 2;
+    }
+
+    std::vector<Corpus> corpora = generateCorpora( options.corpusSize );
+
+    std::ofstream file;
+    if ( !options.output.empty() )
+    {
+        file.open( options.output );
+
+        if ( !file )
+        {
+            std::cerr << "Can't write " << options.output << std::endl;
+            return 1;
+        }
+    }
+
+    std::ostream& out = options.output.empty() ? std::cout : file;
+    bool first = true;
+
+    out << "{\n  \"zlibVersion\": \"" << zlibVersion() << "\",\n"
+        << "  \"corpusSize\": " << options.corpusSize << ",\n"
+        << "  \"repeats\": " << options.repeats << ",\n"
+        << "  \"results\": [\n";
+
+    for ( const Corpus& corpus : corpora )
+    {
+        std::string dictionary = buildDictionary( corpus.data );
+
+        for ( CodecPath path : CODEC_PATHS )
+        {
+            for ( size_t chunkSize : CHUNK_SIZES )
+            {
+                for ( int level : options.levels )
+                {
+                    CodecRun run( corpus.data, path, level, chunkSize,
+                        dictionary );
+
+                    if ( !run.verify() )
+                    {
+                        std::cerr << "Round trip failed: " << corpus.name
+                                  << ", " << getPathName( path ) << ", level "
+                                  << level << ", " << chunkSize << " B chunks"
+                                  << std::endl;
+                        return 1;
+                    }
+
+                    Result result = run.measure( options.repeats );
+
+                    out << ( first ? "" : ",\n" );
+                    writeResult( out, corpus.name, path, level, chunkSize,
+                        corpus.data.size(), result );
+                    first = false;
+
+                    std::cerr << corpus.name << " " << getPathName( path )
+                              << " level " << level << ", "
+                              << chunkSize / 1024 << " kB chunks: "
+                              << (int)result.compressMBps << " / "
+                              << (int)result.decompressMBps << " MB/s"
+                              << std::endl;
+                }
+            }
+        }
+    }
+
+    out << "\n  ]\n}\n";
+
+    return 0;
+}
@@ -9,9 +9,20 @@ REM
 REM This batch file outputs to src/proto-gen directory
 REM
 
+set PROTOC=..\vcpkg_installed\x64-windows\x64-windows\tools\protobuf\protoc.exe
+
+REM Sources in src/proto-gen are generated by protoc 3.19.4 and only
+REM build against that runtime, so no other version may overwrite them
+"%PROTOC%" --version | findstr /x /c:"libprotoc 3.19.4" >nul
+if errorlevel 1 (
+    echo protoc 3.19.4 is required, found:
+    "%PROTOC%" --version
+    exit /b 1
+)
+
 rmdir /s /q "../src/proto-gen"
 mkdir "../src/proto-gen"
-..\vcpkg_installed\x64-windows\x64-windows\tools\protobuf\protoc.exe -I . --grpc_out ../src/proto-gen --plugin=protoc-gen-grpc=../vcpkg_installed/x64-windows/x64-windows/tools/grpc/grpc_cpp_plugin.exe warp.proto
-..\vcpkg_installed\x64-windows\x64-windows\tools\protobuf\protoc.exe -I . --cpp_out ../src/proto-gen warp.proto
+"%PROTOC%" -I . --grpc_out ../src/proto-gen --plugin=protoc-gen-grpc=../vcpkg_installed/x64-windows/x64-windows/tools/grpc/grpc_cpp_plugin.exe warp.proto
+"%PROTOC%" -I . --cpp_out ../src/proto-gen warp.proto
 echo All done...
 
@@ -145,6 +145,75 @@ void SettingsDialog::createGeneralPage()
         wxSL_HORIZONTAL | wxSL_AUTOTICKS | wxSL_LABELS );
     transfers->Add( m_zlibCompressionLevel, 0, wxLEFT | wxRIGHT | wxEXPAND, FromDIP( 10 ) );
 
+    m_adaptiveCompression = new wxCheckBox( m_panelGeneral, wxID_ANY,
+        _( "Lower compression level for incompressible files and fast networks" ) );
+    transfers->Add( m_adaptiveCompression, 0, wxLEFT | wxRIGHT | wxEXPAND, FromDIP( 10 ) );
+
+    transfers->AddSpacer( FromDIP( 3 ) );
+
+    m_streamedDeflate = new wxCheckBox( m_panelGeneral, wxID_ANY,
+        _( "Ask senders to compress each file as one continuous stream" ) );
+    transfers->Add( m_streamedDeflate, 0, wxLEFT | wxRIGHT | wxEXPAND, FromDIP( 10 ) );
+
+    transfers->AddSpacer( FromDIP( 3 ) );
+
+    m_presetDictionary = new wxCheckBox( m_panelGeneral, wxID_ANY,
+        _( "Ask senders to compress small files with a shared dictionary" ) );
+    transfers->Add( m_presetDictionary, 0, wxLEFT | wxRIGHT | wxEXPAND, FromDIP( 10 ) );
+
+    transfers->AddSpacer( FromDIP( 3 ) );
+
+    m_solidArchive = new wxCheckBox( m_panelGeneral, wxID_ANY,
+        _( "Ask senders to pack small files together" ) );
+    transfers->Add( m_solidArchive, 0, wxLEFT | wxRIGHT | wxEXPAND, FromDIP( 10 ) );
+
+    transfers->AddSpacer( FromDIP( 3 ) );
+
+    wxBoxSizer* compressionThreadsSizer = new wxBoxSizer( wxHORIZONTAL );
+
+    label = new wxStaticText( m_panelGeneral, wxID_ANY,
+        _( "Compression threads (0 = automatic):" ) );
+    compressionThreadsSizer->Add( label, 1, wxALIGN_CENTER_VERTICAL | wxRIGHT, FromDIP( 5 ) );
+
+    m_compressionThreads = new wxSpinCtrl( m_panelGeneral );
+    m_compressionThreads->SetMin( 0 );
+    m_compressionThreads->SetMax( 16 );
+    compressionThreadsSizer->Add( m_compressionThreads, 0, wxEXPAND );
+
+    transfers->Add( compressionThreadsSizer, 0, wxLEFT | wxRIGHT | wxEXPAND, FromDIP( 10 ) );
+
+    transfers->AddSpacer( FromDIP( 3 ) );
+
+    wxBoxSizer* bandwidthSizer = new wxBoxSizer( wxHORIZONTAL );
+
+    label = new wxStaticText( m_panelGeneral, wxID_ANY,
+        _( "Bandwidth limit in kB/s (0 = unlimited):" ) );
+    bandwidthSizer->Add( label, 1, wxALIGN_CENTER_VERTICAL | wxRIGHT, FromDIP( 5 ) );
+
+    m_bandwidthLimit = new wxSpinCtrl( m_panelGeneral );
+    m_bandwidthLimit->SetMin( 0 );
+    m_bandwidthLimit->SetMax( 10000000 );
+    bandwidthSizer->Add( m_bandwidthLimit, 0, wxEXPAND );
+
+    transfers->Add( bandwidthSizer, 0, wxLEFT | wxRIGHT | wxEXPAND, FromDIP( 10 ) );
+
+    transfers->AddSpacer( FromDIP( 3 ) );
+
+    wxBoxSizer* remoteBandwidthSizer = new wxBoxSizer( wxHORIZONTAL );
+
+    label = new wxStaticText( m_panelGeneral, wxID_ANY,
+        _( "Bandwidth limit per device in kB/s (0 = unlimited):" ) );
+    remoteBandwidthSizer->Add( label, 1, wxALIGN_CENTER_VERTICAL | wxRIGHT, FromDIP( 5 ) );
+
+    m_remoteBandwidthLimit = new wxSpinCtrl( m_panelGeneral );
+    m_remoteBandwidthLimit->SetMin( 0 );
+    m_remoteBandwidthLimit->SetMax( 10000000 );
+    remoteBandwidthSizer->Add( m_remoteBandwidthLimit, 0, wxEXPAND );
+
+    transfers->Add( remoteBandwidthSizer, 0, wxLEFT | wxRIGHT | wxEXPAND, FromDIP( 10 ) );
+
+    transfers->AddSpacer( FromDIP( 5 ) );
+
     label = new wxStaticText( m_panelGeneral, wxID_ANY, _( "Location for received files:" ) );
     transfers->Add( label, 0, wxLEFT | wxRIGHT | wxEXPAND, FromDIP( 10 ) );
 
@@ -171,6 +240,35 @@ void SettingsDialog::createGeneralPage()
         _( "Preserve zone information in incoming files" ) );
     transfers->Add( m_preserveZoneInfo, 0, wxLEFT | wxRIGHT | wxEXPAND, FromDIP( 10 ) );
 
+    transfers->AddSpacer( FromDIP( 3 ) );
+
+    m_verifyChecksums = new wxCheckBox( m_panelGeneral, wxID_ANY,
+        _( "Verify received files with checksums" ) );
+    transfers->Add( m_verifyChecksums, 0, wxLEFT | wxRIGHT | wxEXPAND, FromDIP( 10 ) );
+
+    transfers->AddSpacer( FromDIP( 3 ) );
+
+    m_atomicWrites = new wxCheckBox( m_panelGeneral, wxID_ANY,
+        _( "Keep incoming files under a temporary name until complete" ) );
+    transfers->Add( m_atomicWrites, 0, wxLEFT | wxRIGHT | wxEXPAND, FromDIP( 10 ) );
+
+    transfers->AddSpacer( FromDIP( 3 ) );
+
+    wxBoxSizer* syncPolicySizer = new wxBoxSizer( wxHORIZONTAL );
+
+    label = new wxStaticText( m_panelGeneral, wxID_ANY,
+        _( "Flush received files to disk:" ) );
+    syncPolicySizer->Add( label, 1, wxALIGN_CENTER_VERTICAL | wxRIGHT, FromDIP( 5 ) );
+
+    // Same order as srv::SyncPolicy
+    m_syncPolicy = new wxChoice( m_panelGeneral, wxID_ANY );
+    m_syncPolicy->Append( _( "Never" ) );
+    m_syncPolicy->Append( _( "After every file" ) );
+    m_syncPolicy->Append( _( "In batches" ) );
+    syncPolicySizer->Add( m_syncPolicy, 0, wxEXPAND );
+
+    transfers->Add( syncPolicySizer, 0, wxLEFT | wxRIGHT | wxEXPAND, FromDIP( 10 ) );
+
     transfers->AddSpacer( FromDIP( 10 ) );
 
     sizer->Add( transfers, 0, wxLEFT | wxRIGHT | wxEXPAND, FromDIP( 10 ) );
@@ -395,10 +493,20 @@ void SettingsDialog::loadSettings()
     m_autorunHidden->SetValue( settings.autorunHidden );
     m_useCompression->SetValue( settings.useCompression );
     m_zlibCompressionLevel->SetValue( settings.zlibCompressionLevel );
+    m_adaptiveCompression->SetValue( settings.adaptiveCompression );
+    m_streamedDeflate->SetValue( settings.streamedDeflate );
+    m_presetDictionary->SetValue( settings.presetDictionary );
+    m_solidArchive->SetValue( settings.solidArchive );
+    m_compressionThreads->SetValue( settings.compressionThreads );
+    m_bandwidthLimit->SetValue( settings.bandwidthLimitKb );
+    m_remoteBandwidthLimit->SetValue( settings.remoteBandwidthLimitKb );
     m_outputDir->SetPath( settings.outputPath );
     m_askReceiveFiles->SetValue( settings.askReceiveFiles );
     m_askOverwriteFiles->SetValue( settings.askOverwriteFiles );
     m_preserveZoneInfo->SetValue( settings.preserveZoneInfo );
+    m_verifyChecksums->SetValue( settings.verifyChecksums );
+    m_atomicWrites->SetValue( settings.atomicWrites );
+    m_syncPolicy->SetSelection( settings.syncPolicy );
     m_filesDefaultPerms->setPermissionMask( settings.filesDefaultPermissions );
     m_executableDefaultPerms->setPermissionMask( settings.executablesDefaultPermissions );
     m_folderDefaultPerms->setPermissionMask( settings.foldersDefaultPermissions );
@@ -419,10 +527,20 @@ void SettingsDialog::saveSettings()
     settings.autorunHidden = m_autorunHidden->IsChecked();
     settings.useCompression = m_useCompression->IsChecked();
     settings.zlibCompressionLevel = m_zlibCompressionLevel->GetValue();
+    settings.adaptiveCompression = m_adaptiveCompression->IsChecked();
+    settings.streamedDeflate = m_streamedDeflate->IsChecked();
+    settings.presetDictionary = m_presetDictionary->IsChecked();
+    settings.solidArchive = m_solidArchive->IsChecked();
+    settings.compressionThreads = m_compressionThreads->GetValue();
+    settings.bandwidthLimitKb = m_bandwidthLimit->GetValue();
+    settings.remoteBandwidthLimitKb = m_remoteBandwidthLimit->GetValue();
     settings.outputPath = m_outputDir->GetPath();
     settings.askReceiveFiles = m_askReceiveFiles->IsChecked();
     settings.askOverwriteFiles = m_askOverwriteFiles->IsChecked();
     settings.preserveZoneInfo = m_preserveZoneInfo->IsChecked();
+    settings.verifyChecksums = m_verifyChecksums->IsChecked();
+    settings.atomicWrites = m_atomicWrites->IsChecked();
+    settings.syncPolicy = m_syncPolicy->GetSelection();
     settings.filesDefaultPermissions = m_filesDefaultPerms->getPermissionMask();
     settings.executablesDefaultPermissions = m_executableDefaultPerms->getPermissionMask();
     settings.foldersDefaultPermissions = m_folderDefaultPerms->getPermissionMask();
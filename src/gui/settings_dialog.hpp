@@ -42,10 +42,20 @@ private:
     wxCheckBox* m_autorunHidden;
     wxCheckBox* m_useCompression;
     wxSlider* m_zlibCompressionLevel;
+    wxCheckBox* m_adaptiveCompression;
+    wxCheckBox* m_streamedDeflate;
+    wxCheckBox* m_presetDictionary;
+    wxCheckBox* m_solidArchive;
+    wxSpinCtrl* m_compressionThreads;
+    wxSpinCtrl* m_bandwidthLimit;
+    wxSpinCtrl* m_remoteBandwidthLimit;
     wxDirPickerCtrl* m_outputDir;
     wxCheckBox* m_askReceiveFiles;
     wxCheckBox* m_askOverwriteFiles;
     wxCheckBox* m_preserveZoneInfo;
+    wxCheckBox* m_verifyChecksums;
+    wxCheckBox* m_atomicWrites;
+    wxChoice* m_syncPolicy;
 
     // Permissions
 
@@ -82,8 +82,18 @@ constexpr OpInfo::OpInfo(
   ::PROTOBUF_NAMESPACE_ID::internal::ConstantInitialized)
   : ident_(&::PROTOBUF_NAMESPACE_ID::internal::fixed_address_empty_string)
   , readable_name_(&::PROTOBUF_NAMESPACE_ID::internal::fixed_address_empty_string)
+  , resume_bitmap_(&::PROTOBUF_NAMESPACE_ID::internal::fixed_address_empty_string)
   , timestamp_(uint64_t{0u})
-  , use_compression_(false){}
+  , use_compression_(false)
+  , stream_count_(0u)
+  , stream_index_(0u)
+  , manifest_hash_(uint64_t{0u})
+  , resume_entry_(0u)
+  , resume_offset_(uint64_t{0u})
+  , verify_checksums_(false)
+  , streamed_deflate_(false)
+  , preset_dictionary_(false)
+  , solid_archive_(false){}
 struct OpInfoDefaultTypeInternal {
   constexpr OpInfoDefaultTypeInternal()
     : _instance(::PROTOBUF_NAMESPACE_ID::internal::ConstantInitialized{}) {}
@@ -132,7 +142,13 @@ constexpr FileChunk::FileChunk(
   , symlink_target_(&::PROTOBUF_NAMESPACE_ID::internal::fixed_address_empty_string)
   , chunk_(&::PROTOBUF_NAMESPACE_ID::internal::fixed_address_empty_string)
   , file_type_(0)
-  , file_mode_(0u){}
+  , file_mode_(0u)
+  , entry_index_(0u)
+  , file_size_(uint64_t{0u})
+  , file_crc32c_(0u)
+  , file_crc32c_set_(false)
+  , deflate_framing_(0u)
+  , solid_batch_(false){}
 struct FileChunkDefaultTypeInternal {
   constexpr FileChunkDefaultTypeInternal()
     : _instance(::PROTOBUF_NAMESPACE_ID::internal::ConstantInitialized{}) {}
@@ -219,6 +235,16 @@ const uint32_t TableStruct_warp_2eproto::offsets[] PROTOBUF_SECTION_VARIABLE(pro
   PROTOBUF_FIELD_OFFSET(::OpInfo, timestamp_),
   PROTOBUF_FIELD_OFFSET(::OpInfo, readable_name_),
   PROTOBUF_FIELD_OFFSET(::OpInfo, use_compression_),
+  PROTOBUF_FIELD_OFFSET(::OpInfo, stream_count_),
+  PROTOBUF_FIELD_OFFSET(::OpInfo, stream_index_),
+  PROTOBUF_FIELD_OFFSET(::OpInfo, manifest_hash_),
+  PROTOBUF_FIELD_OFFSET(::OpInfo, resume_bitmap_),
+  PROTOBUF_FIELD_OFFSET(::OpInfo, resume_entry_),
+  PROTOBUF_FIELD_OFFSET(::OpInfo, resume_offset_),
+  PROTOBUF_FIELD_OFFSET(::OpInfo, verify_checksums_),
+  PROTOBUF_FIELD_OFFSET(::OpInfo, streamed_deflate_),
+  PROTOBUF_FIELD_OFFSET(::OpInfo, preset_dictionary_),
+  PROTOBUF_FIELD_OFFSET(::OpInfo, solid_archive_),
   ~0u,  // no _has_bits_
   PROTOBUF_FIELD_OFFSET(::StopInfo, _internal_metadata_),
   ~0u,  // no _extensions_
@@ -253,6 +279,12 @@ const uint32_t TableStruct_warp_2eproto::offsets[] PROTOBUF_SECTION_VARIABLE(pro
   PROTOBUF_FIELD_OFFSET(::FileChunk, symlink_target_),
   PROTOBUF_FIELD_OFFSET(::FileChunk, chunk_),
   PROTOBUF_FIELD_OFFSET(::FileChunk, file_mode_),
+  PROTOBUF_FIELD_OFFSET(::FileChunk, entry_index_),
+  PROTOBUF_FIELD_OFFSET(::FileChunk, file_size_),
+  PROTOBUF_FIELD_OFFSET(::FileChunk, file_crc32c_),
+  PROTOBUF_FIELD_OFFSET(::FileChunk, file_crc32c_set_),
+  PROTOBUF_FIELD_OFFSET(::FileChunk, deflate_framing_),
+  PROTOBUF_FIELD_OFFSET(::FileChunk, solid_batch_),
   ~0u,  // no _has_bits_
   PROTOBUF_FIELD_OFFSET(::RegRequest, _internal_metadata_),
   ~0u,  // no _extensions_
@@ -276,11 +308,11 @@ static const ::PROTOBUF_NAMESPACE_ID::internal::MigrationSchema schemas[] PROTOB
   { 23, -1, -1, sizeof(::HaveDuplex)},
   { 30, -1, -1, sizeof(::VoidType)},
   { 37, -1, -1, sizeof(::OpInfo)},
-  { 47, -1, -1, sizeof(::StopInfo)},
-  { 55, -1, -1, sizeof(::TransferOpRequest)},
-  { 70, -1, -1, sizeof(::FileChunk)},
-  { 81, -1, -1, sizeof(::RegRequest)},
-  { 89, -1, -1, sizeof(::RegResponse)},
+  { 57, -1, -1, sizeof(::StopInfo)},
+  { 65, -1, -1, sizeof(::TransferOpRequest)},
+  { 80, -1, -1, sizeof(::FileChunk)},
+  { 97, -1, -1, sizeof(::RegRequest)},
+  { 105, -1, -1, sizeof(::RegResponse)},
 };
 
 static ::PROTOBUF_NAMESPACE_ID::Message const * const file_default_instances[] = {
@@ -303,39 +335,49 @@ const char descriptor_table_protodef_warp_2eproto[] PROTOBUF_SECTION_VARIABLE(pr
   "moteMachineAvatar\022\024\n\014avatar_chunk\030\001 \001(\014\""
   "/\n\nLookupName\022\n\n\002id\030\001 \001(\t\022\025\n\rreadable_na"
   "me\030\002 \001(\t\"\036\n\nHaveDuplex\022\020\n\010response\030\002 \001(\010"
-  "\"\031\n\010VoidType\022\r\n\005dummy\030\001 \001(\005\"Z\n\006OpInfo\022\r\n"
-  "\005ident\030\001 \001(\t\022\021\n\ttimestamp\030\002 \001(\004\022\025\n\rreada"
-  "ble_name\030\003 \001(\t\022\027\n\017use_compression\030\004 \001(\010\""
-  "0\n\010StopInfo\022\025\n\004info\030\001 \001(\0132\007.OpInfo\022\r\n\005er"
-  "ror\030\002 \001(\010\"\320\001\n\021TransferOpRequest\022\025\n\004info\030"
-  "\001 \001(\0132\007.OpInfo\022\023\n\013sender_name\030\002 \001(\t\022\025\n\rr"
-  "eceiver_name\030\003 \001(\t\022\020\n\010receiver\030\004 \001(\t\022\014\n\004"
-  "size\030\005 \001(\004\022\r\n\005count\030\006 \001(\004\022\026\n\016name_if_sin"
-  "gle\030\007 \001(\t\022\026\n\016mime_if_single\030\010 \001(\t\022\031\n\021top"
-  "_dir_basenames\030\t \003(\t\"o\n\tFileChunk\022\025\n\rrel"
-  "ative_path\030\001 \001(\t\022\021\n\tfile_type\030\002 \001(\005\022\026\n\016s"
-  "ymlink_target\030\003 \001(\t\022\r\n\005chunk\030\004 \001(\014\022\021\n\tfi"
-  "le_mode\030\005 \001(\r\"*\n\nRegRequest\022\n\n\002ip\030\001 \001(\t\022"
-  "\020\n\010hostname\030\002 \001(\t\"\"\n\013RegResponse\022\023\n\013lock"
-  "ed_cert\030\001 \001(\t2\362\003\n\004Warp\0223\n\025CheckDuplexCon"
-  "nection\022\013.LookupName\032\013.HaveDuplex\"\000\022.\n\020W"
-  "aitingForDuplex\022\013.LookupName\032\013.HaveDuple"
-  "x\"\000\0229\n\024GetRemoteMachineInfo\022\013.LookupName"
-  "\032\022.RemoteMachineInfo\"\000\022\?\n\026GetRemoteMachi"
-  "neAvatar\022\013.LookupName\032\024.RemoteMachineAva"
-  "tar\"\0000\001\022;\n\030ProcessTransferOpRequest\022\022.Tr"
-  "ansferOpRequest\032\t.VoidType\"\000\022\'\n\017PauseTra"
-  "nsferOp\022\007.OpInfo\032\t.VoidType\"\000\022(\n\rStartTr"
-  "ansfer\022\007.OpInfo\032\n.FileChunk\"\0000\001\022/\n\027Cance"
-  "lTransferOpRequest\022\007.OpInfo\032\t.VoidType\"\000"
-  "\022&\n\014StopTransfer\022\t.StopInfo\032\t.VoidType\"\000"
-  "\022 \n\004Ping\022\013.LookupName\032\t.VoidType\"\0002E\n\020Wa"
-  "rpRegistration\0221\n\022RequestCertificate\022\013.R"
-  "egRequest\032\014.RegResponse\"\000b\006proto3"
+  "\"\031\n\010VoidType\022\r\n\005dummy\030\001 \001(\005\"\307\002\n\006OpInfo\022\r"
+  "\n\005ident\030\001 \001(\t\022\021\n\ttimestamp\030\002 \001(\004\022\025\n\rread"
+  "able_name\030\003 \001(\t\022\027\n\017use_compression\030\004 \001(\010"
+  "\022\024\n\014stream_count\030d \001(\r\022\024\n\014stream_index\030e"
+  " \001(\r\022\025\n\rmanifest_hash\030f \001(\004\022\025\n\rresume_bi"
+  "tmap\030g \001(\014\022\024\n\014resume_entry\030h \001(\r\022\025\n\rresu"
+  "me_offset\030i \001(\004\022\030\n\020verify_checksums\030j \001("
+  "\010\022\030\n\020streamed_deflate\030k \001(\010\022\031\n\021preset_di"
+  "ctionary\030l \001(\010\022\025\n\rsolid_archive\030m \001(\010\"0\n"
+  "\010StopInfo\022\025\n\004info\030\001 \001(\0132\007.OpInfo\022\r\n\005erro"
+  "r\030\002 \001(\010\"\320\001\n\021TransferOpRequest\022\025\n\004info\030\001 "
+  "\001(\0132\007.OpInfo\022\023\n\013sender_name\030\002 \001(\t\022\025\n\rrec"
+  "eiver_name\030\003 \001(\t\022\020\n\010receiver\030\004 \001(\t\022\014\n\004si"
+  "ze\030\005 \001(\004\022\r\n\005count\030\006 \001(\004\022\026\n\016name_if_singl"
+  "e\030\007 \001(\t\022\026\n\016mime_if_single\030\010 \001(\t\022\031\n\021top_d"
+  "ir_basenames\030\t \003(\t\"\363\001\n\tFileChunk\022\025\n\rrela"
+  "tive_path\030\001 \001(\t\022\021\n\tfile_type\030\002 \001(\005\022\026\n\016sy"
+  "mlink_target\030\003 \001(\t\022\r\n\005chunk\030\004 \001(\014\022\021\n\tfil"
+  "e_mode\030\005 \001(\r\022\023\n\013entry_index\030d \001(\r\022\021\n\tfil"
+  "e_size\030e \001(\004\022\023\n\013file_crc32c\030f \001(\007\022\027\n\017fil"
+  "e_crc32c_set\030g \001(\010\022\027\n\017deflate_framing\030h "
+  "\001(\r\022\023\n\013solid_batch\030i \001(\010\"*\n\nRegRequest\022\n"
+  "\n\002ip\030\001 \001(\t\022\020\n\010hostname\030\002 \001(\t\"\"\n\013RegRespo"
+  "nse\022\023\n\013locked_cert\030\001 \001(\t2\362\003\n\004Warp\0223\n\025Che"
+  "ckDuplexConnection\022\013.LookupName\032\013.HaveDu"
+  "plex\"\000\022.\n\020WaitingForDuplex\022\013.LookupName\032"
+  "\013.HaveDuplex\"\000\0229\n\024GetRemoteMachineInfo\022\013"
+  ".LookupName\032\022.RemoteMachineInfo\"\000\022\?\n\026Get"
+  "RemoteMachineAvatar\022\013.LookupName\032\024.Remot"
+  "eMachineAvatar\"\0000\001\022;\n\030ProcessTransferOpR"
+  "equest\022\022.TransferOpRequest\032\t.VoidType\"\000\022"
+  "\'\n\017PauseTransferOp\022\007.OpInfo\032\t.VoidType\"\000"
+  "\022(\n\rStartTransfer\022\007.OpInfo\032\n.FileChunk\"\000"
+  "0\001\022/\n\027CancelTransferOpRequest\022\007.OpInfo\032\t"
+  ".VoidType\"\000\022&\n\014StopTransfer\022\t.StopInfo\032\t"
+  ".VoidType\"\000\022 \n\004Ping\022\013.LookupName\032\t.VoidT"
+  "ype\"\0002E\n\020WarpRegistration\0221\n\022RequestCert"
+  "ificate\022\013.RegRequest\032\014.RegResponse\"\000b\006pr"
+  "oto3"
   ;
 static ::PROTOBUF_NAMESPACE_ID::internal::once_flag descriptor_table_warp_2eproto_once;
 const ::PROTOBUF_NAMESPACE_ID::internal::DescriptorTable descriptor_table_warp_2eproto = {
-  false, false, 1353, descriptor_table_protodef_warp_2eproto, "warp.proto", 
+  false, false, 1724, descriptor_table_protodef_warp_2eproto, "warp.proto", 
   &descriptor_table_warp_2eproto_once, nullptr, 0, 11,
   schemas, file_default_instances, TableStruct_warp_2eproto::offsets,
   file_level_metadata_warp_2eproto, file_level_enum_descriptors_warp_2eproto, file_level_service_descriptors_warp_2eproto,
@@ -1439,9 +1481,17 @@ OpInfo::OpInfo(const OpInfo& from)
     readable_name_.Set(::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr::EmptyDefault{}, from._internal_readable_name(), 
       GetArenaForAllocation());
   }
+  resume_bitmap_.UnsafeSetDefault(&::PROTOBUF_NAMESPACE_ID::internal::GetEmptyStringAlreadyInited());
+  #ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+    resume_bitmap_.Set(&::PROTOBUF_NAMESPACE_ID::internal::GetEmptyStringAlreadyInited(), "", GetArenaForAllocation());
+  #endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (!from._internal_resume_bitmap().empty()) {
+    resume_bitmap_.Set(::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr::EmptyDefault{}, from._internal_resume_bitmap(), 
+      GetArenaForAllocation());
+  }
   ::memcpy(&timestamp_, &from.timestamp_,
-    static_cast<size_t>(reinterpret_cast<char*>(&use_compression_) -
-    reinterpret_cast<char*>(&timestamp_)) + sizeof(use_compression_));
+    static_cast<size_t>(reinterpret_cast<char*>(&solid_archive_) -
+    reinterpret_cast<char*>(&timestamp_)) + sizeof(solid_archive_));
   // @@protoc_insertion_point(copy_constructor:OpInfo)
 }
 
@@ -1454,10 +1504,14 @@ readable_name_.UnsafeSetDefault(&::PROTOBUF_NAMESPACE_ID::internal::GetEmptyStri
 #ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
   readable_name_.Set(&::PROTOBUF_NAMESPACE_ID::internal::GetEmptyStringAlreadyInited(), "", GetArenaForAllocation());
 #endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+resume_bitmap_.UnsafeSetDefault(&::PROTOBUF_NAMESPACE_ID::internal::GetEmptyStringAlreadyInited());
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  resume_bitmap_.Set(&::PROTOBUF_NAMESPACE_ID::internal::GetEmptyStringAlreadyInited(), "", GetArenaForAllocation());
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
 ::memset(reinterpret_cast<char*>(this) + static_cast<size_t>(
     reinterpret_cast<char*>(&timestamp_) - reinterpret_cast<char*>(this)),
-    0, static_cast<size_t>(reinterpret_cast<char*>(&use_compression_) -
-    reinterpret_cast<char*>(&timestamp_)) + sizeof(use_compression_));
+    0, static_cast<size_t>(reinterpret_cast<char*>(&solid_archive_) -
+    reinterpret_cast<char*>(&timestamp_)) + sizeof(solid_archive_));
 }
 
 OpInfo::~OpInfo() {
@@ -1471,6 +1525,7 @@ inline void OpInfo::SharedDtor() {
   GOOGLE_DCHECK(GetArenaForAllocation() == nullptr);
   ident_.DestroyNoArena(&::PROTOBUF_NAMESPACE_ID::internal::GetEmptyStringAlreadyInited());
   readable_name_.DestroyNoArena(&::PROTOBUF_NAMESPACE_ID::internal::GetEmptyStringAlreadyInited());
+  resume_bitmap_.DestroyNoArena(&::PROTOBUF_NAMESPACE_ID::internal::GetEmptyStringAlreadyInited());
 }
 
 void OpInfo::ArenaDtor(void* object) {
@@ -1491,9 +1546,10 @@ void OpInfo::Clear() {
 
   ident_.ClearToEmpty();
   readable_name_.ClearToEmpty();
+  resume_bitmap_.ClearToEmpty();
   ::memset(&timestamp_, 0, static_cast<size_t>(
-      reinterpret_cast<char*>(&use_compression_) -
-      reinterpret_cast<char*>(&timestamp_)) + sizeof(use_compression_));
+      reinterpret_cast<char*>(&solid_archive_) -
+      reinterpret_cast<char*>(&timestamp_)) + sizeof(solid_archive_));
   _internal_metadata_.Clear<::PROTOBUF_NAMESPACE_ID::UnknownFieldSet>();
 }
 
@@ -1539,6 +1595,87 @@ const char* OpInfo::_InternalParse(const char* ptr, ::PROTOBUF_NAMESPACE_ID::int
         } else
           goto handle_unusual;
         continue;
+      // uint32 stream_count = 100;
+      case 100:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 32)) {
+          stream_count_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint32(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      // uint32 stream_index = 101;
+      case 101:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 40)) {
+          stream_index_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint32(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      // uint64 manifest_hash = 102;
+      case 102:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 48)) {
+          manifest_hash_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint64(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      // bytes resume_bitmap = 103;
+      case 103:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 58)) {
+          auto str = _internal_mutable_resume_bitmap();
+          ptr = ::PROTOBUF_NAMESPACE_ID::internal::InlineGreedyStringParser(str, ptr, ctx);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      // uint32 resume_entry = 104;
+      case 104:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 64)) {
+          resume_entry_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint32(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      // uint64 resume_offset = 105;
+      case 105:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 72)) {
+          resume_offset_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint64(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      // bool verify_checksums = 106;
+      case 106:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 80)) {
+          verify_checksums_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint64(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      // bool streamed_deflate = 107;
+      case 107:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 88)) {
+          streamed_deflate_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint64(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      // bool preset_dictionary = 108;
+      case 108:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 96)) {
+          preset_dictionary_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint64(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      // bool solid_archive = 109;
+      case 109:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 104)) {
+          solid_archive_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint64(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
       default:
         goto handle_unusual;
     }  // switch
@@ -1600,6 +1737,66 @@ uint8_t* OpInfo::_InternalSerialize(
     target = ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::WriteBoolToArray(4, this->_internal_use_compression(), target);
   }
 
+  // uint32 stream_count = 100;
+  if (this->_internal_stream_count() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::WriteUInt32ToArray(100, this->_internal_stream_count(), target);
+  }
+
+  // uint32 stream_index = 101;
+  if (this->_internal_stream_index() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::WriteUInt32ToArray(101, this->_internal_stream_index(), target);
+  }
+
+  // uint64 manifest_hash = 102;
+  if (this->_internal_manifest_hash() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::WriteUInt64ToArray(102, this->_internal_manifest_hash(), target);
+  }
+
+  // bytes resume_bitmap = 103;
+  if (!this->_internal_resume_bitmap().empty()) {
+    target = stream->WriteBytesMaybeAliased(
+        103, this->_internal_resume_bitmap(), target);
+  }
+
+  // uint32 resume_entry = 104;
+  if (this->_internal_resume_entry() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::WriteUInt32ToArray(104, this->_internal_resume_entry(), target);
+  }
+
+  // uint64 resume_offset = 105;
+  if (this->_internal_resume_offset() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::WriteUInt64ToArray(105, this->_internal_resume_offset(), target);
+  }
+
+  // bool verify_checksums = 106;
+  if (this->_internal_verify_checksums() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::WriteBoolToArray(106, this->_internal_verify_checksums(), target);
+  }
+
+  // bool streamed_deflate = 107;
+  if (this->_internal_streamed_deflate() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::WriteBoolToArray(107, this->_internal_streamed_deflate(), target);
+  }
+
+  // bool preset_dictionary = 108;
+  if (this->_internal_preset_dictionary() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::WriteBoolToArray(108, this->_internal_preset_dictionary(), target);
+  }
+
+  // bool solid_archive = 109;
+  if (this->_internal_solid_archive() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::WriteBoolToArray(109, this->_internal_solid_archive(), target);
+  }
+
   if (PROTOBUF_PREDICT_FALSE(_internal_metadata_.have_unknown_fields())) {
     target = ::PROTOBUF_NAMESPACE_ID::internal::WireFormat::InternalSerializeUnknownFieldsToArray(
         _internal_metadata_.unknown_fields<::PROTOBUF_NAMESPACE_ID::UnknownFieldSet>(::PROTOBUF_NAMESPACE_ID::UnknownFieldSet::default_instance), target, stream);
@@ -1630,6 +1827,13 @@ size_t OpInfo::ByteSizeLong() const {
         this->_internal_readable_name());
   }
 
+  // bytes resume_bitmap = 103;
+  if (!this->_internal_resume_bitmap().empty()) {
+    total_size += 2 +
+      ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::BytesSize(
+        this->_internal_resume_bitmap());
+  }
+
   // uint64 timestamp = 2;
   if (this->_internal_timestamp() != 0) {
     total_size += ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::UInt64SizePlusOne(this->_internal_timestamp());
@@ -1640,6 +1844,61 @@ size_t OpInfo::ByteSizeLong() const {
     total_size += 1 + 1;
   }
 
+  // uint32 stream_count = 100;
+  if (this->_internal_stream_count() != 0) {
+    total_size += 2 +
+        ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::UInt32Size(
+          this->_internal_stream_count());
+  }
+
+  // uint32 stream_index = 101;
+  if (this->_internal_stream_index() != 0) {
+    total_size += 2 +
+        ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::UInt32Size(
+          this->_internal_stream_index());
+  }
+
+  // uint64 manifest_hash = 102;
+  if (this->_internal_manifest_hash() != 0) {
+    total_size += 2 +
+        ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::UInt64Size(
+          this->_internal_manifest_hash());
+  }
+
+  // uint32 resume_entry = 104;
+  if (this->_internal_resume_entry() != 0) {
+    total_size += 2 +
+        ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::UInt32Size(
+          this->_internal_resume_entry());
+  }
+
+  // uint64 resume_offset = 105;
+  if (this->_internal_resume_offset() != 0) {
+    total_size += 2 +
+        ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::UInt64Size(
+          this->_internal_resume_offset());
+  }
+
+  // bool verify_checksums = 106;
+  if (this->_internal_verify_checksums() != 0) {
+    total_size += 2 + 1;
+  }
+
+  // bool streamed_deflate = 107;
+  if (this->_internal_streamed_deflate() != 0) {
+    total_size += 2 + 1;
+  }
+
+  // bool preset_dictionary = 108;
+  if (this->_internal_preset_dictionary() != 0) {
+    total_size += 2 + 1;
+  }
+
+  // bool solid_archive = 109;
+  if (this->_internal_solid_archive() != 0) {
+    total_size += 2 + 1;
+  }
+
   return MaybeComputeUnknownFieldsSize(total_size, &_cached_size_);
 }
 
@@ -1668,12 +1927,42 @@ void OpInfo::MergeFrom(const OpInfo& from) {
   if (!from._internal_readable_name().empty()) {
     _internal_set_readable_name(from._internal_readable_name());
   }
+  if (!from._internal_resume_bitmap().empty()) {
+    _internal_set_resume_bitmap(from._internal_resume_bitmap());
+  }
   if (from._internal_timestamp() != 0) {
     _internal_set_timestamp(from._internal_timestamp());
   }
   if (from._internal_use_compression() != 0) {
     _internal_set_use_compression(from._internal_use_compression());
   }
+  if (from._internal_stream_count() != 0) {
+    _internal_set_stream_count(from._internal_stream_count());
+  }
+  if (from._internal_stream_index() != 0) {
+    _internal_set_stream_index(from._internal_stream_index());
+  }
+  if (from._internal_manifest_hash() != 0) {
+    _internal_set_manifest_hash(from._internal_manifest_hash());
+  }
+  if (from._internal_resume_entry() != 0) {
+    _internal_set_resume_entry(from._internal_resume_entry());
+  }
+  if (from._internal_resume_offset() != 0) {
+    _internal_set_resume_offset(from._internal_resume_offset());
+  }
+  if (from._internal_verify_checksums() != 0) {
+    _internal_set_verify_checksums(from._internal_verify_checksums());
+  }
+  if (from._internal_streamed_deflate() != 0) {
+    _internal_set_streamed_deflate(from._internal_streamed_deflate());
+  }
+  if (from._internal_preset_dictionary() != 0) {
+    _internal_set_preset_dictionary(from._internal_preset_dictionary());
+  }
+  if (from._internal_solid_archive() != 0) {
+    _internal_set_solid_archive(from._internal_solid_archive());
+  }
   _internal_metadata_.MergeFrom<::PROTOBUF_NAMESPACE_ID::UnknownFieldSet>(from._internal_metadata_);
 }
 
@@ -1703,9 +1992,14 @@ void OpInfo::InternalSwap(OpInfo* other) {
       &readable_name_, lhs_arena,
       &other->readable_name_, rhs_arena
   );
+  ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr::InternalSwap(
+      &::PROTOBUF_NAMESPACE_ID::internal::GetEmptyStringAlreadyInited(),
+      &resume_bitmap_, lhs_arena,
+      &other->resume_bitmap_, rhs_arena
+  );
   ::PROTOBUF_NAMESPACE_ID::internal::memswap<
-      PROTOBUF_FIELD_OFFSET(OpInfo, use_compression_)
-      + sizeof(OpInfo::use_compression_)
+      PROTOBUF_FIELD_OFFSET(OpInfo, solid_archive_)
+      + sizeof(OpInfo::solid_archive_)
       - PROTOBUF_FIELD_OFFSET(OpInfo, timestamp_)>(
           reinterpret_cast<char*>(&timestamp_),
           reinterpret_cast<char*>(&other->timestamp_));
@@ -2525,8 +2819,8 @@ FileChunk::FileChunk(const FileChunk& from)
       GetArenaForAllocation());
   }
   ::memcpy(&file_type_, &from.file_type_,
-    static_cast<size_t>(reinterpret_cast<char*>(&file_mode_) -
-    reinterpret_cast<char*>(&file_type_)) + sizeof(file_mode_));
+    static_cast<size_t>(reinterpret_cast<char*>(&solid_batch_) -
+    reinterpret_cast<char*>(&file_type_)) + sizeof(solid_batch_));
   // @@protoc_insertion_point(copy_constructor:FileChunk)
 }
 
@@ -2545,8 +2839,8 @@ chunk_.UnsafeSetDefault(&::PROTOBUF_NAMESPACE_ID::internal::GetEmptyStringAlread
 #endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
 ::memset(reinterpret_cast<char*>(this) + static_cast<size_t>(
     reinterpret_cast<char*>(&file_type_) - reinterpret_cast<char*>(this)),
-    0, static_cast<size_t>(reinterpret_cast<char*>(&file_mode_) -
-    reinterpret_cast<char*>(&file_type_)) + sizeof(file_mode_));
+    0, static_cast<size_t>(reinterpret_cast<char*>(&solid_batch_) -
+    reinterpret_cast<char*>(&file_type_)) + sizeof(solid_batch_));
 }
 
 FileChunk::~FileChunk() {
@@ -2583,8 +2877,8 @@ void FileChunk::Clear() {
   symlink_target_.ClearToEmpty();
   chunk_.ClearToEmpty();
   ::memset(&file_type_, 0, static_cast<size_t>(
-      reinterpret_cast<char*>(&file_mode_) -
-      reinterpret_cast<char*>(&file_type_)) + sizeof(file_mode_));
+      reinterpret_cast<char*>(&solid_batch_) -
+      reinterpret_cast<char*>(&file_type_)) + sizeof(solid_batch_));
   _internal_metadata_.Clear<::PROTOBUF_NAMESPACE_ID::UnknownFieldSet>();
 }
 
@@ -2639,6 +2933,54 @@ const char* FileChunk::_InternalParse(const char* ptr, ::PROTOBUF_NAMESPACE_ID::
         } else
           goto handle_unusual;
         continue;
+      // uint32 entry_index = 100;
+      case 100:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 32)) {
+          entry_index_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint32(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      // uint64 file_size = 101;
+      case 101:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 40)) {
+          file_size_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint64(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      // fixed32 file_crc32c = 102;
+      case 102:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 53)) {
+          file_crc32c_ = ::PROTOBUF_NAMESPACE_ID::internal::UnalignedLoad<uint32_t>(ptr);
+          ptr += sizeof(uint32_t);
+        } else
+          goto handle_unusual;
+        continue;
+      // bool file_crc32c_set = 103;
+      case 103:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 56)) {
+          file_crc32c_set_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint64(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      // uint32 deflate_framing = 104;
+      case 104:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 64)) {
+          deflate_framing_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint32(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
+      // bool solid_batch = 105;
+      case 105:
+        if (PROTOBUF_PREDICT_TRUE(static_cast<uint8_t>(tag) == 72)) {
+          solid_batch_ = ::PROTOBUF_NAMESPACE_ID::internal::ReadVarint64(&ptr);
+          CHK_(ptr);
+        } else
+          goto handle_unusual;
+        continue;
       default:
         goto handle_unusual;
     }  // switch
@@ -2706,6 +3048,42 @@ uint8_t* FileChunk::_InternalSerialize(
     target = ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::WriteUInt32ToArray(5, this->_internal_file_mode(), target);
   }
 
+  // uint32 entry_index = 100;
+  if (this->_internal_entry_index() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::WriteUInt32ToArray(100, this->_internal_entry_index(), target);
+  }
+
+  // uint64 file_size = 101;
+  if (this->_internal_file_size() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::WriteUInt64ToArray(101, this->_internal_file_size(), target);
+  }
+
+  // fixed32 file_crc32c = 102;
+  if (this->_internal_file_crc32c() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::WriteFixed32ToArray(102, this->_internal_file_crc32c(), target);
+  }
+
+  // bool file_crc32c_set = 103;
+  if (this->_internal_file_crc32c_set() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::WriteBoolToArray(103, this->_internal_file_crc32c_set(), target);
+  }
+
+  // uint32 deflate_framing = 104;
+  if (this->_internal_deflate_framing() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::WriteUInt32ToArray(104, this->_internal_deflate_framing(), target);
+  }
+
+  // bool solid_batch = 105;
+  if (this->_internal_solid_batch() != 0) {
+    target = stream->EnsureSpace(target);
+    target = ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::WriteBoolToArray(105, this->_internal_solid_batch(), target);
+  }
+
   if (PROTOBUF_PREDICT_FALSE(_internal_metadata_.have_unknown_fields())) {
     target = ::PROTOBUF_NAMESPACE_ID::internal::WireFormat::InternalSerializeUnknownFieldsToArray(
         _internal_metadata_.unknown_fields<::PROTOBUF_NAMESPACE_ID::UnknownFieldSet>(::PROTOBUF_NAMESPACE_ID::UnknownFieldSet::default_instance), target, stream);
@@ -2753,6 +3131,42 @@ size_t FileChunk::ByteSizeLong() const {
     total_size += ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::UInt32SizePlusOne(this->_internal_file_mode());
   }
 
+  // uint32 entry_index = 100;
+  if (this->_internal_entry_index() != 0) {
+    total_size += 2 +
+        ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::UInt32Size(
+          this->_internal_entry_index());
+  }
+
+  // uint64 file_size = 101;
+  if (this->_internal_file_size() != 0) {
+    total_size += 2 +
+        ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::UInt64Size(
+          this->_internal_file_size());
+  }
+
+  // fixed32 file_crc32c = 102;
+  if (this->_internal_file_crc32c() != 0) {
+    total_size += 2 + 4;
+  }
+
+  // bool file_crc32c_set = 103;
+  if (this->_internal_file_crc32c_set() != 0) {
+    total_size += 2 + 1;
+  }
+
+  // uint32 deflate_framing = 104;
+  if (this->_internal_deflate_framing() != 0) {
+    total_size += 2 +
+        ::PROTOBUF_NAMESPACE_ID::internal::WireFormatLite::UInt32Size(
+          this->_internal_deflate_framing());
+  }
+
+  // bool solid_batch = 105;
+  if (this->_internal_solid_batch() != 0) {
+    total_size += 2 + 1;
+  }
+
   return MaybeComputeUnknownFieldsSize(total_size, &_cached_size_);
 }
 
@@ -2790,6 +3204,24 @@ void FileChunk::MergeFrom(const FileChunk& from) {
   if (from._internal_file_mode() != 0) {
     _internal_set_file_mode(from._internal_file_mode());
   }
+  if (from._internal_entry_index() != 0) {
+    _internal_set_entry_index(from._internal_entry_index());
+  }
+  if (from._internal_file_size() != 0) {
+    _internal_set_file_size(from._internal_file_size());
+  }
+  if (from._internal_file_crc32c() != 0) {
+    _internal_set_file_crc32c(from._internal_file_crc32c());
+  }
+  if (from._internal_file_crc32c_set() != 0) {
+    _internal_set_file_crc32c_set(from._internal_file_crc32c_set());
+  }
+  if (from._internal_deflate_framing() != 0) {
+    _internal_set_deflate_framing(from._internal_deflate_framing());
+  }
+  if (from._internal_solid_batch() != 0) {
+    _internal_set_solid_batch(from._internal_solid_batch());
+  }
   _internal_metadata_.MergeFrom<::PROTOBUF_NAMESPACE_ID::UnknownFieldSet>(from._internal_metadata_);
 }
 
@@ -2825,8 +3257,8 @@ void FileChunk::InternalSwap(FileChunk* other) {
       &other->chunk_, rhs_arena
   );
   ::PROTOBUF_NAMESPACE_ID::internal::memswap<
-      PROTOBUF_FIELD_OFFSET(FileChunk, file_mode_)
-      + sizeof(FileChunk::file_mode_)
+      PROTOBUF_FIELD_OFFSET(FileChunk, solid_batch_)
+      + sizeof(FileChunk::solid_batch_)
       - PROTOBUF_FIELD_OFFSET(FileChunk, file_type_)>(
           reinterpret_cast<char*>(&file_type_),
           reinterpret_cast<char*>(&other->file_type_));
@@ -1005,6 +1005,16 @@ class OpInfo final :
     kReadableNameFieldNumber = 3,
     kTimestampFieldNumber = 2,
     kUseCompressionFieldNumber = 4,
+    kStreamCountFieldNumber = 100,
+    kStreamIndexFieldNumber = 101,
+    kManifestHashFieldNumber = 102,
+    kResumeBitmapFieldNumber = 103,
+    kResumeEntryFieldNumber = 104,
+    kResumeOffsetFieldNumber = 105,
+    kVerifyChecksumsFieldNumber = 106,
+    kStreamedDeflateFieldNumber = 107,
+    kPresetDictionaryFieldNumber = 108,
+    kSolidArchiveFieldNumber = 109,
   };
   // string ident = 1;
   void clear_ident();
@@ -1034,6 +1044,20 @@ class OpInfo final :
   std::string* _internal_mutable_readable_name();
   public:
 
+  // bytes resume_bitmap = 103;
+  void clear_resume_bitmap();
+  const std::string& resume_bitmap() const;
+  template <typename ArgT0 = const std::string&, typename... ArgT>
+  void set_resume_bitmap(ArgT0&& arg0, ArgT... args);
+  std::string* mutable_resume_bitmap();
+  PROTOBUF_NODISCARD std::string* release_resume_bitmap();
+  void set_allocated_resume_bitmap(std::string* resume_bitmap);
+  private:
+  const std::string& _internal_resume_bitmap() const;
+  inline PROTOBUF_ALWAYS_INLINE void _internal_set_resume_bitmap(const std::string& value);
+  std::string* _internal_mutable_resume_bitmap();
+  public:
+
   // uint64 timestamp = 2;
   void clear_timestamp();
   uint64_t timestamp() const;
@@ -1052,7 +1076,88 @@ class OpInfo final :
   void _internal_set_use_compression(bool value);
   public:
 
-  // @@protoc_insertion_point(class_scope:OpInfo)
+  // uint32 stream_count = 100;
+  void clear_stream_count();
+  uint32_t stream_count() const;
+  void set_stream_count(uint32_t value);
+  private:
+  uint32_t _internal_stream_count() const;
+  void _internal_set_stream_count(uint32_t value);
+  public:
+
+  // uint32 stream_index = 101;
+  void clear_stream_index();
+  uint32_t stream_index() const;
+  void set_stream_index(uint32_t value);
+  private:
+  uint32_t _internal_stream_index() const;
+  void _internal_set_stream_index(uint32_t value);
+  public:
+
+  // uint64 manifest_hash = 102;
+  void clear_manifest_hash();
+  uint64_t manifest_hash() const;
+  void set_manifest_hash(uint64_t value);
+  private:
+  uint64_t _internal_manifest_hash() const;
+  void _internal_set_manifest_hash(uint64_t value);
+  public:
+
+  // uint32 resume_entry = 104;
+  void clear_resume_entry();
+  uint32_t resume_entry() const;
+  void set_resume_entry(uint32_t value);
+  private:
+  uint32_t _internal_resume_entry() const;
+  void _internal_set_resume_entry(uint32_t value);
+  public:
+
+  // uint64 resume_offset = 105;
+  void clear_resume_offset();
+  uint64_t resume_offset() const;
+  void set_resume_offset(uint64_t value);
+  private:
+  uint64_t _internal_resume_offset() const;
+  void _internal_set_resume_offset(uint64_t value);
+  public:
+
+    // bool verify_checksums = 106;
+  void clear_verify_checksums();
+  bool verify_checksums() const;
+  void set_verify_checksums(bool value);
+  private:
+  bool _internal_verify_checksums() const;
+  void _internal_set_verify_checksums(bool value);
+  public:
+
+  // bool streamed_deflate = 107;
+  void clear_streamed_deflate();
+  bool streamed_deflate() const;
+  void set_streamed_deflate(bool value);
+  private:
+  bool _internal_streamed_deflate() const;
+  void _internal_set_streamed_deflate(bool value);
+  public:
+
+  // bool preset_dictionary = 108;
+  void clear_preset_dictionary();
+  bool preset_dictionary() const;
+  void set_preset_dictionary(bool value);
+  private:
+  bool _internal_preset_dictionary() const;
+  void _internal_set_preset_dictionary(bool value);
+  public:
+
+  // bool solid_archive = 109;
+  void clear_solid_archive();
+  bool solid_archive() const;
+  void set_solid_archive(bool value);
+  private:
+  bool _internal_solid_archive() const;
+  void _internal_set_solid_archive(bool value);
+  public:
+
+// @@protoc_insertion_point(class_scope:OpInfo)
  private:
   class _Internal;
 
@@ -1061,8 +1166,18 @@ class OpInfo final :
   typedef void DestructorSkippable_;
   ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr ident_;
   ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr readable_name_;
+  ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr resume_bitmap_;
   uint64_t timestamp_;
   bool use_compression_;
+  uint32_t stream_count_;
+  uint32_t stream_index_;
+  uint64_t manifest_hash_;
+  uint32_t resume_entry_;
+  uint64_t resume_offset_;
+  bool verify_checksums_;
+  bool streamed_deflate_;
+  bool preset_dictionary_;
+  bool solid_archive_;
   mutable ::PROTOBUF_NAMESPACE_ID::internal::CachedSize _cached_size_;
   friend struct ::TableStruct_warp_2eproto;
 };
@@ -1644,6 +1759,12 @@ class FileChunk final :
     kChunkFieldNumber = 4,
     kFileTypeFieldNumber = 2,
     kFileModeFieldNumber = 5,
+    kEntryIndexFieldNumber = 100,
+    kFileSizeFieldNumber = 101,
+    kFileCrc32cFieldNumber = 102,
+    kFileCrc32cSetFieldNumber = 103,
+    kDeflateFramingFieldNumber = 104,
+    kSolidBatchFieldNumber = 105,
   };
   // string relative_path = 1;
   void clear_relative_path();
@@ -1705,7 +1826,61 @@ class FileChunk final :
   void _internal_set_file_mode(uint32_t value);
   public:
 
-  // @@protoc_insertion_point(class_scope:FileChunk)
+  // uint32 entry_index = 100;
+  void clear_entry_index();
+  uint32_t entry_index() const;
+  void set_entry_index(uint32_t value);
+  private:
+  uint32_t _internal_entry_index() const;
+  void _internal_set_entry_index(uint32_t value);
+  public:
+
+    // uint64 file_size = 101;
+  void clear_file_size();
+  uint64_t file_size() const;
+  void set_file_size(uint64_t value);
+  private:
+  uint64_t _internal_file_size() const;
+  void _internal_set_file_size(uint64_t value);
+  public:
+
+  // fixed32 file_crc32c = 102;
+  void clear_file_crc32c();
+  uint32_t file_crc32c() const;
+  void set_file_crc32c(uint32_t value);
+  private:
+  uint32_t _internal_file_crc32c() const;
+  void _internal_set_file_crc32c(uint32_t value);
+  public:
+
+  // bool file_crc32c_set = 103;
+  void clear_file_crc32c_set();
+  bool file_crc32c_set() const;
+  void set_file_crc32c_set(bool value);
+  private:
+  bool _internal_file_crc32c_set() const;
+  void _internal_set_file_crc32c_set(bool value);
+  public:
+
+  // uint32 deflate_framing = 104;
+  void clear_deflate_framing();
+  uint32_t deflate_framing() const;
+  void set_deflate_framing(uint32_t value);
+  private:
+  uint32_t _internal_deflate_framing() const;
+  void _internal_set_deflate_framing(uint32_t value);
+  public:
+
+  // bool solid_batch = 105;
+  void clear_solid_batch();
+  bool solid_batch() const;
+  void set_solid_batch(bool value);
+  private:
+  bool _internal_solid_batch() const;
+  void _internal_set_solid_batch(bool value);
+  public:
+
+// @@protoc_insertion_point(class_scope:FileChunk)
  private:
   class _Internal;
 
@@ -1717,6 +1892,12 @@ class FileChunk final :
   ::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr chunk_;
   int32_t file_type_;
   uint32_t file_mode_;
+  uint32_t entry_index_;
+  uint64_t file_size_;
+  uint32_t file_crc32c_;
+  bool file_crc32c_set_;
+  uint32_t deflate_framing_;
+  bool solid_batch_;
   mutable ::PROTOBUF_NAMESPACE_ID::internal::CachedSize _cached_size_;
   friend struct ::TableStruct_warp_2eproto;
 };
@@ -2486,6 +2667,57 @@ inline void OpInfo::set_allocated_readable_name(std::string* readable_name) {
   // @@protoc_insertion_point(field_set_allocated:OpInfo.readable_name)
 }
 
+// bytes resume_bitmap = 103;
+inline void OpInfo::clear_resume_bitmap() {
+  resume_bitmap_.ClearToEmpty();
+}
+inline const std::string& OpInfo::resume_bitmap() const {
+  // @@protoc_insertion_point(field_get:OpInfo.resume_bitmap)
+  return _internal_resume_bitmap();
+}
+template <typename ArgT0, typename... ArgT>
+inline PROTOBUF_ALWAYS_INLINE
+void OpInfo::set_resume_bitmap(ArgT0&& arg0, ArgT... args) {
+ 
+ resume_bitmap_.SetBytes(::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr::EmptyDefault{}, static_cast<ArgT0 &&>(arg0), args..., GetArenaForAllocation());
+  // @@protoc_insertion_point(field_set:OpInfo.resume_bitmap)
+}
+inline std::string* OpInfo::mutable_resume_bitmap() {
+  std::string* _s = _internal_mutable_resume_bitmap();
+  // @@protoc_insertion_point(field_mutable:OpInfo.resume_bitmap)
+  return _s;
+}
+inline const std::string& OpInfo::_internal_resume_bitmap() const {
+  return resume_bitmap_.Get();
+}
+inline void OpInfo::_internal_set_resume_bitmap(const std::string& value) {
+  
+  resume_bitmap_.Set(::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr::EmptyDefault{}, value, GetArenaForAllocation());
+}
+inline std::string* OpInfo::_internal_mutable_resume_bitmap() {
+  
+  return resume_bitmap_.Mutable(::PROTOBUF_NAMESPACE_ID::internal::ArenaStringPtr::EmptyDefault{}, GetArenaForAllocation());
+}
+inline std::string* OpInfo::release_resume_bitmap() {
+  // @@protoc_insertion_point(field_release:OpInfo.resume_bitmap)
+  return resume_bitmap_.Release(&::PROTOBUF_NAMESPACE_ID::internal::GetEmptyStringAlreadyInited(), GetArenaForAllocation());
+}
+inline void OpInfo::set_allocated_resume_bitmap(std::string* resume_bitmap) {
+  if (resume_bitmap != nullptr) {
+    
+  } else {
+    
+  }
+  resume_bitmap_.SetAllocated(&::PROTOBUF_NAMESPACE_ID::internal::GetEmptyStringAlreadyInited(), resume_bitmap,
+      GetArenaForAllocation());
+#ifdef PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  if (resume_bitmap_.IsDefault(&::PROTOBUF_NAMESPACE_ID::internal::GetEmptyStringAlreadyInited())) {
+    resume_bitmap_.Set(&::PROTOBUF_NAMESPACE_ID::internal::GetEmptyStringAlreadyInited(), "", GetArenaForAllocation());
+  }
+#endif // PROTOBUF_FORCE_COPY_DEFAULT_STRING
+  // @@protoc_insertion_point(field_set_allocated:OpInfo.resume_bitmap)
+}
+
 // bool use_compression = 4;
 inline void OpInfo::clear_use_compression() {
   use_compression_ = false;
@@ -2506,6 +2738,186 @@ inline void OpInfo::set_use_compression(bool value) {
   // @@protoc_insertion_point(field_set:OpInfo.use_compression)
 }
 
+// uint32 stream_count = 100;
+inline void OpInfo::clear_stream_count() {
+  stream_count_ = 0u;
+}
+inline uint32_t OpInfo::_internal_stream_count() const {
+  return stream_count_;
+}
+inline uint32_t OpInfo::stream_count() const {
+  // @@protoc_insertion_point(field_get:OpInfo.stream_count)
+  return _internal_stream_count();
+}
+inline void OpInfo::_internal_set_stream_count(uint32_t value) {
+  
+  stream_count_ = value;
+}
+inline void OpInfo::set_stream_count(uint32_t value) {
+  _internal_set_stream_count(value);
+  // @@protoc_insertion_point(field_set:OpInfo.stream_count)
+}
+
+// uint32 stream_index = 101;
+inline void OpInfo::clear_stream_index() {
+  stream_index_ = 0u;
+}
+inline uint32_t OpInfo::_internal_stream_index() const {
+  return stream_index_;
+}
+inline uint32_t OpInfo::stream_index() const {
+  // @@protoc_insertion_point(field_get:OpInfo.stream_index)
+  return _internal_stream_index();
+}
+inline void OpInfo::_internal_set_stream_index(uint32_t value) {
+  
+  stream_index_ = value;
+}
+inline void OpInfo::set_stream_index(uint32_t value) {
+  _internal_set_stream_index(value);
+  // @@protoc_insertion_point(field_set:OpInfo.stream_index)
+}
+
+// uint64 manifest_hash = 102;
+inline void OpInfo::clear_manifest_hash() {
+  manifest_hash_ = uint64_t{0u};
+}
+inline uint64_t OpInfo::_internal_manifest_hash() const {
+  return manifest_hash_;
+}
+inline uint64_t OpInfo::manifest_hash() const {
+  // @@protoc_insertion_point(field_get:OpInfo.manifest_hash)
+  return _internal_manifest_hash();
+}
+inline void OpInfo::_internal_set_manifest_hash(uint64_t value) {
+  
+  manifest_hash_ = value;
+}
+inline void OpInfo::set_manifest_hash(uint64_t value) {
+  _internal_set_manifest_hash(value);
+  // @@protoc_insertion_point(field_set:OpInfo.manifest_hash)
+}
+
+// uint32 resume_entry = 104;
+inline void OpInfo::clear_resume_entry() {
+  resume_entry_ = 0u;
+}
+inline uint32_t OpInfo::_internal_resume_entry() const {
+  return resume_entry_;
+}
+inline uint32_t OpInfo::resume_entry() const {
+  // @@protoc_insertion_point(field_get:OpInfo.resume_entry)
+  return _internal_resume_entry();
+}
+inline void OpInfo::_internal_set_resume_entry(uint32_t value) {
+  
+  resume_entry_ = value;
+}
+inline void OpInfo::set_resume_entry(uint32_t value) {
+  _internal_set_resume_entry(value);
+  // @@protoc_insertion_point(field_set:OpInfo.resume_entry)
+}
+
+// uint64 resume_offset = 105;
+inline void OpInfo::clear_resume_offset() {
+  resume_offset_ = uint64_t{0u};
+}
+inline uint64_t OpInfo::_internal_resume_offset() const {
+  return resume_offset_;
+}
+inline uint64_t OpInfo::resume_offset() const {
+  // @@protoc_insertion_point(field_get:OpInfo.resume_offset)
+  return _internal_resume_offset();
+}
+inline void OpInfo::_internal_set_resume_offset(uint64_t value) {
+  
+  resume_offset_ = value;
+}
+inline void OpInfo::set_resume_offset(uint64_t value) {
+  _internal_set_resume_offset(value);
+  // @@protoc_insertion_point(field_set:OpInfo.resume_offset)
+}
+
+// bool verify_checksums = 106;
+inline void OpInfo::clear_verify_checksums() {
+  verify_checksums_ = false;
+}
+inline bool OpInfo::_internal_verify_checksums() const {
+  return verify_checksums_;
+}
+inline bool OpInfo::verify_checksums() const {
+  // @@protoc_insertion_point(field_get:OpInfo.verify_checksums)
+  return _internal_verify_checksums();
+}
+inline void OpInfo::_internal_set_verify_checksums(bool value) {
+  
+  verify_checksums_ = value;
+}
+inline void OpInfo::set_verify_checksums(bool value) {
+  _internal_set_verify_checksums(value);
+  // @@protoc_insertion_point(field_set:OpInfo.verify_checksums)
+}
+
+// bool streamed_deflate = 107;
+inline void OpInfo::clear_streamed_deflate() {
+  streamed_deflate_ = false;
+}
+inline bool OpInfo::_internal_streamed_deflate() const {
+  return streamed_deflate_;
+}
+inline bool OpInfo::streamed_deflate() const {
+  // @@protoc_insertion_point(field_get:OpInfo.streamed_deflate)
+  return _internal_streamed_deflate();
+}
+inline void OpInfo::_internal_set_streamed_deflate(bool value) {
+  
+  streamed_deflate_ = value;
+}
+inline void OpInfo::set_streamed_deflate(bool value) {
+  _internal_set_streamed_deflate(value);
+  // @@protoc_insertion_point(field_set:OpInfo.streamed_deflate)
+}
+
+// bool preset_dictionary = 108;
+inline void OpInfo::clear_preset_dictionary() {
+  preset_dictionary_ = false;
+}
+inline bool OpInfo::_internal_preset_dictionary() const {
+  return preset_dictionary_;
+}
+inline bool OpInfo::preset_dictionary() const {
+  // @@protoc_insertion_point(field_get:OpInfo.preset_dictionary)
+  return _internal_preset_dictionary();
+}
+inline void OpInfo::_internal_set_preset_dictionary(bool value) {
+  
+  preset_dictionary_ = value;
+}
+inline void OpInfo::set_preset_dictionary(bool value) {
+  _internal_set_preset_dictionary(value);
+  // @@protoc_insertion_point(field_set:OpInfo.preset_dictionary)
+}
+
+// bool solid_archive = 109;
+inline void OpInfo::clear_solid_archive() {
+  solid_archive_ = false;
+}
+inline bool OpInfo::_internal_solid_archive() const {
+  return solid_archive_;
+}
+inline bool OpInfo::solid_archive() const {
+  // @@protoc_insertion_point(field_get:OpInfo.solid_archive)
+  return _internal_solid_archive();
+}
+inline void OpInfo::_internal_set_solid_archive(bool value) {
+  
+  solid_archive_ = value;
+}
+inline void OpInfo::set_solid_archive(bool value) {
+  _internal_set_solid_archive(value);
+  // @@protoc_insertion_point(field_set:OpInfo.solid_archive)
+}
+
 // -------------------------------------------------------------------
 
 // StopInfo
@@ -3281,6 +3693,126 @@ inline void FileChunk::set_file_mode(uint32_t value) {
   // @@protoc_insertion_point(field_set:FileChunk.file_mode)
 }
 
+// uint32 entry_index = 100;
+inline void FileChunk::clear_entry_index() {
+  entry_index_ = 0u;
+}
+inline uint32_t FileChunk::_internal_entry_index() const {
+  return entry_index_;
+}
+inline uint32_t FileChunk::entry_index() const {
+  // @@protoc_insertion_point(field_get:FileChunk.entry_index)
+  return _internal_entry_index();
+}
+inline void FileChunk::_internal_set_entry_index(uint32_t value) {
+  
+  entry_index_ = value;
+}
+inline void FileChunk::set_entry_index(uint32_t value) {
+  _internal_set_entry_index(value);
+  // @@protoc_insertion_point(field_set:FileChunk.entry_index)
+}
+
+// uint64 file_size = 101;
+inline void FileChunk::clear_file_size() {
+  file_size_ = uint64_t{0u};
+}
+inline uint64_t FileChunk::_internal_file_size() const {
+  return file_size_;
+}
+inline uint64_t FileChunk::file_size() const {
+  // @@protoc_insertion_point(field_get:FileChunk.file_size)
+  return _internal_file_size();
+}
+inline void FileChunk::_internal_set_file_size(uint64_t value) {
+  
+  file_size_ = value;
+}
+inline void FileChunk::set_file_size(uint64_t value) {
+  _internal_set_file_size(value);
+  // @@protoc_insertion_point(field_set:FileChunk.file_size)
+}
+
+// fixed32 file_crc32c = 102;
+inline void FileChunk::clear_file_crc32c() {
+  file_crc32c_ = 0u;
+}
+inline uint32_t FileChunk::_internal_file_crc32c() const {
+  return file_crc32c_;
+}
+inline uint32_t FileChunk::file_crc32c() const {
+  // @@protoc_insertion_point(field_get:FileChunk.file_crc32c)
+  return _internal_file_crc32c();
+}
+inline void FileChunk::_internal_set_file_crc32c(uint32_t value) {
+  
+  file_crc32c_ = value;
+}
+inline void FileChunk::set_file_crc32c(uint32_t value) {
+  _internal_set_file_crc32c(value);
+  // @@protoc_insertion_point(field_set:FileChunk.file_crc32c)
+}
+
+// bool file_crc32c_set = 103;
+inline void FileChunk::clear_file_crc32c_set() {
+  file_crc32c_set_ = false;
+}
+inline bool FileChunk::_internal_file_crc32c_set() const {
+  return file_crc32c_set_;
+}
+inline bool FileChunk::file_crc32c_set() const {
+  // @@protoc_insertion_point(field_get:FileChunk.file_crc32c_set)
+  return _internal_file_crc32c_set();
+}
+inline void FileChunk::_internal_set_file_crc32c_set(bool value) {
+  
+  file_crc32c_set_ = value;
+}
+inline void FileChunk::set_file_crc32c_set(bool value) {
+  _internal_set_file_crc32c_set(value);
+  // @@protoc_insertion_point(field_set:FileChunk.file_crc32c_set)
+}
+
+// uint32 deflate_framing = 104;
+inline void FileChunk::clear_deflate_framing() {
+  deflate_framing_ = 0u;
+}
+inline uint32_t FileChunk::_internal_deflate_framing() const {
+  return deflate_framing_;
+}
+inline uint32_t FileChunk::deflate_framing() const {
+  // @@protoc_insertion_point(field_get:FileChunk.deflate_framing)
+  return _internal_deflate_framing();
+}
+inline void FileChunk::_internal_set_deflate_framing(uint32_t value) {
+  
+  deflate_framing_ = value;
+}
+inline void FileChunk::set_deflate_framing(uint32_t value) {
+  _internal_set_deflate_framing(value);
+  // @@protoc_insertion_point(field_set:FileChunk.deflate_framing)
+}
+
+// bool solid_batch = 105;
+inline void FileChunk::clear_solid_batch() {
+  solid_batch_ = false;
+}
+inline bool FileChunk::_internal_solid_batch() const {
+  return solid_batch_;
+}
+inline bool FileChunk::solid_batch() const {
+  // @@protoc_insertion_point(field_get:FileChunk.solid_batch)
+  return _internal_solid_batch();
+}
+inline void FileChunk::_internal_set_solid_batch(bool value) {
+  
+  solid_batch_ = value;
+}
+inline void FileChunk::set_solid_batch(bool value) {
+  _internal_set_solid_batch(value);
+  // @@protoc_insertion_point(field_set:FileChunk.solid_batch)
+}
+
 // -------------------------------------------------------------------
 
 // RegRequest
@@ -0,0 +1,249 @@
+#include "bandwidth_limiter.hpp"
+
+#include <algorithm>
+
+namespace srv
+{
+
+const long long TokenBucket::NANOS_PER_SECOND = 1000000000LL;
+
+const long long BandwidthLimiter::BURST_MILLIS = 250;
+const long long BandwidthLimiter::MIN_BURST_BYTES = 64 * 1024; // 64 kB
+
+TokenBucket::TokenBucket()
+    : m_rate( ATOMIC_VAR_INIT( 0 ) )
+    , m_burstNanos( ATOMIC_VAR_INIT( 0 ) )
+    , m_fullAt( ATOMIC_VAR_INIT( 0 ) )
+{
+}
+
+void TokenBucket::setRate( long long bytesPerSecond, long long burstBytes )
+{
+    long long rate = std::max( bytesPerSecond, 0LL );
+    long long burstNanos = 0;
+
+    if ( rate > 0 )
+    {
+        burstNanos = (long long)( (double)std::max( burstBytes, 1LL )
+            * NANOS_PER_SECOND / rate );
+    }
+
+    m_burstNanos = burstNanos;
+    m_rate = rate;
+
+    // Debt taken at the old rate doesn't carry over
+    m_fullAt = 0;
+}
+
+long long TokenBucket::getRate() const
+{
+    return m_rate;
+}
+
+std::chrono::nanoseconds TokenBucket::reserve( long long bytes )
+{
+    long long rate = m_rate.load( std::memory_order_relaxed );
+
+    if ( rate <= 0 || bytes <= 0 )
+    {
+        return std::chrono::nanoseconds( 0 );
+    }
+
+    long long cost = (long long)( (double)bytes * NANOS_PER_SECOND / rate );
+    long long burst = m_burstNanos.load( std::memory_order_relaxed );
+    long long now = getCurrentNanos();
+
+    long long fullAt = m_fullAt.load( std::memory_order_relaxed );
+    long long newFullAt;
+
+    do
+    {
+        // A bucket that has been idle is full, but never fuller than that
+        newFullAt = std::max( fullAt, now ) + cost;
+    } while ( !m_fullAt.compare_exchange_weak( fullAt, newFullAt ) );
+
+    return std::chrono::nanoseconds(
+        std::max( newFullAt - burst - now, 0LL ) );
+}
+
+long long TokenBucket::getCurrentNanos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch() )
+        .count();
+}
+
+BandwidthLimiter::BandwidthLimiter()
+    : m_globalRate( 0 )
+    , m_remoteRate( 0 )
+    , m_limitsVersion( 0 )
+    , m_wakeups( 0 )
+    , m_global()
+    , m_remotes()
+{
+}
+
+void BandwidthLimiter::setLimits( long long globalRate, long long remoteRate )
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    m_globalRate = std::max( globalRate, 0LL );
+    m_remoteRate = std::max( remoteRate, 0LL );
+
+    m_global.setRate( m_globalRate, getBurst( m_globalRate ) );
+
+    pruneRemotes();
+    for ( auto& pair : m_remotes )
+    {
+        if ( std::shared_ptr<TokenBucket> bucket = pair.second.lock() )
+        {
+            bucket->setRate( m_remoteRate, getBurst( m_remoteRate ) );
+        }
+    }
+
+    // Waits computed at the old rates no longer hold
+    m_limitsVersion++;
+    m_cond.notify_all();
+}
+
+long long BandwidthLimiter::getGlobalLimit()
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+    return m_globalRate;
+}
+
+long long BandwidthLimiter::getRemoteLimit()
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+    return m_remoteRate;
+}
+
+std::shared_ptr<TokenBucket> BandwidthLimiter::getRemoteBucket(
+    const std::string& remoteId )
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    pruneRemotes();
+
+    std::weak_ptr<TokenBucket>& entry = m_remotes[remoteId];
+    std::shared_ptr<TokenBucket> bucket = entry.lock();
+
+    if ( !bucket )
+    {
+        bucket = std::make_shared<TokenBucket>();
+        bucket->setRate( m_remoteRate, getBurst( m_remoteRate ) );
+        entry = bucket;
+    }
+
+    return bucket;
+}
+
+bool BandwidthLimiter::throttle( TokenBucket* remoteBucket, long long bytes,
+    const std::function<bool()>& shouldStop )
+{
+    using namespace std::chrono;
+
+    while ( bytes > 0 )
+    {
+        // Taken before reserving, so nothing that happens later is missed
+        std::unique_lock<std::mutex> lock( m_mtx );
+        long long limitsVersion = m_limitsVersion;
+        long long wakeups = m_wakeups;
+        lock.unlock();
+
+        nanoseconds wait = m_global.reserve( bytes );
+
+        if ( remoteBucket )
+        {
+            wait = std::max( wait, remoteBucket->reserve( bytes ) );
+        }
+
+        if ( wait.count() <= 0 )
+        {
+            return true;
+        }
+
+        if ( shouldStop && shouldStop() )
+        {
+            return false;
+        }
+
+        steady_clock::time_point deadline = steady_clock::now() + wait;
+        lock.lock();
+
+        while ( m_limitsVersion == limitsVersion )
+        {
+            bool woken = m_cond.wait_until( lock, deadline, [&]()
+                {
+                    return m_limitsVersion != limitsVersion
+                        || m_wakeups != wakeups;
+                } );
+
+            if ( m_limitsVersion != limitsVersion )
+            {
+                break;
+            }
+
+            if ( !woken )
+            {
+                return true;
+            }
+
+            wakeups = m_wakeups;
+
+            if ( shouldStop )
+            {
+                lock.unlock();
+                bool stop = shouldStop();
+                lock.lock();
+
+                if ( stop )
+                {
+                    return false;
+                }
+            }
+        }
+
+        // New limits dropped the debt, the part that hasn't been
+        // waited off yet is paid again at the new rates
+        long long left = duration_cast<nanoseconds>(
+            deadline - steady_clock::now() )
+                             .count();
+        bytes = left > 0
+            ? (long long)( (double)bytes * left / wait.count() )
+            : 0;
+    }
+
+    return true;
+}
+
+void BandwidthLimiter::interrupt()
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    m_wakeups++;
+    m_cond.notify_all();
+}
+
+void BandwidthLimiter::pruneRemotes()
+{
+    // Buckets go away with the last stream of their remote
+    for ( auto it = m_remotes.begin(); it != m_remotes.end(); )
+    {
+        if ( it->second.expired() )
+        {
+            it = m_remotes.erase( it );
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+long long BandwidthLimiter::getBurst( long long rate )
+{
+    return std::max( rate * BURST_MILLIS / 1000, MIN_BURST_BYTES );
+}
+
+};
@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace srv
+{
+
+// Token bucket kept as the moment it will be full again (GCRA), so taking
+// bytes out is a single compare-and-swap. Callers pay up front and sleep off
+// whatever exceeds the burst.
+class TokenBucket
+{
+public:
+    TokenBucket();
+
+    // Rate of 0 disables the limit
+    void setRate( long long bytesPerSecond, long long burstBytes );
+    long long getRate() const;
+
+    // Takes bytes out of the bucket, returns how long the caller
+    // has to wait before sending or receiving them
+    std::chrono::nanoseconds reserve( long long bytes );
+
+private:
+    static const long long NANOS_PER_SECOND;
+
+    std::atomic<long long> m_rate;
+    std::atomic<long long> m_burstNanos;
+    std::atomic<long long> m_fullAt;
+
+    static long long getCurrentNanos();
+};
+
+// Global budget shared by every transfer, plus a budget of its own
+// for each remote. Limits can be changed while transfers are running.
+class BandwidthLimiter
+{
+public:
+    BandwidthLimiter();
+
+    // Bytes per second, 0 means unlimited
+    void setLimits( long long globalRate, long long remoteRate );
+    long long getGlobalLimit();
+    long long getRemoteLimit();
+
+    // Streams look their bucket up once, chunks don't touch the map.
+    // A bucket lives as long as some stream of the remote holds it.
+    std::shared_ptr<TokenBucket> getRemoteBucket( const std::string& remoteId );
+
+    // Blocks until the bytes fit into both budgets. Changed limits cut
+    // the wait short, what's left is then paid at the new rates. Returns
+    // false if woken by interrupt while shouldStop says to give up.
+    bool throttle( TokenBucket* remoteBucket, long long bytes,
+        const std::function<bool()>& shouldStop = nullptr );
+
+    // Wakes every throttled thread, so it can check whether to stop
+    void interrupt();
+
+private:
+    static const long long BURST_MILLIS;
+    static const long long MIN_BURST_BYTES;
+
+    std::mutex m_mtx;
+    std::condition_variable m_cond;
+    long long m_globalRate;
+    long long m_remoteRate;
+    long long m_limitsVersion;
+    long long m_wakeups;
+
+    TokenBucket m_global;
+    std::map<std::string, std::weak_ptr<TokenBucket>> m_remotes;
+
+    void pruneRemotes();
+
+    static long long getBurst( long long rate );
+};
+
+};
@@ -0,0 +1,221 @@
+#include "chunk_ring.hpp"
+
+#include <algorithm>
+
+namespace srv
+{
+
+std::string* ChunkSlot::lendPayload( bool deflated, std::string& target )
+{
+    std::string* lentBuffer = nullptr;
+
+    if ( deflated )
+    {
+        // Already deflated by the processing stage
+        lentBuffer = &compressed;
+    }
+    else if ( !view && length == data.size() )
+    {
+        lentBuffer = &data;
+    }
+    else
+    {
+        target.assign( getPayload(), length );
+        return nullptr;
+    }
+
+    target.swap( *lentBuffer );
+    return lentBuffer;
+}
+
+void ChunkSlot::reclaimPayload( std::string* lentBuffer, std::string& target )
+{
+    // The slot gets its preallocated buffer back
+    if ( lentBuffer )
+    {
+        target.swap( *lentBuffer );
+    }
+}
+
+ChunkRing::ChunkRing( int depth, size_t chunkSize, bool withProcessingStage )
+    : m_slots( std::max( depth, 1 ) )
+    , m_chunkSize( chunkSize )
+    , m_processingStage( withProcessingStage )
+    , m_writeSeq( 0 )
+    , m_publishSeq( 0 )
+    , m_claimSeq( 0 )
+    , m_readSeq( 0 )
+    , m_used( 0 )
+    , m_closed( false )
+    , m_aborted( false )
+{
+    for ( ChunkSlot& slot : m_slots )
+    {
+        slot.kind = ChunkSlot::Kind::FILE_DATA;
+        slot.entry = -1;
+        slot.data.resize( chunkSize );
+        slot.length = 0;
+        slot.firstChunk = false;
+        slot.lastChunk = false;
+        slot.coalesce = false;
+        slot.fileMode = 0;
+        slot.checksum = 0;
+        slot.processed = false;
+    }
+}
+
+ChunkSlot* ChunkRing::acquireFree()
+{
+    std::unique_lock<std::mutex> lock( m_mtx );
+
+    m_freeCond.wait( lock, [this]()
+        { return m_aborted || m_used < m_slots.size(); } );
+
+    if ( m_aborted )
+    {
+        return nullptr;
+    }
+
+    ChunkSlot* slot = &m_slots[m_writeSeq % m_slots.size()];
+    m_writeSeq++;
+    m_used++;
+
+    slot->length = 0;
+    slot->firstChunk = false;
+    slot->lastChunk = false;
+    slot->coalesce = false;
+    slot->processed = false;
+
+    return slot;
+}
+
+void ChunkRing::publish( ChunkSlot* slot )
+{
+    {
+        std::lock_guard<std::mutex> lock( m_mtx );
+
+        // Without workers, there's nothing left to do with it
+        slot->processed = !m_processingStage;
+        m_publishSeq++;
+    }
+
+    if ( m_processingStage )
+    {
+        m_publishedCond.notify_one();
+    }
+    else
+    {
+        m_filledCond.notify_one();
+    }
+}
+
+void ChunkRing::close()
+{
+    {
+        std::lock_guard<std::mutex> lock( m_mtx );
+        m_closed = true;
+    }
+
+    m_publishedCond.notify_all();
+    m_filledCond.notify_all();
+}
+
+ChunkSlot* ChunkRing::acquireForProcessing()
+{
+    std::unique_lock<std::mutex> lock( m_mtx );
+
+    m_publishedCond.wait( lock, [this]()
+        { return m_aborted || m_closed || m_claimSeq < m_publishSeq; } );
+
+    if ( m_aborted || m_claimSeq == m_publishSeq )
+    {
+        return nullptr;
+    }
+
+    ChunkSlot* slot = &m_slots[m_claimSeq % m_slots.size()];
+    m_claimSeq++;
+
+    return slot;
+}
+
+void ChunkRing::markProcessed( ChunkSlot* slot )
+{
+    {
+        std::lock_guard<std::mutex> lock( m_mtx );
+        slot->processed = true;
+    }
+
+    // The consumer may be waiting for a different slot, so it has
+    // to re-check its condition
+    m_filledCond.notify_all();
+}
+
+ChunkSlot* ChunkRing::acquireFilled()
+{
+    std::unique_lock<std::mutex> lock( m_mtx );
+
+    m_filledCond.wait( lock, [this]()
+        {
+            return m_aborted || isNextFilledReady()
+                || ( m_closed && m_readSeq == m_publishSeq );
+        } );
+
+    if ( m_aborted || m_readSeq == m_publishSeq )
+    {
+        // Either cancelled or the producer has finished and we've drained
+        // everything it has published
+        return nullptr;
+    }
+
+    ChunkSlot* slot = &m_slots[m_readSeq % m_slots.size()];
+    m_readSeq++;
+
+    return slot;
+}
+
+void ChunkRing::release( ChunkSlot* slot )
+{
+    // Don't hold onto memory that isn't ours
+    slot->view = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock( m_mtx );
+        m_used--;
+    }
+
+    m_freeCond.notify_one();
+}
+
+void ChunkRing::abort()
+{
+    {
+        std::lock_guard<std::mutex> lock( m_mtx );
+        m_aborted = true;
+    }
+
+    m_freeCond.notify_all();
+    m_publishedCond.notify_all();
+    m_filledCond.notify_all();
+}
+
+int ChunkRing::getDepth() const
+{
+    return (int)m_slots.size();
+}
+
+size_t ChunkRing::getChunkSize() const
+{
+    return m_chunkSize;
+}
+
+bool ChunkRing::isNextFilledReady() const
+{
+    if ( m_readSeq >= m_publishSeq )
+    {
+        return false;
+    }
+
+    return m_slots[m_readSeq % m_slots.size()].processed;
+}
+
+};
@@ -0,0 +1,114 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace srv
+{
+
+// Element carried by a solid batch
+struct PackedEntry
+{
+    int entry;
+    size_t length;
+    uint32_t checksum;
+};
+
+struct ChunkSlot
+{
+    enum class Kind
+    {
+        FILE_DATA,
+        DIRECTORY,
+        SOLID_BATCH,
+        FAILURE
+    };
+
+    Kind kind;
+    int entry; // Index of the element in transfer's path list
+
+    std::string data; // Preallocated, never shrinks
+    std::shared_ptr<const char> view; // Used instead of data when set
+    size_t length;
+    std::string compressed; // Filled by the processing stage
+
+    bool firstChunk;
+    bool lastChunk;
+    bool coalesce; // May be buffered together with its neighbours
+    int fileMode;
+    uint32_t checksum; // CRC-32C of the whole file, set on its last chunk
+    std::vector<PackedEntry> packed; // Contents of a solid batch
+
+    bool processed;
+
+    const char* getPayload() const
+    {
+        return view ? view.get() : data.data();
+    }
+
+    // Hands the payload over to a message without copying it where it
+    // can. Tails of files are copied, regrowing the slot would cost more.
+    // Returns the lent buffer, to be given back by reclaimPayload.
+    std::string* lendPayload( bool deflated, std::string& target );
+    void reclaimPayload( std::string* lentBuffer, std::string& target );
+};
+
+// Bounded FIFO of reusable chunk buffers shared by exactly one producer
+// (disk reader) and one consumer (network writer). All buffers are allocated
+// up front, so memory usage of a transfer is capped at depth * chunkSize.
+//
+// Optionally, any number of workers may sit between the producer and the
+// consumer. They claim published slots in order, but may finish them
+// out of order - the consumer still receives slots in publishing order.
+class ChunkRing
+{
+public:
+    explicit ChunkRing( int depth, size_t chunkSize,
+        bool withProcessingStage = false );
+
+    // Producer side
+    ChunkSlot* acquireFree();
+    void publish( ChunkSlot* slot );
+    void close();
+
+    // Processing stage (worker threads)
+    ChunkSlot* acquireForProcessing();
+    void markProcessed( ChunkSlot* slot );
+
+    // Consumer side
+    ChunkSlot* acquireFilled();
+    void release( ChunkSlot* slot );
+
+    // Wakes up all sides, every subsequent acquire returns nullptr
+    void abort();
+
+    int getDepth() const;
+    size_t getChunkSize() const;
+
+private:
+    std::vector<ChunkSlot> m_slots;
+    size_t m_chunkSize;
+    bool m_processingStage;
+
+    std::mutex m_mtx;
+    std::condition_variable m_freeCond;
+    std::condition_variable m_publishedCond;
+    std::condition_variable m_filledCond;
+
+    // Monotonic sequence numbers, slot index is seq % depth
+    size_t m_writeSeq;
+    size_t m_publishSeq;
+    size_t m_claimSeq;
+    size_t m_readSeq;
+
+    size_t m_used;
+    bool m_closed;
+    bool m_aborted;
+
+    bool isNextFilledReady() const;
+};
+
+};
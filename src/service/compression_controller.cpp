@@ -0,0 +1,189 @@
+#include "compression_controller.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace srv
+{
+
+const double CompressionController::INCOMPRESSIBLE_ENTROPY = 7.5;
+const double CompressionController::EWMA_WEIGHT = 0.2;
+const double CompressionController::HEADROOM_FACTOR = 1.5;
+const size_t CompressionController::ENTROPY_SAMPLE_SIZE = 4096;
+const int CompressionController::MIN_SAMPLES = 4;
+
+CompressionController::CompressionController( int maxLevel, int workerCount )
+    : m_maxLevel( std::max( std::min( maxLevel, 9 ), 1 ) )
+    , m_workerCount( std::max( workerCount, 1 ) )
+    , m_currentLevel( m_maxLevel )
+    , m_compressRate( 0.0 )
+    , m_ratio( 1.0 )
+    , m_linkRate( 0.0 )
+    , m_compressSamples( 0 )
+    , m_linkSamples( 0 )
+{
+}
+
+int CompressionController::chooseLevel( const char* data, size_t length )
+{
+    // Too little data to judge, and not worth judging either
+    if ( length >= 256 && estimateEntropy( data, length ) > INCOMPRESSIBLE_ENTROPY )
+    {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> guard( m_mtx );
+    return m_currentLevel;
+}
+
+void CompressionController::reportCompressed( size_t inputBytes,
+    size_t outputBytes, double seconds )
+{
+    if ( inputBytes == 0 )
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    double rate = inputBytes / std::max( seconds, 1e-6 );
+    double ratio = (double)outputBytes / inputBytes;
+
+    m_compressRate = updateAverage( m_compressRate, rate, m_compressSamples );
+    m_ratio = updateAverage( m_ratio, ratio, m_compressSamples );
+    m_compressSamples++;
+
+    updateLevel();
+}
+
+void CompressionController::reportSent( size_t bytes, double seconds )
+{
+    if ( bytes == 0 )
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    double rate = bytes / std::max( seconds, 1e-6 );
+
+    m_linkRate = updateAverage( m_linkRate, rate, m_linkSamples );
+    m_linkSamples++;
+
+    updateLevel();
+}
+
+int CompressionController::getCurrentLevel()
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+    return m_currentLevel;
+}
+
+int CompressionController::getMaxLevel() const
+{
+    return m_maxLevel;
+}
+
+double CompressionController::estimateEntropy( const char* data,
+    size_t length )
+{
+    size_t histogram[256] = { 0 };
+    size_t total = 0;
+
+    if ( length <= ENTROPY_SAMPLE_SIZE )
+    {
+        for ( size_t i = 0; i < length; i++ )
+        {
+            histogram[(unsigned char)data[i]]++;
+        }
+        total = length;
+    }
+    else
+    {
+        // A few blocks spread evenly over the chunk are enough
+        const size_t blocks = 8;
+        const size_t blockSize = ENTROPY_SAMPLE_SIZE / blocks;
+        const size_t stride = ( length - blockSize ) / ( blocks - 1 );
+
+        for ( size_t b = 0; b < blocks; b++ )
+        {
+            const char* block = data + b * stride;
+            for ( size_t i = 0; i < blockSize; i++ )
+            {
+                histogram[(unsigned char)block[i]]++;
+            }
+        }
+        total = blocks * blockSize;
+    }
+
+    if ( total == 0 )
+    {
+        return 0.0;
+    }
+
+    double entropy = 0.0;
+    for ( size_t count : histogram )
+    {
+        if ( count > 0 )
+        {
+            double p = (double)count / total;
+            entropy -= p * std::log2( p );
+        }
+    }
+
+    return entropy;
+}
+
+void CompressionController::updateLevel()
+{
+    if ( m_compressSamples < MIN_SAMPLES || m_linkSamples < MIN_SAMPLES )
+    {
+        return;
+    }
+
+    // How fast source data leaves with and without compression
+    double compressRate = m_compressRate * m_workerCount;
+    double compressedRate = std::min( compressRate,
+        m_linkRate / std::max( m_ratio, 0.01 ) );
+
+    int newLevel = m_currentLevel;
+
+    if ( m_currentLevel > 0 && compressedRate < m_linkRate )
+    {
+        newLevel--;
+    }
+    else if ( m_currentLevel < m_maxLevel
+        && compressRate > compressedRate * HEADROOM_FACTOR )
+    {
+        // Compressors are idle most of the time, the link is what
+        // holds us back, so we can afford to squeeze harder
+        newLevel++;
+    }
+
+    if ( newLevel != m_currentLevel )
+    {
+        m_currentLevel = newLevel;
+
+        // Gather fresh measurements for the new level before moving again.
+        // Stored blocks aren't measured, so at level 0 we keep judging
+        // by the last known compressor speed.
+        m_linkSamples = 0;
+        if ( newLevel > 0 )
+        {
+            m_compressSamples = 0;
+        }
+    }
+}
+
+double CompressionController::updateAverage( double average, double sample,
+    int samples )
+{
+    if ( samples == 0 )
+    {
+        return sample;
+    }
+
+    return average + EWMA_WEIGHT * ( sample - average );
+}
+
+};
@@ -0,0 +1,57 @@
+#pragma once
+#include <mutex>
+#include <stddef.h>
+
+namespace srv
+{
+
+// Picks a zlib level for every outgoing chunk. Chunks that look random
+// (already compressed media, archives) are sent as stored deflate blocks,
+// for the rest the level is lowered whenever compressing is slower than
+// just pushing raw bytes through the link, and raised back when it's not.
+class CompressionController
+{
+public:
+    explicit CompressionController( int maxLevel, int workerCount = 1 );
+
+    int chooseLevel( const char* data, size_t length );
+
+    // Called by compressor threads after every chunk with level > 0
+    void reportCompressed( size_t inputBytes, size_t outputBytes,
+        double seconds );
+
+    // Called by the writer after every chunk handed to the network
+    void reportSent( size_t bytes, double seconds );
+
+    int getCurrentLevel();
+    int getMaxLevel() const;
+
+    // Shannon entropy in bits per byte, estimated from a sample of the data
+    static double estimateEntropy( const char* data, size_t length );
+
+private:
+    static const double INCOMPRESSIBLE_ENTROPY;
+    static const double EWMA_WEIGHT;
+    static const double HEADROOM_FACTOR;
+    static const size_t ENTROPY_SAMPLE_SIZE;
+    static const int MIN_SAMPLES;
+
+    std::mutex m_mtx;
+
+    int m_maxLevel;
+    int m_workerCount;
+    int m_currentLevel;
+
+    // Exponentially weighted averages
+    double m_compressRate; // Input bytes per second, single worker
+    double m_ratio; // Output size / input size
+    double m_linkRate; // Wire bytes per second
+
+    int m_compressSamples;
+    int m_linkSamples;
+
+    void updateLevel();
+    static double updateAverage( double average, double sample, int samples );
+};
+
+};
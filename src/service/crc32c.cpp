@@ -0,0 +1,180 @@
+#include "crc32c.hpp"
+
+#include <cstring>
+
+#if defined( _MSC_VER ) && defined( _M_X64 )
+#include <intrin.h>
+#include <nmmintrin.h>
+#define CRC32C_HARDWARE
+#define CRC32C_TARGET
+#elif defined( __GNUC__ ) && defined( __x86_64__ )
+#include <nmmintrin.h>
+#define CRC32C_HARDWARE
+#define CRC32C_TARGET __attribute__( ( target( "sse4.2" ) ) )
+#endif
+
+namespace srv
+{
+
+const uint32_t Crc32c::POLYNOMIAL = 0x82F63B78; // Reflected 0x1EDC6F41
+
+Crc32c::Crc32c()
+    : m_state( 0xFFFFFFFF )
+{
+}
+
+void Crc32c::reset()
+{
+    m_state = 0xFFFFFFFF;
+}
+
+void Crc32c::update( const char* data, size_t length )
+{
+    m_state = extend( m_state, data, length );
+}
+
+uint32_t Crc32c::getValue() const
+{
+    return ~m_state;
+}
+
+uint32_t Crc32c::compute( const char* data, size_t length )
+{
+    return ~extend( 0xFFFFFFFF, data, length );
+}
+
+uint32_t Crc32c::extend( uint32_t state, const char* data, size_t length )
+{
+    static const bool hardware = hasHardwareSupport();
+
+    if ( hardware )
+    {
+        return extendHardware( state, data, length );
+    }
+
+    return extendSoftware( state, data, length );
+}
+
+uint32_t Crc32c::extendSoftware( uint32_t state, const char* data,
+    size_t length )
+{
+    const uint32_t( &table )[8][256] = getTables();
+    const unsigned char* ptr = (const unsigned char*)data;
+
+    // Eight bytes per step, one table lookup for each of them
+    while ( length >= 8 )
+    {
+        uint32_t low, high;
+        memcpy( &low, ptr, 4 );
+        memcpy( &high, ptr + 4, 4 );
+        low ^= state;
+
+        state = table[7][low & 0xFF] ^ table[6][( low >> 8 ) & 0xFF]
+            ^ table[5][( low >> 16 ) & 0xFF] ^ table[4][low >> 24]
+            ^ table[3][high & 0xFF] ^ table[2][( high >> 8 ) & 0xFF]
+            ^ table[1][( high >> 16 ) & 0xFF] ^ table[0][high >> 24];
+
+        ptr += 8;
+        length -= 8;
+    }
+
+    while ( length > 0 )
+    {
+        state = table[0][( state ^ *ptr ) & 0xFF] ^ ( state >> 8 );
+        ptr++;
+        length--;
+    }
+
+    return state;
+}
+
+#ifdef CRC32C_HARDWARE
+
+CRC32C_TARGET uint32_t Crc32c::extendHardware( uint32_t state,
+    const char* data, size_t length )
+{
+    uint64_t state64 = state;
+
+    while ( length >= 8 )
+    {
+        uint64_t value;
+        memcpy( &value, data, 8 );
+        state64 = _mm_crc32_u64( state64, value );
+
+        data += 8;
+        length -= 8;
+    }
+
+    uint32_t state32 = (uint32_t)state64;
+
+    while ( length > 0 )
+    {
+        state32 = _mm_crc32_u8( state32, (unsigned char)*data );
+        data++;
+        length--;
+    }
+
+    return state32;
+}
+
+bool Crc32c::hasHardwareSupport()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid( info, 1 );
+    return ( info[2] & ( 1 << 20 ) ) != 0;
+#else
+    return __builtin_cpu_supports( "sse4.2" );
+#endif
+}
+
+#else
+
+uint32_t Crc32c::extendHardware( uint32_t state, const char* data,
+    size_t length )
+{
+    return extendSoftware( state, data, length );
+}
+
+bool Crc32c::hasHardwareSupport()
+{
+    return false;
+}
+
+#endif
+
+const uint32_t ( &Crc32c::getTables() )[8][256]
+{
+    struct Tables
+    {
+        uint32_t values[8][256];
+
+        Tables()
+        {
+            for ( uint32_t i = 0; i < 256; i++ )
+            {
+                uint32_t crc = i;
+                for ( int bit = 0; bit < 8; bit++ )
+                {
+                    crc = ( crc & 1 ) ? ( crc >> 1 ) ^ POLYNOMIAL : crc >> 1;
+                }
+                values[0][i] = crc;
+            }
+
+            // Table k advances a byte through k more zero bytes
+            for ( int k = 1; k < 8; k++ )
+            {
+                for ( int i = 0; i < 256; i++ )
+                {
+                    uint32_t prev = values[k - 1][i];
+                    values[k][i] = ( prev >> 8 ) ^ values[0][prev & 0xFF];
+                }
+            }
+        }
+    };
+
+    static const Tables tables;
+    return tables.values;
+}
+
+};
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace srv
+{
+
+// CRC-32C (Castagnoli), fed chunk by chunk as data streams through.
+// Uses the SSE 4.2 instruction where the CPU has it, slicing-by-8 tables
+// otherwise, so it stays well ahead of disk and network speed.
+class Crc32c
+{
+public:
+    Crc32c();
+
+    void reset();
+    void update( const char* data, size_t length );
+    uint32_t getValue() const;
+
+    static uint32_t compute( const char* data, size_t length );
+
+private:
+    static const uint32_t POLYNOMIAL;
+
+    uint32_t m_state; // Kept inverted between updates
+
+    static uint32_t extend( uint32_t state, const char* data, size_t length );
+    static uint32_t extendSoftware( uint32_t state, const char* data,
+        size_t length );
+    static uint32_t extendHardware( uint32_t state, const char* data,
+        size_t length );
+    static bool hasHardwareSupport();
+    static const uint32_t ( &getTables() )[8][256];
+};
+
+};
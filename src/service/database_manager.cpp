@@ -11,7 +11,7 @@
 namespace srv
 {
 
-const int DatabaseManager::TARGET_DB_VER = 3;
+const int DatabaseManager::TARGET_DB_VER = 6;
 
 DatabaseManager::DatabaseManager( const wxString& dbPath )
     : m_db( nullptr )
@@ -70,7 +70,10 @@ void DatabaseManager::setupUpdateFunctionVector()
     m_updFunctions = {
         std::bind( &DatabaseManager::updateFromVer0ToVer1, this ), // 0 -> 1
         std::bind( &DatabaseManager::updateFromVer1ToVer2, this ), // 1 -> 2
-        std::bind( &DatabaseManager::updateFromVer2ToVer3, this ) // 2 -> 3
+        std::bind( &DatabaseManager::updateFromVer2ToVer3, this ), // 2 -> 3
+        std::bind( &DatabaseManager::updateFromVer3ToVer4, this ), // 3 -> 4
+        std::bind( &DatabaseManager::updateFromVer4ToVer5, this ), // 4 -> 5
+        std::bind( &DatabaseManager::updateFromVer5ToVer6, this ) // 5 -> 6
     };
 }
 
@@ -230,6 +233,47 @@ bool DatabaseManager::updateFromVer2ToVer3()
     return results == SQLITE_OK;
 }
 
+bool DatabaseManager::updateFromVer3ToVer4()
+{
+    int results = 0;
+
+    UPD_EXEC( "CREATE TABLE IF NOT EXISTS transfer_journal("
+              "  target_id TEXT, "
+              "  manifest_hash INTEGER, "
+              "  entry_index INTEGER, "
+              "  element_type INTEGER, "
+              "  relative_path TEXT, "
+              "  bytes INTEGER, "
+              "  complete BOOLEAN, "
+              "  PRIMARY KEY( target_id, manifest_hash, entry_index )"
+              ");" );
+    UPD_EXEC( "UPDATE meta SET value=4 WHERE key='db_version';" );
+
+    return results == SQLITE_OK;
+}
+
+bool DatabaseManager::updateFromVer4ToVer5()
+{
+    int results = 0;
+
+    UPD_EXEC( "ALTER TABLE transfer_paths ADD COLUMN checksum INTEGER;" );
+    UPD_EXEC( "UPDATE meta SET value=5 WHERE key='db_version';" );
+
+    return results == SQLITE_OK;
+}
+
+bool DatabaseManager::updateFromVer5ToVer6()
+{
+    int results = 0;
+
+    // Older entries were written to temporary files, the default back then
+    UPD_EXEC( "ALTER TABLE transfer_journal ADD COLUMN in_place BOOLEAN "
+              "DEFAULT 0;" );
+    UPD_EXEC( "UPDATE meta SET value=6 WHERE key='db_version';" );
+
+    return results == SQLITE_OK;
+}
+
 // Data query and modification functions
 
 bool DatabaseManager::addTransfer( const db::Transfer& record )
@@ -280,8 +324,8 @@ bool DatabaseManager::addTransfer( const db::Transfer& record )
     sqlite3_stmt* pathStmt;
     sqlite3_prepare_v2( m_db,
         "INSERT INTO transfer_paths( transfer_id, element_name, "
-        "element_type, relative_path, absolute_path ) "
-        "VALUES ( ?, ?, ?, ?, ? );",
+        "element_type, relative_path, absolute_path, checksum ) "
+        "VALUES ( ?, ?, ?, ?, ?, ? );",
         -1, &pathStmt, NULL );
 
     for ( const db::TransferElement& element : record.elements )
@@ -297,6 +341,11 @@ bool DatabaseManager::addTransfer( const db::Transfer& record )
             element.relativePath.c_str(), -1, SQLITE_STATIC );
         sqlite3_bind_text16( pathStmt, 5,
             element.absolutePath.c_str(), -1, SQLITE_STATIC );
+        if ( element.checksum >= 0 )
+        {
+            sqlite3_bind_int64( pathStmt, 6,
+                (sqlite3_int64)element.checksum );
+        }
 
         results |= sqlite3_step( pathStmt );
         FIX_RESULTS( results );
@@ -493,6 +542,10 @@ void DatabaseManager::queryTransferPaths( db::Transfer& record )
             = (const wchar_t*)sqlite3_column_text16( pathStmt, 4 );
         pathRecord.absolutePath
             = (const wchar_t*)sqlite3_column_text16( pathStmt, 5 );
+        pathRecord.checksum
+            = sqlite3_column_type( pathStmt, 6 ) == SQLITE_NULL
+            ? -1
+            : sqlite3_column_int64( pathStmt, 6 );
 
         FIX_ENUM( pathRecord.elementType, db::TransferElementType::UNKNOWN );
 
@@ -621,6 +674,15 @@ bool DatabaseManager::removeTarget( const std::wstring& targetId )
     sqlite3_finalize( transferStmt );
     FIX_RESULTS( results );
 
+    sqlite3_stmt* journalStmt;
+    sqlite3_prepare_v2( m_db,
+        "DELETE FROM transfer_journal WHERE target_id=?",
+        -1, &journalStmt, NULL );
+    sqlite3_bind_text16( journalStmt, 1, targetId.c_str(), -1, SQLITE_STATIC );
+    results |= sqlite3_step( journalStmt );
+    sqlite3_finalize( journalStmt );
+    FIX_RESULTS( results );
+
     return endTransaction( results );
 }
 
@@ -653,6 +715,135 @@ bool DatabaseManager::removeAllTargets()
     sqlite3_finalize( transferStmt );
     FIX_RESULTS( results );
 
+    sqlite3_stmt* journalStmt;
+    sqlite3_prepare_v2( m_db, "DELETE FROM transfer_journal;",
+        -1, &journalStmt, NULL );
+    results |= sqlite3_step( journalStmt );
+    sqlite3_finalize( journalStmt );
+    FIX_RESULTS( results );
+
+    return endTransaction( results );
+}
+
+bool DatabaseManager::updateJournal( const std::vector<db::JournalEntry>& entries )
+{
+    std::lock_guard<std::mutex> guard( m_mutex );
+
+    if ( !m_dbOpen )
+    {
+        return false;
+    }
+
+    int results = 0;
+
+    // Whole batch goes in a single transaction, so it costs one sync
+    beginTransaction();
+
+    sqlite3_stmt* journalStmt;
+    sqlite3_prepare_v2( m_db,
+        "INSERT OR REPLACE INTO transfer_journal( target_id, manifest_hash, "
+        "entry_index, element_type, relative_path, bytes, complete, "
+        "in_place ) VALUES ( ?, ?, ?, ?, ?, ?, ?, ? );",
+        -1, &journalStmt, NULL );
+
+    for ( const db::JournalEntry& entry : entries )
+    {
+        sqlite3_reset( journalStmt );
+        sqlite3_clear_bindings( journalStmt );
+
+        sqlite3_bind_text16( journalStmt, 1,
+            entry.targetId.c_str(), -1, SQLITE_STATIC );
+        sqlite3_bind_int64( journalStmt, 2, (sqlite3_int64)entry.manifestHash );
+        sqlite3_bind_int( journalStmt, 3, entry.entryIndex );
+        sqlite3_bind_int( journalStmt, 4, (int)entry.elementType );
+        sqlite3_bind_text16( journalStmt, 5,
+            entry.relativePath.c_str(), -1, SQLITE_STATIC );
+        sqlite3_bind_int64( journalStmt, 6, (sqlite3_int64)entry.bytes );
+        sqlite3_bind_int( journalStmt, 7, entry.complete ? 1 : 0 );
+        sqlite3_bind_int( journalStmt, 8, entry.inPlace ? 1 : 0 );
+
+        results |= sqlite3_step( journalStmt );
+        FIX_RESULTS( results );
+    }
+
+    sqlite3_finalize( journalStmt );
+
+    return endTransaction( results );
+}
+
+std::vector<db::JournalEntry> DatabaseManager::queryJournal(
+    const std::wstring& targetId, unsigned long long manifestHash )
+{
+    std::lock_guard<std::mutex> guard( m_mutex );
+
+    if ( !m_dbOpen )
+    {
+        return {};
+    }
+
+    std::vector<db::JournalEntry> result;
+
+    sqlite3_stmt* journalStmt;
+    sqlite3_prepare_v2( m_db,
+        "SELECT entry_index, element_type, relative_path, bytes, complete, "
+        "in_place FROM transfer_journal WHERE target_id=? AND manifest_hash=? "
+        "ORDER BY entry_index;",
+        -1, &journalStmt, NULL );
+    sqlite3_bind_text16( journalStmt, 1, targetId.c_str(), -1, SQLITE_STATIC );
+    sqlite3_bind_int64( journalStmt, 2, (sqlite3_int64)manifestHash );
+
+    while ( sqlite3_step( journalStmt ) == SQLITE_ROW )
+    {
+        db::JournalEntry entry;
+        entry.targetId = targetId;
+        entry.manifestHash = manifestHash;
+        entry.entryIndex
+            = sqlite3_column_int( journalStmt, 0 );
+        entry.elementType
+            = (db::TransferElementType)sqlite3_column_int( journalStmt, 1 );
+        entry.relativePath
+            = (const wchar_t*)sqlite3_column_text16( journalStmt, 2 );
+        entry.bytes
+            = sqlite3_column_int64( journalStmt, 3 );
+        entry.complete
+            = (bool)sqlite3_column_int( journalStmt, 4 );
+        entry.inPlace
+            = (bool)sqlite3_column_int( journalStmt, 5 );
+
+        FIX_ENUM( entry.elementType, db::TransferElementType::UNKNOWN );
+
+        result.push_back( entry );
+    }
+
+    sqlite3_finalize( journalStmt );
+
+    return result;
+}
+
+bool DatabaseManager::clearJournal( const std::wstring& targetId,
+    unsigned long long manifestHash )
+{
+    std::lock_guard<std::mutex> guard( m_mutex );
+
+    if ( !m_dbOpen )
+    {
+        return false;
+    }
+
+    int results = 0;
+
+    beginTransaction();
+
+    sqlite3_stmt* journalStmt;
+    sqlite3_prepare_v2( m_db,
+        "DELETE FROM transfer_journal WHERE target_id=? AND manifest_hash=?;",
+        -1, &journalStmt, NULL );
+    sqlite3_bind_text16( journalStmt, 1, targetId.c_str(), -1, SQLITE_STATIC );
+    sqlite3_bind_int64( journalStmt, 2, (sqlite3_int64)manifestHash );
+    results |= sqlite3_step( journalStmt );
+    sqlite3_finalize( journalStmt );
+    FIX_RESULTS( results );
+
     return endTransaction( results );
 }
 
@@ -35,6 +35,12 @@ public:
     bool removeTarget( const std::wstring& targetId );
     bool removeAllTargets();
 
+    bool updateJournal( const std::vector<db::JournalEntry>& entries );
+    std::vector<db::JournalEntry> queryJournal( const std::wstring& targetId,
+        unsigned long long manifestHash );
+    bool clearJournal( const std::wstring& targetId,
+        unsigned long long manifestHash );
+
 private:
     static const int TARGET_DB_VER;
 
@@ -59,6 +65,9 @@ private:
     bool updateFromVer0ToVer1();
     bool updateFromVer1ToVer2();
     bool updateFromVer2ToVer3();
+    bool updateFromVer3ToVer4();
+    bool updateFromVer4ToVer5();
+    bool updateFromVer5ToVer6();
 };
 
 };
@@ -23,6 +23,7 @@ struct TransferElement
     std::wstring elementName; // File or folder name
     std::wstring relativePath; // Path relative to root of the transfer
     std::wstring absolutePath; // Absolute path of the element or empty
+    long long checksum = -1; // CRC-32C of a file's contents, -1 if not checked
 };
 
 enum class TransferStatus
@@ -75,6 +76,20 @@ struct TargetInfoData : public TargetInfo
     long long transferCount;
 };
 
+// Progress of a single element of an interrupted incoming transfer
+struct JournalEntry
+{
+    std::wstring targetId;
+    unsigned long long manifestHash;
+    int entryIndex;
+
+    TransferElementType elementType;
+    std::wstring relativePath;
+    long long bytes; // Bytes of the element known to be on disk
+    bool complete;
+    bool inPlace; // Written under its final name, not a temporary one
+};
+
 };
 
 };
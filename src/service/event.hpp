@@ -1,5 +1,6 @@
 #pragma once
 #include "../settings_model.hpp"
+#include "transfer_types.hpp"
 #include "../zeroconf/mdns_types.hpp"
 
 #include <wintoast/wintoastlib.h>
@@ -46,7 +47,7 @@ struct CrawlerOutputData
 {
     int jobId;
     std::wstring rootDir;
-    std::shared_ptr<std::vector<std::wstring>> paths;
+    std::shared_ptr<TransferManifest> manifest;
     std::vector<std::string> topDirBasenamesUtf8;
     long long totalSize;
     int folderCount;
@@ -8,8 +8,12 @@
 
 #include <algorithm>
 #include <functional>
+#include <set>
 
 #include "../thread_name.hpp"
+#include "unix_permissions.hpp"
+
+#include <Windows.h>
 
 namespace srv
 {
@@ -105,7 +109,7 @@ void FileCrawler::crawlJobMain( std::vector<std::wstring> paths, int jobId )
 
         std::sort( paths.begin(), paths.end() );
 
-        std::set<std::wstring> pathSet;
+        EntryMap entryMap;
         wxFileName location = wxFileName::DirName( root );
         wxFileName relativeLoc;
         long long totalSize = 0;
@@ -116,20 +120,20 @@ void FileCrawler::crawlJobMain( std::vector<std::wstring> paths, int jobId )
             {
                 findAndUnwindElement( 
                     wxFileName( path.substr( 0, path.size() - 1 ) ),
-                    location, relativeLoc, &pathSet, sendHidden, totalSize );
+                    location, relativeLoc, &entryMap, sendHidden, totalSize );
             }
             else
             {
                 findAndUnwindElement( wxFileName( path ),
-                    location, relativeLoc, &pathSet, sendHidden, totalSize );
+                    location, relativeLoc, &entryMap, sendHidden, totalSize );
             }
         }
 
-        auto pathVec = std::make_shared<std::vector<std::wstring>>();
-        pathVec->reserve( pathSet.size() );
-        for ( auto& path : pathSet )
+        auto manifest = std::make_shared<TransferManifest>();
+        manifest->reserve( entryMap.size() );
+        for ( auto& pair : entryMap )
         {
-            pathVec->push_back( path );
+            manifest->push_back( pair.second );
         }
 
         srv::Event successEvent;
@@ -138,14 +142,14 @@ void FileCrawler::crawlJobMain( std::vector<std::wstring> paths, int jobId )
             = std::make_shared<srv::CrawlerOutputData>();
         successEvent.eventData.crawlerOutputData->jobId = jobId; 
         successEvent.eventData.crawlerOutputData->rootDir = root;
-        successEvent.eventData.crawlerOutputData->paths = pathVec;
+        successEvent.eventData.crawlerOutputData->manifest = manifest;
         successEvent.eventData.crawlerOutputData->totalSize = totalSize;
 
         // Analyze top dir basenames
         std::set<wxString> topDirSet;
-        for ( const auto& path : *pathVec )
+        for ( const auto& entry : *manifest )
         {
-            wxString pathString( path );
+            wxString pathString( entry.relativePath );
             topDirSet.insert( pathString.BeforeFirst( L'\\' ) );
         }
 
@@ -156,14 +160,18 @@ void FileCrawler::crawlJobMain( std::vector<std::wstring> paths, int jobId )
             successEvent.eventData.crawlerOutputData
                 ->topDirBasenamesUtf8.push_back( std::string( path.ToUTF8() ) );
 
-            wxFileName pathName = wxFileName::DirName( root );
-            pathName.SetFullName( path );
+            // Top level elements are in the manifest as well
+            auto it = entryMap.find( path.ToStdWstring() );
+            if ( it == entryMap.end() )
+            {
+                continue;
+            }
 
-            if ( wxFileExists( pathName.GetFullPath() ) )
+            if ( it->second.type == FileType::REGULAR_FILE )
             {
                 fileCount++;
             }
-            else if ( wxDirExists( pathName.GetFullPath() ) )
+            else if ( it->second.type == FileType::DIRECTORY )
             {
                 folderCount++;
             }
@@ -260,8 +268,7 @@ wxFileName FileCrawler::pathToFileName( const wxString& path )
 
 void FileCrawler::findAndUnwindElement( wxFileName elementLoc,
     wxFileName& currentLocation, wxFileName& relativeLoc,
-    std::set<std::wstring>* paths, bool sendHidden,
-    long long& totalSize )
+    EntryMap* entries, bool sendHidden, long long& totalSize )
 {
     wxLogDebug( "FileCrawler: cur: %s rel: %s", 
         currentLocation.GetFullPath(), relativeLoc.GetFullPath() );
@@ -295,18 +302,25 @@ void FileCrawler::findAndUnwindElement( wxFileName elementLoc,
         currentLocation.AppendDir( dir );
         relativeLoc.AppendDir( dir );
 
-        paths->insert( relativeLoc.GetFullPath().RemoveLast().ToStdWstring() );
+        ManifestEntry entry;
+        entry.relativePath = relativeLoc.GetFullPath().RemoveLast().ToStdWstring();
+        entry.type = FileType::DIRECTORY;
+        entry.size = 0;
+        entry.mtime = 0;
+        entry.permClass = PermissionClass::DIRECTORY;
+
+        entries->emplace( entry.relativePath, entry );
     }
 
     currentLocation.AppendDir( elementLoc.GetFullName() );
     relativeLoc.AppendDir( elementLoc.GetFullName() );
 
     performFilesystemDFS( wxFileName::DirName( elementLoc.GetFullPath() ), 
-        relativeLoc, paths, sendHidden, totalSize );
+        relativeLoc, entries, sendHidden, totalSize );
 }
 
 void FileCrawler::performFilesystemDFS( wxFileName location, 
-    wxFileName relativeLoc, std::set<std::wstring>* paths, 
+    wxFileName relativeLoc, EntryMap* entries, 
     bool sendHidden, long long& totalSize, int recursionLevel )
 {
 #ifndef _DEBUG
@@ -321,11 +335,19 @@ void FileCrawler::performFilesystemDFS( wxFileName location,
         throw std::runtime_error( "max recursion depth exceeded!" );
     }
 
-    if ( location.DirExists() )
+    // One metadata query per element, everything the sender
+    // is going to need later is kept in the manifest
+    ManifestEntry entry;
+    if ( !statEntry( location.GetFullPath().RemoveLast(), entry ) )
     {
-        paths->insert( 
-            relativeLoc.GetFullPath().RemoveLast().ToStdWstring() );
+        return;
+    }
+
+    entry.relativePath = relativeLoc.GetFullPath().RemoveLast().ToStdWstring();
+    entries->emplace( entry.relativePath, entry );
 
+    if ( entry.type == FileType::DIRECTORY )
+    {
         totalSize += BLOCK_SIZE;
 
         int flags = wxDIR_FILES | wxDIR_DIRS | ( sendHidden ? wxDIR_HIDDEN : 0 );
@@ -350,18 +372,48 @@ void FileCrawler::performFilesystemDFS( wxFileName location,
                 newLocation.GetDirs()[newLocation.GetDirCount() - 1] );
 
             performFilesystemDFS( newLocation, newRelativeLoc, 
-                paths, sendHidden, totalSize, recursionLevel + 1 );
+                entries, sendHidden, totalSize, recursionLevel + 1 );
         }
     }
-    else if ( wxFileExists( location.GetFullPath().RemoveLast() ) )
+    else
+    {
+        totalSize += ceil( (long double)entry.size / BLOCK_SIZE ) * BLOCK_SIZE;
+    }
+}
+
+bool FileCrawler::statEntry( const wxString& path, ManifestEntry& entry )
+{
+    WIN32_FILE_ATTRIBUTE_DATA data;
+
+    if ( !GetFileAttributesExW( path.wc_str(), GetFileExInfoStandard, &data ) )
     {
-        paths->insert(
-            relativeLoc.GetFullPath().RemoveLast().ToStdWstring() );
+        return false;
+    }
+
+    ULARGE_INTEGER writeTime;
+    writeTime.LowPart = data.ftLastWriteTime.dwLowDateTime;
+    writeTime.HighPart = data.ftLastWriteTime.dwHighDateTime;
+
+    // FILETIME counts 100 ns intervals since 1601-01-01
+    entry.mtime = (std::time_t)( ( writeTime.QuadPart - 116444736000000000ULL )
+        / 10000000ULL );
 
-        wxFileName fname( location.GetFullPath().RemoveLast() );
-        totalSize += ceil( 
-            (long double)fname.GetSize().GetValue() / BLOCK_SIZE ) * BLOCK_SIZE;
+    if ( data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY )
+    {
+        entry.type = FileType::DIRECTORY;
+        entry.size = 0;
+        entry.permClass = PermissionClass::DIRECTORY;
     }
+    else
+    {
+        entry.type = FileType::REGULAR_FILE;
+        entry.size = ( (long long)data.nFileSizeHigh << 32 ) | data.nFileSizeLow;
+        entry.permClass = UnixPermissions::hasExecutableExtension( path.ToStdWstring() )
+            ? PermissionClass::EXECUTABLE
+            : PermissionClass::REGULAR;
+    }
+
+    return true;
 }
 
 };
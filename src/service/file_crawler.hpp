@@ -1,10 +1,11 @@
 #pragma once
+#include "transfer_types.hpp"
+
 #include <wx/filename.h>
 
 #include <map>
 #include <memory>
 #include <mutex>
-#include <set>
 #include <thread>
 #include <vector>
 
@@ -27,6 +28,8 @@ private:
     static const int MAX_RECURSION_DEPTH;
     static const long long BLOCK_SIZE;
 
+    typedef std::map<std::wstring, ManifestEntry> EntryMap;
+
     std::map<int, std::thread> m_jobs;
     std::mutex m_mtx;
     int m_lastJobId;
@@ -38,11 +41,11 @@ private:
     wxFileName pathToFileName( const wxString& path );
     void findAndUnwindElement( wxFileName elementLoc, 
         wxFileName& currentLocation, wxFileName& relativeLoc, 
-        std::set<std::wstring>* paths, bool sendHidden,
-        long long& totalSize );
+        EntryMap* entries, bool sendHidden, long long& totalSize );
     void performFilesystemDFS( wxFileName location, wxFileName relativeLoc,
-        std::set<std::wstring>* paths, bool sendHidden,
+        EntryMap* entries, bool sendHidden,
         long long& totalSize, int recursionLevel = 0 );
+    bool statEntry( const wxString& path, ManifestEntry& entry );
 };
 
 };
@@ -1,10 +1,15 @@
 #include "file_sender.hpp"
 
+#include "../thread_name.hpp"
 #include "database_types.hpp"
 
 #include <wx/filename.h>
 #include <wx/log.h>
 
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
 #ifdef _DEBUG
 #define WXLOGNULL wxLogNull __lognull
 #else
@@ -14,22 +19,47 @@
 namespace srv
 {
 
-const long long FileSender::PROGRESS_FREQ_MILLIS = 250;
 const long long FileSender::FILE_CHUNK_SIZE = 1024 * 1024; // 1 MB
-const std::vector<std::wstring> FileSender::EXECUTABLE_EXTENSIONS = {
-    L"py",
-    L"sh"
-};
+const int FileSender::MIN_READ_AHEAD_DEPTH = 2;
+const int FileSender::MAX_COMPRESSION_THREADS = 16;
+const long long FileSender::MMAP_WINDOW_CHUNKS = 32;
+const long long FileSender::SMALL_FILE_SIZE = 64 * 1024; // 64 kB
+const size_t FileSender::COALESCE_MAX_BYTES = 512 * 1024; // 512 kB
+const int FileSender::COALESCE_MAX_MESSAGES = 256;
+const int FileSender::DICTIONARY_SAMPLE_FILES = 64;
+const int FileSender::MIN_DICTIONARY_SAMPLES = 4;
+const long long FileSender::DICTIONARY_SAMPLE_SIZE = 4 * 1024; // 4 kB
 
 FileSender::FileSender( std::shared_ptr<TransferOp> transfer,
     grpc::ServerWriter<FileChunk>* writer )
     : m_transfer( transfer )
     , m_writer( writer )
+    , m_compressLvl( 0 )
+    , m_readAheadDepth( 8 )
+    , m_compressThreads( 0 )
+    , m_adaptiveCompress( false )
+    , m_mmapThreshold( 0 )
+    , m_shardIndex( 0 )
+    , m_shardCount( 1 )
+    , m_resume()
+    , m_checksums( false )
+    , m_streamedDeflate( false )
+    , m_streamLevel( 0 )
+    , m_presetDictionary( false )
+    , m_dictionary()
+    , m_solidArchive( false )
+    , m_limiter( nullptr )
+    , m_remoteBucket( nullptr )
+    , m_progress( nullptr )
     , m_filePerms()
     , m_execPerms()
     , m_dirPerms()
-    , m_compressLvl( 0 )
-    , m_compressor()
+    , m_ring( nullptr )
+    , m_controller( nullptr )
+    , m_batchSlot( nullptr )
+    , m_batch()
+    , m_coalescedBytes( 0 )
+    , m_coalescedCount( 0 )
 {
 }
 
@@ -43,6 +73,94 @@ int FileSender::getCompressionLevel() const
     return m_compressLvl;
 }
 
+void FileSender::setReadAheadDepth( int chunks )
+{
+    m_readAheadDepth = std::max( chunks, MIN_READ_AHEAD_DEPTH );
+}
+
+int FileSender::getReadAheadDepth() const
+{
+    return m_readAheadDepth;
+}
+
+void FileSender::setCompressionThreads( int threads )
+{
+    m_compressThreads = std::max( std::min( threads, MAX_COMPRESSION_THREADS ), 0 );
+}
+
+int FileSender::getCompressionThreads() const
+{
+    return m_compressThreads;
+}
+
+void FileSender::setAdaptiveCompression( bool adaptive )
+{
+    m_adaptiveCompress = adaptive;
+}
+
+bool FileSender::getAdaptiveCompression() const
+{
+    return m_adaptiveCompress;
+}
+
+void FileSender::setMemoryMapThreshold( long long bytes )
+{
+    m_mmapThreshold = bytes;
+}
+
+long long FileSender::getMemoryMapThreshold() const
+{
+    return m_mmapThreshold;
+}
+
+void FileSender::setShard( int index, int count )
+{
+    m_shardCount = std::max( count, 1 );
+    m_shardIndex = std::max( std::min( index, m_shardCount - 1 ), 0 );
+}
+
+int FileSender::getShardIndex() const
+{
+    return m_shardIndex;
+}
+
+int FileSender::getShardCount() const
+{
+    return m_shardCount;
+}
+
+void FileSender::setResumePoint( const ResumePoint& point )
+{
+    m_resume = point;
+}
+
+void FileSender::setComputeChecksums( bool compute )
+{
+    m_checksums = compute;
+}
+
+void FileSender::setStreamedDeflate( bool streamed )
+{
+    m_streamedDeflate = streamed;
+}
+
+void FileSender::setPresetDictionary( bool enabled )
+{
+    m_presetDictionary = enabled;
+}
+
+void FileSender::setSolidArchive( bool enabled )
+{
+    m_solidArchive = enabled;
+}
+
+void FileSender::setBandwidthLimiter( std::shared_ptr<BandwidthLimiter> limiter,
+    const std::string& remoteId )
+{
+    m_limiter = limiter;
+    m_remoteBucket = limiter ? limiter->getRemoteBucket( remoteId ) : nullptr;
+}
+
 void FileSender::setUnixPermissionMasks( int file, int executable, int directory )
 {
     m_filePerms.loadFromChmod( file );
@@ -65,156 +183,953 @@ int FileSender::getUnixDirectoryPermissionMask()
     return m_dirPerms.convertToChmod();
 }
 
-bool FileSender::transferFiles( std::function<void()> onUpdate )
+bool FileSender::transferFiles()
 {
-    int size = m_transfer->intern.relativePaths->size();
+    int compressThreads = 0;
+    int depth = m_readAheadDepth;
+
+    if ( m_compressLvl > 0 )
+    {
+        // Every worker needs a chunk of its own to stay busy, on top
+        // of the ones being read and written
+        compressThreads = getEffectiveCompressionThreads();
+
+        // A file's stream has to see its chunks in order
+        if ( m_streamedDeflate )
+        {
+            compressThreads = 1;
+        }
+
+        depth = std::max( depth, compressThreads + MIN_READ_AHEAD_DEPTH );
+
+        if ( m_adaptiveCompress )
+        {
+            m_controller = std::make_unique<CompressionController>(
+                m_compressLvl, compressThreads );
+        }
+
+        // Packed files are deflated together, the dictionary
+        // wouldn't have much left to add
+        if ( m_presetDictionary && !m_solidArchive )
+        {
+            buildDictionary();
+        }
+    }
+
+    m_ring = std::make_unique<ChunkRing>( depth, FILE_CHUNK_SIZE,
+        compressThreads > 0 );
+
+    {
+        std::lock_guard<std::mutex> transferLock( *m_transfer->mutex );
+        m_progress = m_transfer->intern.progress;
+    }
+
+    updateProgress( getResumedBytes() );
+
+    // Disk reads happen on a separate thread, so that the next chunks
+    // are already in memory while we're blocked on network writes
+    std::thread reader( std::bind( &FileSender::readerMain, this ) );
+
+    std::vector<std::thread> compressors;
+    for ( int i = 0; i < compressThreads; i++ )
+    {
+        compressors.emplace_back( std::bind( &FileSender::compressorMain, this ) );
+    }
+
+    bool result = sendDictionary() && writeQueuedChunks();
+
+    // If we gave up early, the reader may be waiting for a free slot
+    m_ring->abort();
+    reader.join();
+    for ( std::thread& compressor : compressors )
+    {
+        compressor.join();
+    }
+    m_ring = nullptr;
+    m_controller = nullptr;
+
+    // Final progress update is up to the caller, since other streams
+    // of the op may still be running
+    return result;
+}
+
+std::vector<int> FileSender::getShardEntries() const
+{
+    const TransferManifest& manifest = *m_transfer->intern.manifest;
+    std::vector<int> entries;
+
+    if ( m_shardCount == 1 )
+    {
+        for ( int i = 0; i < (int)manifest.size(); i++ )
+        {
+            entries.push_back( i );
+        }
+
+        return entries;
+    }
+
+    // Every stream computes the split on its own, so it has to be
+    // deterministic. Directories stay together on the first stream to keep
+    // their order, files are handed out biggest first to the least loaded one.
+    std::vector<int> files;
+    for ( int i = 0; i < (int)manifest.size(); i++ )
+    {
+        if ( manifest[i].type != FileType::DIRECTORY )
+        {
+            files.push_back( i );
+        }
+        else if ( m_shardIndex == 0 )
+        {
+            entries.push_back( i );
+        }
+    }
+
+    std::stable_sort( files.begin(), files.end(), [&manifest]( int a, int b )
+        { return manifest[a].size > manifest[b].size; } );
+
+    std::vector<long long> load( m_shardCount, 0 );
+    for ( int file : files )
+    {
+        int shard = (int)( std::min_element( load.begin(), load.end() )
+            - load.begin() );
+
+        // Empty files still cost a round of messages
+        load[shard] += std::max( manifest[file].size, 1LL );
+
+        if ( shard == m_shardIndex )
+        {
+            entries.push_back( file );
+        }
+    }
+
+    std::sort( entries.begin(), entries.end() );
+
+    return entries;
+}
+
+long long FileSender::getResumedBytes() const
+{
+    if ( m_resume.isEmpty() )
+    {
+        return 0;
+    }
+
+    const TransferManifest& manifest = *m_transfer->intern.manifest;
+    long long bytes = 0;
+
+    for ( int entry : getShardEntries() )
+    {
+        if ( m_resume.isCompleted( entry ) )
+        {
+            bytes += manifest[entry].size;
+        }
+        else
+        {
+            bytes += std::min( m_resume.getStartOffset( entry ),
+                manifest[entry].size );
+        }
+    }
+
+    return bytes;
+}
+
+void FileSender::readerMain()
+{
+    setThreadName( "FileSender reader" );
+
     std::wstring root = m_transfer->intern.rootDir;
 
-    for ( int i = 0; i < size; i++ )
+    for ( int entry : getShardEntries() )
     {
         if ( checkOpFailed() )
         {
-            return false;
+            break;
         }
 
-        if ( !sendSingleEntity( root,
-                 m_transfer->intern.relativePaths->at( i ), onUpdate ) )
+        if ( m_resume.isCompleted( entry ) )
         {
-            return false;
+            continue;
+        }
+
+        if ( !readSingleEntity( root, entry ) )
+        {
+            break;
         }
     }
 
-    updateProgress( -1, onUpdate );
-    return true;
+    flushSolidBatch();
+    m_ring->close();
 }
 
-bool FileSender::sendSingleEntity( const std::wstring& root,
-    const std::wstring& relativePath, std::function<void()>& onUpdate )
+bool FileSender::readSingleEntity( const std::wstring& root, int entry )
 {
-    wxString fullPath = root + "\\" + relativePath;
+    // Type and size come from the crawler, so the filesystem
+    // doesn't have to be asked again
+    const ManifestEntry& element = m_transfer->intern.manifest->at( entry );
+    std::wstring fullPath = root + L"\\" + element.relativePath;
 
-    if ( wxFileExists( fullPath ) )
+    if ( m_solidArchive && isPackable( entry ) )
     {
-        return sendSingleFile( root, relativePath, onUpdate );
+        return packSingleEntity( fullPath, entry );
+    }
+
+    // Whatever was packed so far goes out first, so the receiver
+    // still gets elements in order
+    flushSolidBatch();
+
+    if ( element.type == FileType::REGULAR_FILE )
+    {
+        long long startOffset = std::min( m_resume.getStartOffset( entry ),
+            element.size );
+
+        if ( shouldMapFile( fullPath, element ) )
+        {
+            return readMappedFile( fullPath, entry, startOffset );
+        }
+
+        return readSingleFile( fullPath, entry, startOffset );
     }
-    else if ( wxDirExists( fullPath ) )
+    else if ( element.type == FileType::DIRECTORY )
     {
-        return sendSingleDirectory( root, relativePath, onUpdate );
+        readSingleDirectory( entry );
+        return true;
     }
 
+    publishFailure( entry );
     return false;
 }
 
-bool FileSender::sendSingleFile( const std::wstring& root,
-    const std::wstring& relativePath, std::function<void()>& onUpdate )
+bool FileSender::readSingleFile( const std::wstring& fullPath, int entry,
+    long long startOffset )
 {
-    wxString relativePathStr = relativePath;
-    relativePathStr.Replace( '\\', '/' );
-    wxLogDebug( "FileSender: Sending file %s", relativePathStr );
-
     WXLOGNULL;
 
-    wxString fullPath = root + "\\" + relativePath;
     wxFile file( fullPath, wxFile::read );
 
-    if ( !file.IsOpened() )
+    if ( !file.IsOpened()
+        || ( startOffset > 0 && file.Seek( startOffset ) == wxInvalidOffset ) )
     {
+        publishFailure( entry );
         return false;
     }
 
-    int readCount = 0;
-    bool contentsDetermined = false;
-    UnixPermissions permissions;
+    const ManifestEntry& element = m_transfer->intern.manifest->at( entry );
+    const bool smallFile = element.size <= SMALL_FILE_SIZE;
+
+    bool firstChunk = true;
+    bool reachedEnd = false;
+    int fileMode = 0;
+    ssize_t readCount = 0;
+    Crc32c checksum;
+
     do
     {
-        std::unique_ptr<char[]> buf = std::make_unique<char[]>( FILE_CHUNK_SIZE );
-        readCount = file.Read( buf.get(), FILE_CHUNK_SIZE );
+        ChunkSlot* slot = m_ring->acquireFree();
 
-        std::string data( buf.get(), readCount );
+        if ( !slot )
+        {
+            // Writer has stopped
+            return false;
+        }
 
-        if ( !contentsDetermined )
+        if ( reachedEnd )
         {
-            if ( isFileExecutable( data, relativePath ) )
-            {
-                permissions = m_execPerms;
-            }
-            else
+            // Small files are read in one go, no need to ask for EOF
+            readCount = 0;
+        }
+        else
+        {
+            readCount = file.Read( &slot->data[0], m_ring->getChunkSize() );
+            reachedEnd = smallFile && readCount >= 0
+                && readCount < (ssize_t)m_ring->getChunkSize();
+        }
+
+        if ( readCount == wxInvalidOffset )
+        {
+            slot->kind = ChunkSlot::Kind::FAILURE;
+            slot->entry = entry;
+            m_ring->publish( slot );
+            return false;
+        }
+
+        if ( firstChunk )
+        {
+            fileMode = getFileMode( element, slot->data.data(), readCount );
+        }
+
+        // Computed here, so it runs alongside the network writes
+        if ( m_checksums )
+        {
+            checksum.update( slot->data.data(), readCount );
+        }
+
+        slot->kind = ChunkSlot::Kind::FILE_DATA;
+        slot->entry = entry;
+        slot->length = readCount;
+        slot->fileMode = fileMode;
+        slot->firstChunk = firstChunk;
+        slot->lastChunk = readCount == 0;
+        slot->coalesce = smallFile;
+        slot->checksum = checksum.getValue();
+
+        m_ring->publish( slot );
+        firstChunk = false;
+    } while ( readCount > 0 );
+
+    return true;
+}
+
+bool FileSender::shouldMapFile( const std::wstring& fullPath,
+    const ManifestEntry& element )
+{
+    // Windows are made of whole chunks, so chunks have to start
+    // at offsets the system is able to map
+    if ( m_mmapThreshold <= 0
+        || FILE_CHUNK_SIZE % MappedFile::getAllocationGranularity() != 0 )
+    {
+        return false;
+    }
+
+    return element.size >= m_mmapThreshold
+        && MappedFile::isMappable( fullPath );
+}
+
+bool FileSender::readMappedFile( const std::wstring& fullPath, int entry,
+    long long startOffset )
+{
+    MappedFile file;
+
+    if ( !file.open( fullPath ) )
+    {
+        publishFailure( entry );
+        return false;
+    }
+
+    const ManifestEntry& element = m_transfer->intern.manifest->at( entry );
+
+    const long long mappedSize = file.getSize();
+    const long long chunkSize = m_ring->getChunkSize();
+    long long fileSize = mappedSize;
+
+    std::shared_ptr<const char> window;
+    long long windowOffset = 0;
+    long long windowLength = 0;
+
+    const long long granularity = MappedFile::getAllocationGranularity();
+
+    bool firstChunk = true;
+    int fileMode = 0;
+    long long offset = startOffset;
+    size_t length = 0;
+    Crc32c checksum;
+
+    do
+    {
+        if ( offset >= fileSize )
+        {
+            // Writers aren't locked out, the file may have grown since.
+            // The rest is read like any other file.
+            fileSize = std::max( file.querySize(), offset );
+        }
+
+        length = (size_t)std::min( chunkSize, fileSize - offset );
+        bool mapped = length > 0
+            && offset + (long long)length <= mappedSize;
+
+        if ( mapped && offset + length > windowOffset + windowLength )
+        {
+            // Previous window gets unmapped once the writer is done
+            // with all of the chunks pointing into it. Resumed files
+            // don't have to continue at a mappable offset.
+            windowOffset = offset - offset % granularity;
+            windowLength = std::min( chunkSize * MMAP_WINDOW_CHUNKS,
+                mappedSize - windowOffset );
+            window = file.mapWindow( windowOffset, (size_t)windowLength );
+
+            if ( !window )
             {
-                permissions = m_filePerms;
+                publishFailure( entry );
+                return false;
             }
+        }
+
+        ChunkSlot* slot = m_ring->acquireFree();
 
-            contentsDetermined = true;
+        if ( !slot )
+        {
+            // Writer has stopped
+            return false;
         }
 
-        FileChunk fileChunk;
+        const char* payload = mapped
+            ? window.get() + ( offset - windowOffset )
+            : nullptr;
 
-        if ( m_compressLvl > 0 )
+        // Pages are brought in here, so the threads compressing and
+        // sending the chunk don't fault on them. If the system can't
+        // read them, the chunk is read without the view.
+        if ( mapped && MappedFile::touch( payload, length ) )
         {
-            fileChunk.set_chunk( m_compressor.compress( data, m_compressLvl ) );
+            slot->view = std::shared_ptr<const char>( window, payload );
         }
-        else
+        else if ( length > 0 && !file.read( offset, &slot->data[0], length ) )
         {
-            fileChunk.set_chunk( data );
+            slot->kind = ChunkSlot::Kind::FAILURE;
+            slot->entry = entry;
+            m_ring->publish( slot );
+            return false;
+        }
+
+        if ( firstChunk )
+        {
+            fileMode = getFileMode( element, slot->getPayload(), length );
         }
 
-        fileChunk.set_relative_path( relativePathStr.ToUTF8() );
-        fileChunk.set_file_type( (int)FileType::REGULAR_FILE );
-        fileChunk.set_symlink_target( "" );
-        fileChunk.set_file_mode( permissions.convertToDecimal() );
+        if ( m_checksums )
+        {
+            checksum.update( slot->getPayload(), length );
+        }
 
-        waitIfPaused();
+        slot->kind = ChunkSlot::Kind::FILE_DATA;
+        slot->entry = entry;
+        slot->length = length;
+        slot->fileMode = fileMode;
+        slot->firstChunk = firstChunk;
+        slot->lastChunk = length == 0;
+        slot->checksum = checksum.getValue();
 
-        m_writer->Write( fileChunk );
+        m_ring->publish( slot );
+        firstChunk = false;
+        offset += length;
+    } while ( length > 0 );
 
-        if ( readCount > 0 )
+    return true;
+}
+
+void FileSender::readSingleDirectory( int entry )
+{
+    ChunkSlot* slot = m_ring->acquireFree();
+
+    if ( slot )
+    {
+        slot->kind = ChunkSlot::Kind::DIRECTORY;
+        slot->entry = entry;
+        slot->coalesce = true;
+        slot->fileMode = m_dirPerms.convertToDecimal();
+        m_ring->publish( slot );
+    }
+}
+
+bool FileSender::isPackable( int entry ) const
+{
+    const ManifestEntry& element = m_transfer->intern.manifest->at( entry );
+
+    if ( element.type == FileType::DIRECTORY )
+    {
+        return true;
+    }
+
+    // Even the longest path leaves room for a small file in a batch.
+    // Resumed files continue in chunks of their own.
+    return element.type == FileType::REGULAR_FILE
+        && element.size <= SMALL_FILE_SIZE
+        && m_resume.getStartOffset( entry ) == 0;
+}
+
+bool FileSender::packSingleEntity( const std::wstring& fullPath, int entry )
+{
+    WXLOGNULL;
+
+    const ManifestEntry& element = m_transfer->intern.manifest->at( entry );
+    const bool directory = element.type == FileType::DIRECTORY;
+
+    wxString relativePathStr = element.relativePath;
+    relativePathStr.Replace( '\\', '/' );
+    std::string relativePath = relativePathStr.ToUTF8().data();
+
+    size_t dataLength = directory ? 0 : (size_t)element.size;
+
+    wxFile file;
+    if ( !directory
+        && !file.Open( fullPath, wxFile::read ) )
+    {
+        flushSolidBatch();
+        publishFailure( entry );
+        return false;
+    }
+
+    if ( m_batchSlot && !m_batch.fits( relativePath.size(), dataLength ) )
+    {
+        flushSolidBatch();
+    }
+
+    if ( !m_batchSlot )
+    {
+        m_batchSlot = m_ring->acquireFree();
+
+        if ( !m_batchSlot )
         {
-            updateProgress( readCount, onUpdate );
+            // Writer has stopped
+            return false;
         }
-    } while ( readCount > 0 );
 
-    db::TransferElement record;
-    record.elementType = db::TransferElementType::FILE;
-    record.relativePath = relativePathStr.ToStdWstring();
-    if ( root[root.size() - 1] == '\\' )
+        m_batchSlot->kind = ChunkSlot::Kind::SOLID_BATCH;
+        m_batchSlot->entry = entry;
+        m_batchSlot->packed.clear();
+        m_batch.reset( &m_batchSlot->data[0], m_batchSlot->data.size() );
+    }
+
+    // Files are read straight into the batch. One that has grown since
+    // it was crawled is cut at the size the receiver was told about.
+    char* data = m_batch.beginRecord( entry, element.type, relativePath );
+    ssize_t readCount = dataLength > 0 ? file.Read( data, dataLength ) : 0;
+
+    if ( readCount == wxInvalidOffset )
     {
-        record.absolutePath = root + relativePath;
+        flushSolidBatch();
+        publishFailure( entry );
+        return false;
+    }
+
+    int fileMode = directory ? m_dirPerms.convertToDecimal()
+                             : getFileMode( element, data, readCount );
+    uint32_t checksum = m_checksums && !directory
+        ? Crc32c::compute( data, readCount )
+        : 0;
+
+    m_batch.endRecord( fileMode, readCount, m_checksums && !directory,
+        checksum );
+    m_batchSlot->packed.push_back( { entry, (size_t)readCount, checksum } );
+
+    return true;
+}
+
+void FileSender::flushSolidBatch()
+{
+    if ( !m_batchSlot )
+    {
+        return;
+    }
+
+    m_batchSlot->length = m_batch.getSize();
+    m_ring->publish( m_batchSlot );
+    m_batchSlot = nullptr;
+}
+
+void FileSender::publishFailure( int entry )
+{
+    ChunkSlot* slot = m_ring->acquireFree();
+
+    if ( slot )
+    {
+        slot->kind = ChunkSlot::Kind::FAILURE;
+        slot->entry = entry;
+        m_ring->publish( slot );
+    }
+}
+
+int FileSender::getEffectiveCompressionThreads() const
+{
+    if ( m_compressThreads > 0 )
+    {
+        return m_compressThreads;
+    }
+
+    int cores = (int)std::thread::hardware_concurrency();
+    return std::max( std::min( cores, MAX_COMPRESSION_THREADS ), 1 );
+}
+
+void FileSender::compressorMain()
+{
+    setThreadName( "FileSender compressor" );
+
+    // Each worker owns its compressor, so no state is shared between them
+    ZlibDeflate compressor;
+    compressor.setDictionary( m_dictionary );
+    ChunkSlot* slot;
+
+    while ( ( slot = m_ring->acquireForProcessing() ) != nullptr )
+    {
+        if ( slot->kind == ChunkSlot::Kind::FILE_DATA
+            || slot->kind == ChunkSlot::Kind::SOLID_BATCH )
+        {
+            compressSlot( compressor, slot );
+        }
+
+        m_ring->markProcessed( slot );
+    }
+}
+
+void FileSender::compressSlot( ZlibDeflate& compressor, ChunkSlot* slot )
+{
+    bool primed = isPrimedWithDictionary( *slot );
+
+    // Solid batches are self-contained, the receiver may get them
+    // from any of its decompression workers
+    bool streamed = m_streamedDeflate && !primed
+        && slot->kind == ChunkSlot::Kind::FILE_DATA;
+
+    int level = m_compressLvl;
+    if ( m_controller && ( !streamed || slot->firstChunk ) )
+    {
+        level = m_controller->chooseLevel( slot->getPayload(), slot->length );
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    if ( streamed )
+    {
+        // The only compression thread gets the chunks in order. Every one
+        // is sync flushed, so the receiver can write it out right away.
+        if ( slot->firstChunk )
+        {
+            m_streamLevel = level;
+            compressor.beginDeflate( level );
+        }
+
+        level = m_streamLevel;
+        slot->compressed.clear();
+        compressor.deflatePart( slot->getPayload(), slot->length,
+            slot->compressed, slot->lastChunk ? ZlibDeflate::Flush::FINISH
+                                              : ZlibDeflate::Flush::SYNC );
     }
     else
     {
-        record.absolutePath = root + '\\' + relativePath;
+        // Level 0 still produces a valid zlib stream made of stored blocks,
+        // so the receiver doesn't need to know what we've picked
+        compressor.compress( slot->getPayload(), slot->length,
+            slot->compressed, level, primed );
     }
 
-    wxFileName fname( record.absolutePath );
-    record.elementName = fname.GetFullName().ToStdWstring();
+    if ( m_controller && level > 0 )
+    {
+        std::chrono::duration<double> elapsed
+            = std::chrono::steady_clock::now() - start;
+        m_controller->reportCompressed( slot->length,
+            slot->compressed.size(), elapsed.count() );
+    }
+}
 
+void FileSender::buildDictionary()
+{
+    WXLOGNULL;
+
+    const TransferManifest& manifest = *m_transfer->intern.manifest;
+    std::wstring root = m_transfer->intern.rootDir;
+    std::vector<std::string> samples;
+
+    // Only files this stream is about to send are worth sampling
+    for ( int entry : getShardEntries() )
     {
-        std::lock_guard<std::mutex> transferLock( *m_transfer->mutex );
-        m_transfer->intern.elements.push_back( record );
+        const ManifestEntry& element = manifest[entry];
+
+        if ( element.type != FileType::REGULAR_FILE || element.size == 0
+            || element.size > SMALL_FILE_SIZE || m_resume.isCompleted( entry ) )
+        {
+            continue;
+        }
+
+        wxFile file( root + L"\\" + element.relativePath, wxFile::read );
+        std::string sample( std::min( element.size, DICTIONARY_SAMPLE_SIZE ),
+            '\0' );
+        ssize_t readCount = file.IsOpened()
+            ? file.Read( &sample[0], sample.size() )
+            : wxInvalidOffset;
+
+        if ( readCount > 0 )
+        {
+            sample.resize( readCount );
+            samples.push_back( std::move( sample ) );
+        }
+
+        if ( (int)samples.size() >= DICTIONARY_SAMPLE_FILES )
+        {
+            break;
+        }
+    }
+
+    // A handful of files says too little about the rest of them
+    if ( (int)samples.size() >= MIN_DICTIONARY_SAMPLES )
+    {
+        m_dictionary = ZlibDeflate::buildDictionary( samples );
     }
+}
+
+bool FileSender::isPrimedWithDictionary( const ChunkSlot& slot ) const
+{
+    // Coalesced chunks are the ones of small files
+    return !m_dictionary.empty() && slot.coalesce;
+}
+
+bool FileSender::sendDictionary()
+{
+    if ( m_dictionary.empty() )
+    {
+        return true;
+    }
+
+    FileChunk dictionaryChunk;
+    dictionaryChunk.set_deflate_framing( (uint32_t)DeflateFraming::DICTIONARY );
+    dictionaryChunk.set_chunk( m_dictionary );
+
+    // Goes over the same link as file data, so it's paid for the same way
+    waitIfPaused();
 
+    if ( m_limiter && !m_limiter->throttle( m_remoteBucket.get(),
+             dictionaryChunk.chunk().size(),
+             [this]() { return checkOpFailed(); } ) )
+    {
+        return false;
+    }
+
+    m_writer->Write( dictionaryChunk );
     return true;
 }
 
-bool FileSender::sendSingleDirectory( const std::wstring& root,
-    const std::wstring& relativePath, std::function<void()>& onUpdate )
+bool FileSender::writeQueuedChunks()
 {
+    ChunkSlot* slot;
+
+    while ( ( slot = m_ring->acquireFilled() ) != nullptr )
+    {
+        bool ok = false;
+
+        switch ( slot->kind )
+        {
+        case ChunkSlot::Kind::FILE_DATA:
+            ok = ( !slot->firstChunk || !checkOpFailed() )
+                && sendFileChunk( *slot );
+            break;
+        case ChunkSlot::Kind::DIRECTORY:
+            ok = !checkOpFailed() && sendDirectory( *slot );
+            break;
+        case ChunkSlot::Kind::SOLID_BATCH:
+            ok = !checkOpFailed() && sendSolidBatch( *slot );
+            break;
+        case ChunkSlot::Kind::FAILURE:
+            ok = false;
+            break;
+        }
+
+        m_ring->release( slot );
+
+        if ( !ok )
+        {
+            return false;
+        }
+    }
+
+    return !checkOpFailed();
+}
+
+bool FileSender::sendFileChunk( ChunkSlot& slot )
+{
+    const ManifestEntry& element = m_transfer->intern.manifest->at( slot.entry );
+    const std::wstring& relativePath = element.relativePath;
+
+    if ( slot.firstChunk )
+    {
+        // The message is reused for every chunk, so per-file fields
+        // only have to be filled in once
+        wxString relativePathStr = relativePath;
+        relativePathStr.Replace( '\\', '/' );
+        wxLogDebug( "FileSender: Sending file %s", relativePathStr );
+
+        m_fileChunk.set_relative_path( relativePathStr.ToUTF8() );
+        m_fileChunk.set_file_type( (int)FileType::REGULAR_FILE );
+        m_fileChunk.set_symlink_target( "" );
+        m_fileChunk.set_file_mode( slot.fileMode );
+        m_fileChunk.set_entry_index( slot.entry );
+
+        // Lets the receiver allocate the whole file up front,
+        // sent with the first chunk only
+        m_fileChunk.set_file_size( element.size );
+    }
+
+    DeflateFraming framing = DeflateFraming::PER_CHUNK;
+    if ( m_compressLvl > 0 && m_streamedDeflate
+        && !isPrimedWithDictionary( slot ) )
+    {
+        framing = slot.firstChunk ? DeflateFraming::STREAM_START
+                                  : DeflateFraming::STREAM_PART;
+    }
+    m_fileChunk.set_deflate_framing( (uint32_t)framing );
+
+    if ( m_checksums && slot.lastChunk )
+    {
+        // Covers the bytes sent in this stream. The receiver checks the same
+        // range, resumed files included.
+        m_fileChunk.set_file_crc32c( slot.checksum );
+        m_fileChunk.set_file_crc32c_set( true );
+    }
+
+    std::string* lentBuffer = slot.lendPayload( m_compressLvl > 0,
+        *m_fileChunk.mutable_chunk() );
+
+    waitIfPaused();
+
+    if ( m_limiter && !m_limiter->throttle( m_remoteBucket.get(),
+             m_fileChunk.chunk().size(), [this]() { return checkOpFailed(); } ) )
+    {
+        slot.reclaimPayload( lentBuffer, *m_fileChunk.mutable_chunk() );
+        return false;
+    }
+
+    grpc::WriteOptions options = getWriteOptions( slot,
+        m_fileChunk.chunk().size() );
+    auto writeStart = std::chrono::steady_clock::now();
+
+    m_writer->Write( m_fileChunk, options );
+    m_fileChunk.clear_file_size();
+    m_fileChunk.clear_file_crc32c();
+    m_fileChunk.clear_file_crc32c_set();
+
+    // Buffered writes return immediately and say nothing about the link
+    if ( m_controller && !options.get_buffer_hint() )
+    {
+        std::chrono::duration<double> elapsed
+            = std::chrono::steady_clock::now() - writeStart;
+        m_controller->reportSent( m_fileChunk.chunk().size(), elapsed.count() );
+    }
+
+    slot.reclaimPayload( lentBuffer, *m_fileChunk.mutable_chunk() );
+
+    if ( slot.length > 0 )
+    {
+        updateProgress( slot.length );
+    }
+
+    if ( slot.lastChunk )
+    {
+        addElementRecord( relativePath, db::TransferElementType::FILE,
+            m_checksums ? slot.checksum : -1 );
+    }
+
+    return true;
+}
+
+bool FileSender::sendDirectory( const ChunkSlot& slot )
+{
+    const std::wstring& relativePath
+        = m_transfer->intern.manifest->at( slot.entry ).relativePath;
+
     wxString relativePathStr = relativePath;
     relativePathStr.Replace( '\\', '/' );
     wxLogDebug( "FileSender: Sending directory %s", relativePathStr );
 
-    WXLOGNULL;
-
     FileChunk dirChunk;
     dirChunk.set_relative_path( relativePathStr.ToUTF8() );
     dirChunk.set_file_type( (int)FileType::DIRECTORY );
     dirChunk.set_symlink_target( "" );
     dirChunk.set_chunk( "" );
-    dirChunk.set_file_mode( m_dirPerms.convertToDecimal() );
+    dirChunk.set_file_mode( slot.fileMode );
+    dirChunk.set_entry_index( slot.entry );
 
     waitIfPaused();
 
+    addElementRecord( relativePath, db::TransferElementType::FOLDER, -1 );
+
+    m_writer->Write( dirChunk, getWriteOptions( slot, 0 ) );
+    return true;
+}
+
+bool FileSender::sendSolidBatch( ChunkSlot& slot )
+{
+    const TransferManifest& manifest = *m_transfer->intern.manifest;
+
+    wxLogDebug( "FileSender: Sending %d packed elements",
+        (int)slot.packed.size() );
+
+    m_batchChunk.set_solid_batch( true );
+    m_batchChunk.set_deflate_framing( (uint32_t)DeflateFraming::PER_CHUNK );
+
+    std::string* lentBuffer = slot.lendPayload( m_compressLvl > 0,
+        *m_batchChunk.mutable_chunk() );
+
+    waitIfPaused();
+
+    if ( m_limiter && !m_limiter->throttle( m_remoteBucket.get(),
+             m_batchChunk.chunk().size(), [this]() { return checkOpFailed(); } ) )
+    {
+        slot.reclaimPayload( lentBuffer, *m_batchChunk.mutable_chunk() );
+        return false;
+    }
+
+    auto writeStart = std::chrono::steady_clock::now();
+
+    m_writer->Write( m_batchChunk, getWriteOptions( slot,
+        m_batchChunk.chunk().size() ) );
+
+    if ( m_controller )
+    {
+        std::chrono::duration<double> elapsed
+            = std::chrono::steady_clock::now() - writeStart;
+        m_controller->reportSent( m_batchChunk.chunk().size(), elapsed.count() );
+    }
+
+    slot.reclaimPayload( lentBuffer, *m_batchChunk.mutable_chunk() );
+
+    for ( const PackedEntry& packed : slot.packed )
+    {
+        const ManifestEntry& element = manifest[packed.entry];
+
+        updateProgress( packed.length );
+
+        if ( element.type == FileType::DIRECTORY )
+        {
+            addElementRecord( element.relativePath,
+                db::TransferElementType::FOLDER, -1 );
+        }
+        else
+        {
+            addElementRecord( element.relativePath,
+                db::TransferElementType::FILE,
+                m_checksums ? packed.checksum : -1 );
+        }
+    }
+
+    return true;
+}
+
+grpc::WriteOptions FileSender::getWriteOptions( const ChunkSlot& slot,
+    size_t payloadSize )
+{
+    grpc::WriteOptions options;
+
+    if ( slot.coalesce )
+    {
+        m_coalescedBytes += payloadSize;
+        m_coalescedCount++;
+
+        if ( m_coalescedBytes < COALESCE_MAX_BYTES
+            && m_coalescedCount < COALESCE_MAX_MESSAGES )
+        {
+            // Let gRPC hold the message back until a later write
+            // without the hint flushes everything at once
+            options.set_buffer_hint();
+            return options;
+        }
+    }
+
+    m_coalescedBytes = 0;
+    m_coalescedCount = 0;
+
+    return options;
+}
+
+void FileSender::addElementRecord( const std::wstring& relativePath,
+    db::TransferElementType type, long long checksum )
+{
+    WXLOGNULL;
+
+    const std::wstring& root = m_transfer->intern.rootDir;
+
+    wxString relativePathStr = relativePath;
+    relativePathStr.Replace( '\\', '/' );
+
     db::TransferElement record;
-    record.elementType = db::TransferElementType::FOLDER;
+    record.elementType = type;
+    record.checksum = checksum;
     record.relativePath = relativePathStr.ToStdWstring();
     if ( root[root.size() - 1] == '\\' )
     {
@@ -228,13 +1143,8 @@ bool FileSender::sendSingleDirectory( const std::wstring& root,
     wxFileName fname( record.absolutePath );
     record.elementName = fname.GetFullName().ToStdWstring();
 
-    {
-        std::lock_guard<std::mutex> transferLock( *m_transfer->mutex );
-        m_transfer->intern.elements.push_back( record );
-    }
-
-    m_writer->Write( dirChunk );
-    return true;
+    std::lock_guard<std::mutex> transferLock( *m_transfer->mutex );
+    m_transfer->intern.elements.push_back( record );
 }
 
 bool FileSender::checkOpFailed()
@@ -247,54 +1157,25 @@ bool FileSender::checkOpFailed()
         || m_transfer->status == OpStatus::STOPPED_BY_SENDER;
 }
 
-void FileSender::updateProgress( long long chunkBytes,
-    std::function<void()>& onUpdate )
+void FileSender::updateProgress( long long chunkBytes )
 {
-    using namespace std::chrono;
-
+    // TransferManager publishes the counter, no lock is taken per chunk
+    if ( m_progress && chunkBytes > 0 )
     {
-        std::lock_guard<std::mutex> transferLock( *m_transfer->mutex );
-
-        if ( chunkBytes >= 0 )
-        {
-            m_transfer->meta.sentBytes += chunkBytes;
-        } 
-        else 
-        {
-            m_transfer->meta.sentBytes = m_transfer->totalSize;
-        }
-    }
-
-    auto currentTime = std::chrono::steady_clock::now();
-    long long millisElapsed = duration_cast<milliseconds>(
-        currentTime - m_transfer->intern.lastProgressUpdate )
-                                  .count();
-
-    if ( millisElapsed > PROGRESS_FREQ_MILLIS || chunkBytes == -1 )
-    {
-        std::lock_guard<std::mutex> transferLock( *m_transfer->mutex );
-
-        if ( m_transfer->status == OpStatus::TRANSFERRING
-            || m_transfer->status == OpStatus::PAUSED )
-        {
-            onUpdate();
-            m_transfer->intern.lastProgressUpdate = currentTime;
-        }
+        m_progress->fetch_add( chunkBytes, std::memory_order_relaxed );
     }
 }
 
-bool FileSender::isFileExecutable( const std::string& chunk,
-    const std::wstring& relativePath )
+int FileSender::getFileMode( const ManifestEntry& element,
+    const char* firstChunk, size_t length )
 {
-    for ( const std::wstring& ext : EXECUTABLE_EXTENSIONS )
+    if ( element.permClass == PermissionClass::EXECUTABLE
+        || UnixPermissions::checkElfHeader( firstChunk, length ) )
     {
-        if ( relativePath.rfind( ext ) == relativePath.size() - ext.size() )
-        {
-            return true;
-        }
+        return m_execPerms.convertToDecimal();
     }
 
-    return UnixPermissions::checkElfHeader( chunk.data(), chunk.size() );
+    return m_filePerms.convertToDecimal();
 }
 
 void FileSender::waitIfPaused()
@@ -1,4 +1,11 @@
 #pragma once
+#include "bandwidth_limiter.hpp"
+#include "chunk_ring.hpp"
+#include "compression_controller.hpp"
+#include "crc32c.hpp"
+#include "mapped_file.hpp"
+#include "resume_point.hpp"
+#include "solid_archive.hpp"
 #include "transfer_types.hpp"
 #include "unix_permissions.hpp"
 #include "zlib_deflate.hpp"
@@ -7,6 +14,7 @@
 #include "../proto-gen/warp.pb.h"
 
 #include <functional>
+#include <memory>
 #include <vector>
 
 namespace srv
@@ -20,39 +28,144 @@ public:
     void setCompressionLevel( int level );
     int getCompressionLevel() const;
 
+    void setReadAheadDepth( int chunks );
+    int getReadAheadDepth() const;
+
+    // 0 means one thread per available core
+    void setCompressionThreads( int threads );
+    int getCompressionThreads() const;
+
+    // Treat compression level as an upper bound and adjust it per chunk
+    void setAdaptiveCompression( bool adaptive );
+    bool getAdaptiveCompression() const;
+
+    // Files at least this big are memory mapped instead of read,
+    // 0 disables mapping
+    void setMemoryMapThreshold( long long bytes );
+    long long getMemoryMapThreshold() const;
+
+    // Send only the part of the op assigned to one of several
+    // parallel streams
+    void setShard( int index, int count );
+    int getShardIndex() const;
+    int getShardCount() const;
+
+    // Skip whatever the receiver already has from an earlier attempt
+    void setResumePoint( const ResumePoint& point );
+
+    // Sends a CRC-32C of every file along with its last chunk
+    void setComputeChecksums( bool compute );
+
+    // Deflates every file as a single stream, so the history isn't lost
+    // between chunks. Takes a single compression thread per stream.
+    void setStreamedDeflate( bool streamed );
+
+    // Samples the first small files into a preset dictionary, sent once
+    // ahead of them. Every small file is then deflated with it.
+    void setPresetDictionary( bool enabled );
+
+    // Packs small files and directories into solid batches instead
+    // of sending each of them on its own
+    void setSolidArchive( bool enabled );
+
+    void setBandwidthLimiter( std::shared_ptr<BandwidthLimiter> limiter,
+        const std::string& remoteId );
+
     void setUnixPermissionMasks( int file, int executable, int directory );
     int getUnixFilePermissionMask();
     int getUnixExecutablePermissionMask();
     int getUnixDirectoryPermissionMask();
 
-    bool transferFiles( std::function<void()> onUpdate );
+    bool transferFiles();
 
 private:
-    static const long long PROGRESS_FREQ_MILLIS;
     static const long long FILE_CHUNK_SIZE;
-    static const std::vector<std::wstring> EXECUTABLE_EXTENSIONS;
+    static const int MIN_READ_AHEAD_DEPTH;
+    static const int MAX_COMPRESSION_THREADS;
+    static const long long MMAP_WINDOW_CHUNKS;
+    static const long long SMALL_FILE_SIZE;
+    static const size_t COALESCE_MAX_BYTES;
+    static const int COALESCE_MAX_MESSAGES;
+    static const int DICTIONARY_SAMPLE_FILES;
+    static const int MIN_DICTIONARY_SAMPLES;
+    static const long long DICTIONARY_SAMPLE_SIZE;
 
     std::shared_ptr<TransferOp> m_transfer;
     grpc::ServerWriter<FileChunk>* m_writer;
     int m_compressLvl;
+    int m_readAheadDepth;
+    int m_compressThreads;
+    bool m_adaptiveCompress;
+    long long m_mmapThreshold;
+    int m_shardIndex;
+    int m_shardCount;
+    ResumePoint m_resume;
+    bool m_checksums;
+    bool m_streamedDeflate;
+    int m_streamLevel; // Compression thread only
+    bool m_presetDictionary;
+    std::string m_dictionary; // Built before any thread starts
+    bool m_solidArchive;
+    std::shared_ptr<BandwidthLimiter> m_limiter;
+    std::shared_ptr<TokenBucket> m_remoteBucket;
+    std::shared_ptr<std::atomic<long long>> m_progress;
 
     UnixPermissions m_filePerms;
     UnixPermissions m_execPerms;
     UnixPermissions m_dirPerms;
 
-    ZlibDeflate m_compressor;
+    std::unique_ptr<ChunkRing> m_ring;
+    std::unique_ptr<CompressionController> m_controller;
+    FileChunk m_fileChunk;
+    FileChunk m_batchChunk;
+
+    // Solid batch being filled by the reader thread
+    ChunkSlot* m_batchSlot;
+    SolidArchiveWriter m_batch;
+
+    // Small messages written with a buffer hint since the last flush
+    size_t m_coalescedBytes;
+    int m_coalescedCount;
+
+    // Reader thread
+    std::vector<int> getShardEntries() const;
+    long long getResumedBytes() const;
+    void readerMain();
+    bool readSingleEntity( const std::wstring& root, int entry );
+    bool readSingleFile( const std::wstring& fullPath, int entry,
+        long long startOffset );
+    bool shouldMapFile( const std::wstring& fullPath,
+        const ManifestEntry& element );
+    bool readMappedFile( const std::wstring& fullPath, int entry,
+        long long startOffset );
+    void readSingleDirectory( int entry );
+    bool isPackable( int entry ) const;
+    bool packSingleEntity( const std::wstring& fullPath, int entry );
+    void flushSolidBatch();
+    void publishFailure( int entry );
+
+    // Compression worker threads
+    int getEffectiveCompressionThreads() const;
+    void compressorMain();
+    void compressSlot( ZlibDeflate& compressor, ChunkSlot* slot );
+    void buildDictionary();
+    bool isPrimedWithDictionary( const ChunkSlot& slot ) const;
 
-    bool sendSingleEntity( const std::wstring& root,
-        const std::wstring& relativePath, std::function<void()>& onUpdate );
-    bool sendSingleFile( const std::wstring& root,
-        const std::wstring& relativePath, std::function<void()>& onUpdate );
-    bool sendSingleDirectory( const std::wstring& root,
-        const std::wstring& relativePath, std::function<void()>& onUpdate );
+    // Writer (calling) thread
+    bool writeQueuedChunks();
+    bool sendDictionary();
+    bool sendFileChunk( ChunkSlot& slot );
+    bool sendDirectory( const ChunkSlot& slot );
+    bool sendSolidBatch( ChunkSlot& slot );
+    grpc::WriteOptions getWriteOptions( const ChunkSlot& slot,
+        size_t payloadSize );
+    void addElementRecord( const std::wstring& relativePath,
+        db::TransferElementType type, long long checksum );
 
     bool checkOpFailed();
-    void updateProgress( long long chunkBytes, std::function<void()>& onUpdate );
-    bool isFileExecutable( const std::string& chunk, 
-        const std::wstring& relativePath );
+    void updateProgress( long long chunkBytes );
+    int getFileMode( const ManifestEntry& element, const char* firstChunk,
+        size_t length );
     void waitIfPaused();
 };
 
@@ -0,0 +1,199 @@
+#include "mapped_file.hpp"
+
+namespace srv
+{
+
+const DWORD MappedFile::MAX_READ = 0x40000000;
+
+MappedFile::MappedFile()
+    : m_file( INVALID_HANDLE_VALUE )
+    , m_mapping( NULL )
+    , m_size( 0 )
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open( const std::wstring& path )
+{
+    close();
+
+    // Writers aren't locked out for the whole transfer. While the file
+    // is mapped, the system doesn't let them truncate it.
+    m_file = CreateFileW( path.c_str(), GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+
+    if ( m_file == INVALID_HANDLE_VALUE )
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if ( !GetFileSizeEx( m_file, &size ) )
+    {
+        close();
+        return false;
+    }
+    m_size = size.QuadPart;
+
+    if ( m_size == 0 )
+    {
+        // Empty files can't be mapped, but there's nothing to map anyway
+        return true;
+    }
+
+    m_mapping = CreateFileMappingW( m_file, NULL, PAGE_READONLY, 0, 0, NULL );
+
+    if ( m_mapping == NULL )
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    // Views that are still mapped keep the mapping object alive
+    if ( m_mapping != NULL )
+    {
+        CloseHandle( m_mapping );
+        m_mapping = NULL;
+    }
+
+    if ( m_file != INVALID_HANDLE_VALUE )
+    {
+        CloseHandle( m_file );
+        m_file = INVALID_HANDLE_VALUE;
+    }
+
+    m_size = 0;
+}
+
+bool MappedFile::isOpened() const
+{
+    return m_file != INVALID_HANDLE_VALUE;
+}
+
+long long MappedFile::getSize() const
+{
+    return m_size;
+}
+
+long long MappedFile::querySize() const
+{
+    LARGE_INTEGER size;
+
+    if ( m_file == INVALID_HANDLE_VALUE || !GetFileSizeEx( m_file, &size ) )
+    {
+        return -1;
+    }
+
+    return size.QuadPart;
+}
+
+std::shared_ptr<const char> MappedFile::mapWindow( long long offset,
+    size_t length )
+{
+    if ( m_mapping == NULL || offset < 0 || offset + (long long)length > m_size )
+    {
+        return nullptr;
+    }
+
+    void* view = MapViewOfFile( m_mapping, FILE_MAP_READ,
+        (DWORD)( offset >> 32 ), (DWORD)( offset & 0xFFFFFFFF ), length );
+
+    if ( view == NULL )
+    {
+        return nullptr;
+    }
+
+    // We're going to read the window front to back, ask the memory manager
+    // to start paging it in. It's only a hint, so failures don't matter.
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = view;
+    range.NumberOfBytes = length;
+    PrefetchVirtualMemory( GetCurrentProcess(), 1, &range, 0 );
+
+    return std::shared_ptr<const char>( (const char*)view, []( const char* ptr )
+        { UnmapViewOfFile( ptr ); } );
+}
+
+bool MappedFile::read( long long offset, char* dest, size_t length )
+{
+    while ( length > 0 )
+    {
+        OVERLAPPED position = {};
+        position.Offset = (DWORD)( offset & 0xFFFFFFFF );
+        position.OffsetHigh = (DWORD)( offset >> 32 );
+
+        DWORD toRead = length > MAX_READ ? MAX_READ : (DWORD)length;
+        DWORD readCount = 0;
+
+        if ( !ReadFile( m_file, dest, toRead, &readCount, &position )
+            || readCount == 0 )
+        {
+            return false;
+        }
+
+        offset += readCount;
+        dest += readCount;
+        length -= readCount;
+    }
+
+    return true;
+}
+
+bool MappedFile::isMappable( const std::wstring& path )
+{
+    wchar_t volume[MAX_PATH];
+
+    if ( !GetVolumePathNameW( path.c_str(), volume, MAX_PATH ) )
+    {
+        return false;
+    }
+
+    return GetDriveTypeW( volume ) == DRIVE_FIXED;
+}
+
+bool MappedFile::touch( const char* ptr, size_t length )
+{
+    // No C++ objects in here, they can't be unwound through __try
+    __try
+    {
+        volatile char sink;
+
+        for ( size_t i = 0; i < length; i += 4096 )
+        {
+            sink = ptr[i];
+        }
+
+        if ( length > 0 )
+        {
+            sink = ptr[length - 1];
+        }
+    }
+    __except ( GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR
+            ? EXCEPTION_EXECUTE_HANDLER
+            : EXCEPTION_CONTINUE_SEARCH )
+    {
+        return false;
+    }
+
+    return true;
+}
+
+size_t MappedFile::getAllocationGranularity()
+{
+    SYSTEM_INFO info;
+    GetSystemInfo( &info );
+
+    return info.dwAllocationGranularity;
+}
+
+};
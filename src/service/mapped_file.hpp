@@ -0,0 +1,55 @@
+#pragma once
+#include <memory>
+#include <string>
+
+#include <Windows.h>
+
+namespace srv
+{
+
+// Read-only file accessed through memory mapping. Windows of the file are
+// mapped on demand and unmapped as soon as the last reference to them
+// (including aliases pointing inside them) is gone. Other processes may
+// keep writing to the file meanwhile.
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool open( const std::wstring& path );
+    void close();
+
+    bool isOpened() const;
+
+    // Size when the file was opened, nothing past it can be mapped
+    long long getSize() const;
+
+    // Current size, -1 if it can't be told
+    long long querySize() const;
+
+    // Offset has to be a multiple of the allocation granularity
+    std::shared_ptr<const char> mapWindow( long long offset, size_t length );
+
+    // Plain read, for ranges that can't be used through a view
+    bool read( long long offset, char* dest, size_t length );
+
+    // Views of files on network or removable volumes fault when the
+    // volume goes away, so only files on fixed ones are worth mapping
+    static bool isMappable( const std::wstring& path );
+
+    // Pages a range of a view in. False if the system failed to read it,
+    // the range mustn't be accessed through the view then.
+    static bool touch( const char* ptr, size_t length );
+
+    static size_t getAllocationGranularity();
+
+private:
+    static const DWORD MAX_READ;
+
+    HANDLE m_file;
+    HANDLE m_mapping;
+    long long m_size;
+};
+
+};
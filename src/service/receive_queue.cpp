@@ -0,0 +1,122 @@
+#include "receive_queue.hpp"
+
+#include <algorithm>
+
+namespace srv
+{
+
+ReceiveQueue::ReceiveQueue()
+    : m_publishSeq( 0 )
+    , m_claimSeq( 0 )
+    , m_readSeq( 0 )
+{
+}
+
+void ReceiveQueue::reset( size_t depth )
+{
+    m_publishSeq = 0;
+    m_claimSeq = 0;
+    m_readSeq = 0;
+
+    m_chunks.resize( std::max( depth, (size_t)1 ) );
+    for ( ReceivedChunk& chunk : m_chunks )
+    {
+        chunk.inflateOk = false;
+        chunk.processed = false;
+    }
+}
+
+void ReceiveQueue::publish( FileChunk& message, bool processed )
+{
+    ReceivedChunk& chunk = m_chunks[m_publishSeq % m_chunks.size()];
+    chunk.message.Swap( &message );
+    chunk.processed = processed;
+    m_publishSeq++;
+}
+
+bool ReceiveQueue::hasPublished() const
+{
+    return m_publishSeq > 0;
+}
+
+bool ReceiveQueue::isFull() const
+{
+    return m_publishSeq - m_readSeq >= m_chunks.size();
+}
+
+bool ReceiveQueue::isEmpty() const
+{
+    return m_readSeq == m_publishSeq;
+}
+
+bool ReceiveQueue::isNextReady() const
+{
+    return !isEmpty() && m_chunks[m_readSeq % m_chunks.size()].processed;
+}
+
+void ReceiveQueue::take( FileChunk& message, std::string& inflated,
+    bool& inflateOk )
+{
+    ReceivedChunk& chunk = m_chunks[m_readSeq % m_chunks.size()];
+    message.Swap( &chunk.message );
+    inflated.swap( chunk.inflated );
+    inflateOk = chunk.inflateOk;
+    chunk.processed = false;
+    m_readSeq++;
+}
+
+bool ReceiveQueue::hasUnclaimed() const
+{
+    return m_claimSeq < m_publishSeq;
+}
+
+ReceivedChunk* ReceiveQueue::claim()
+{
+    if ( !hasUnclaimed() )
+    {
+        return nullptr;
+    }
+
+    ReceivedChunk* chunk = &m_chunks[m_claimSeq % m_chunks.size()];
+    m_claimSeq++;
+
+    return chunk;
+}
+
+void ChunkInflater::setDictionary( const std::string& dictionary )
+{
+    m_decompressor.setDictionary( dictionary );
+}
+
+bool ChunkInflater::inflate( const FileChunk& chunk, std::string& output )
+{
+    DeflateFraming framing = (DeflateFraming)chunk.deflate_framing();
+    const std::string& payload = chunk.chunk();
+
+    if ( framing == DeflateFraming::PER_CHUNK )
+    {
+        return m_decompressor.decompress( payload.data(), payload.size(),
+            output );
+    }
+
+    if ( framing == DeflateFraming::STREAM_START )
+    {
+        if ( !m_decompressor.beginInflate() )
+        {
+            return false;
+        }
+    }
+    else if ( framing != DeflateFraming::STREAM_PART )
+    {
+        return false;
+    }
+
+    // Each piece was sync flushed, so it inflates completely
+    bool finished;
+    output.clear();
+
+    return m_decompressor.inflatePart( payload.data(), payload.size(),
+        output, finished );
+}
+
+};
@@ -0,0 +1,75 @@
+#pragma once
+#include "../proto-gen/warp.pb.h"
+#include "transfer_types.hpp"
+#include "zlib_deflate.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace srv
+{
+
+struct ReceivedChunk
+{
+    FileChunk message;
+    std::string inflated; // Filled by a decompression worker
+    bool inflateOk;
+    bool processed;
+};
+
+// Ring of received chunks on their way from gRPC to the writer. Messages
+// are swapped in and out, so payloads are never copied and every buffer
+// keeps its capacity for a later chunk. Decompression workers may claim
+// chunks in between, the writer still takes them in publishing order.
+// Not thread safe, the caller guards it.
+class ReceiveQueue
+{
+public:
+    ReceiveQueue();
+
+    void reset( size_t depth );
+
+    // Takes over the message's contents, leaving it the buffers
+    // of a chunk taken earlier
+    void publish( FileChunk& message, bool processed );
+
+    bool hasPublished() const;
+    bool isFull() const;
+    bool isEmpty() const;
+    bool isNextReady() const;
+
+    // Hands the oldest chunk over, gets the buffers back the same way
+    void take( FileChunk& message, std::string& inflated, bool& inflateOk );
+
+    // Decompression workers, a claimed chunk stays theirs
+    // until they set it processed
+    bool hasUnclaimed() const;
+    ReceivedChunk* claim();
+
+private:
+    std::vector<ReceivedChunk> m_chunks;
+
+    // Monotonic sequence numbers, chunk index is seq % depth
+    size_t m_publishSeq;
+    size_t m_claimSeq;
+    size_t m_readSeq;
+};
+
+// Inflates payloads the way the sender framed them. Keeps the inflate
+// state of a streamed file from one piece to the next, so every stream
+// needs one of its own.
+class ChunkInflater
+{
+public:
+    // Used by chunks primed with it, set before any of them comes
+    void setDictionary( const std::string& dictionary );
+
+    // Output is replaced, its buffer keeps the capacity
+    bool inflate( const FileChunk& chunk, std::string& output );
+
+private:
+    ZlibDeflate m_decompressor;
+};
+
+};
@@ -0,0 +1,125 @@
+#include "resume_point.hpp"
+
+namespace srv
+{
+
+const uint64_t ResumePoint::FNV_OFFSET_BASIS = 14695981039346656037ULL;
+const uint64_t ResumePoint::FNV_PRIME = 1099511628211ULL;
+
+ResumePoint::ResumePoint()
+    : m_bitmap()
+    , m_partialEntry( -1 )
+    , m_partialOffset( 0 )
+{
+}
+
+uint64_t ResumePoint::hashManifest( const TransferManifest& manifest )
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+
+    // Any change to a file's size or modification time makes the op
+    // a different one, so stale data is never continued
+    for ( const ManifestEntry& entry : manifest )
+    {
+        for ( wchar_t ch : entry.relativePath )
+        {
+            hash = hashValue( hash, (uint64_t)ch );
+        }
+
+        hash = hashValue( hash, (uint64_t)entry.type );
+        hash = hashValue( hash, (uint64_t)entry.size );
+        hash = hashValue( hash, (uint64_t)entry.mtime );
+    }
+
+    // Zero stands for peers that don't support resuming
+    return hash != 0 ? hash : 1;
+}
+
+void ResumePoint::markCompleted( int entry )
+{
+    if ( entry < 0 )
+    {
+        return;
+    }
+
+    size_t byte = entry / 8;
+    if ( m_bitmap.size() <= byte )
+    {
+        m_bitmap.resize( byte + 1, '\0' );
+    }
+
+    m_bitmap[byte] |= (char)( 1 << ( entry % 8 ) );
+}
+
+bool ResumePoint::isCompleted( int entry ) const
+{
+    if ( entry < 0 || (size_t)( entry / 8 ) >= m_bitmap.size() )
+    {
+        return false;
+    }
+
+    return ( m_bitmap[entry / 8] & ( 1 << ( entry % 8 ) ) ) != 0;
+}
+
+void ResumePoint::setPartial( int entry, long long offset )
+{
+    if ( entry < 0 || offset <= 0 )
+    {
+        m_partialEntry = -1;
+        m_partialOffset = 0;
+        return;
+    }
+
+    m_partialEntry = entry;
+    m_partialOffset = offset;
+}
+
+int ResumePoint::getPartialEntry() const
+{
+    return m_partialEntry;
+}
+
+long long ResumePoint::getPartialOffset() const
+{
+    return m_partialOffset;
+}
+
+long long ResumePoint::getStartOffset( int entry ) const
+{
+    if ( entry == m_partialEntry && !isCompleted( entry ) )
+    {
+        return m_partialOffset;
+    }
+
+    return 0;
+}
+
+bool ResumePoint::isEmpty() const
+{
+    return m_partialEntry == -1
+        && m_bitmap.find_first_not_of( '\0' ) == std::string::npos;
+}
+
+void ResumePoint::setBitmap( const std::string& bitmap )
+{
+    m_bitmap = bitmap;
+}
+
+const std::string& ResumePoint::getBitmap() const
+{
+    return m_bitmap;
+}
+
+uint64_t ResumePoint::hashValue( uint64_t hash, uint64_t value )
+{
+    // FNV-1a, fed one byte at a time
+    for ( int i = 0; i < 8; i++ )
+    {
+        hash ^= ( value >> ( i * 8 ) ) & 0xFF;
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+};
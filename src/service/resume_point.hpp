@@ -0,0 +1,48 @@
+#pragma once
+#include "transfer_types.hpp"
+
+#include <stdint.h>
+#include <string>
+
+namespace srv
+{
+
+// What the receiver of an interrupted op already has on disk: a bit per
+// manifest entry received in full, plus at most one entry received
+// partially, which the sender continues from the given offset.
+class ResumePoint
+{
+public:
+    ResumePoint();
+
+    // Identifies the set of files being sent, never 0
+    static uint64_t hashManifest( const TransferManifest& manifest );
+
+    void markCompleted( int entry );
+    bool isCompleted( int entry ) const;
+
+    void setPartial( int entry, long long offset );
+    int getPartialEntry() const;
+    long long getPartialOffset() const;
+
+    // Where the sender should start reading the entry
+    long long getStartOffset( int entry ) const;
+
+    bool isEmpty() const;
+
+    // Bit per entry, LSB first, as sent over the wire
+    void setBitmap( const std::string& bitmap );
+    const std::string& getBitmap() const;
+
+private:
+    static const uint64_t FNV_OFFSET_BASIS;
+    static const uint64_t FNV_PRIME;
+
+    std::string m_bitmap;
+    int m_partialEntry;
+    long long m_partialOffset;
+
+    static uint64_t hashValue( uint64_t hash, uint64_t value );
+};
+
+};
@@ -6,6 +6,7 @@
 #include <chrono>
 
 #include <Windows.h>
+#include <io.h>
 #include <LM.h>
 
 #define SECURITY_WIN32
@@ -142,6 +143,44 @@ int64_t Utils::getMonotonicTime()
     return stamp.time_since_epoch().count();
 }
 
+bool Utils::setFileAllocation( int fd, long long size, bool& outOfSpace )
+{
+    outOfSpace = false;
+
+    HANDLE file = (HANDLE)_get_osfhandle( fd );
+    if ( file == INVALID_HANDLE_VALUE )
+    {
+        return false;
+    }
+
+    FILE_ALLOCATION_INFO info;
+    info.AllocationSize.QuadPart = size;
+
+    if ( !SetFileInformationByHandle( file, FileAllocationInfo,
+             &info, sizeof( info ) ) )
+    {
+        DWORD error = GetLastError();
+        outOfSpace = error == ERROR_DISK_FULL || error == ERROR_HANDLE_DISK_FULL;
+
+        return false;
+    }
+
+    return true;
+}
+
+bool Utils::replaceFile( const wxString& from, const wxString& to,
+    bool writeThrough )
+{
+    DWORD flags = MOVEFILE_REPLACE_EXISTING;
+
+    if ( writeThrough )
+    {
+        flags |= MOVEFILE_WRITE_THROUGH;
+    }
+
+    return MoveFileExW( from.wc_str(), to.wc_str(), flags ) != 0;
+}
+
 wxString Utils::makeIntResource( int resource )
 {
     return wxString::Format( "#%d", resource );
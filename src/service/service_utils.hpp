@@ -20,6 +20,16 @@ public:
     static std::string getOSVersionString();
     static int64_t getMonotonicTime();
 
+    // Reserves (or gives back) disk space of an open file without
+    // changing its length. outOfSpace tells a full disk apart from
+    // file systems that can't do it.
+    static bool setFileAllocation( int fd, long long size, bool& outOfSpace );
+
+    // Moves a file over another one in a single step. With writeThrough
+    // the new name is on disk by the time it returns.
+    static bool replaceFile( const wxString& from, const wxString& to,
+        bool writeThrough );
+
     static wxString makeIntResource( int resource );
 
 private:
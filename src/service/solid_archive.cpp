@@ -0,0 +1,163 @@
+#include "solid_archive.hpp"
+
+#include <cstring>
+
+namespace srv
+{
+
+// Entry, type, flags, mode, checksum, path length, data length
+const size_t SolidArchiveWriter::HEADER_SIZE = 4 + 1 + 1 + 4 + 4 + 4 + 4;
+const uint8_t SolidArchiveWriter::CHECKSUM_FLAG = 0x01;
+
+SolidArchiveWriter::SolidArchiveWriter()
+    : m_buffer( nullptr )
+    , m_capacity( 0 )
+    , m_size( 0 )
+    , m_recordStart( 0 )
+    , m_dataStart( 0 )
+{
+}
+
+void SolidArchiveWriter::reset( char* buffer, size_t capacity )
+{
+    m_buffer = buffer;
+    m_capacity = capacity;
+    m_size = 0;
+    m_recordStart = 0;
+    m_dataStart = 0;
+}
+
+bool SolidArchiveWriter::fits( size_t pathLength, size_t dataLength ) const
+{
+    return getRecordSize( pathLength, dataLength ) <= m_capacity - m_size;
+}
+
+char* SolidArchiveWriter::beginRecord( int entry, FileType type,
+    const std::string& relativePath )
+{
+    char* header = m_buffer + m_size;
+
+    writeValue( header, (uint32_t)entry );
+    header[4] = (char)type;
+    header[5] = 0;
+    writeValue( header + 6, 0 );
+    writeValue( header + 10, 0 );
+    writeValue( header + 14, (uint32_t)relativePath.size() );
+    writeValue( header + 18, 0 );
+
+    std::memcpy( header + HEADER_SIZE, relativePath.data(),
+        relativePath.size() );
+
+    m_recordStart = m_size;
+    m_dataStart = m_size + HEADER_SIZE + relativePath.size();
+
+    return m_buffer + m_dataStart;
+}
+
+void SolidArchiveWriter::endRecord( int fileMode, size_t dataLength,
+    bool hasChecksum, uint32_t checksum )
+{
+    // Mode and length are only known once the data has been read
+    char* header = m_buffer + m_recordStart;
+
+    header[5] = hasChecksum ? (char)CHECKSUM_FLAG : 0;
+    writeValue( header + 6, (uint32_t)fileMode );
+    writeValue( header + 10, checksum );
+    writeValue( header + 18, (uint32_t)dataLength );
+
+    m_size = m_dataStart + dataLength;
+}
+
+size_t SolidArchiveWriter::getSize() const
+{
+    return m_size;
+}
+
+bool SolidArchiveWriter::isEmpty() const
+{
+    return m_size == 0;
+}
+
+size_t SolidArchiveWriter::getRecordSize( size_t pathLength,
+    size_t dataLength )
+{
+    return HEADER_SIZE + pathLength + dataLength;
+}
+
+void SolidArchiveWriter::writeValue( char* dest, uint32_t value )
+{
+    for ( int i = 0; i < 4; i++ )
+    {
+        dest[i] = (char)( ( value >> ( i * 8 ) ) & 0xFF );
+    }
+}
+
+SolidArchiveReader::SolidArchiveReader( const char* batch, size_t length )
+    : m_batch( batch )
+    , m_length( length )
+    , m_offset( 0 )
+    , m_valid( true )
+{
+}
+
+bool SolidArchiveReader::next( PackedRecord& record )
+{
+    if ( !m_valid || m_offset == m_length )
+    {
+        return false;
+    }
+
+    size_t left = m_length - m_offset;
+    const char* header = m_batch + m_offset;
+
+    if ( left < SolidArchiveWriter::HEADER_SIZE )
+    {
+        m_valid = false;
+        return false;
+    }
+
+    size_t pathLength = readValue( header + 14 );
+    size_t dataLength = readValue( header + 18 );
+
+    // Compared one by one, so corrupt lengths can't overflow the sum
+    left -= SolidArchiveWriter::HEADER_SIZE;
+    if ( pathLength > left || dataLength > left - pathLength )
+    {
+        m_valid = false;
+        return false;
+    }
+
+    const char* path = header + SolidArchiveWriter::HEADER_SIZE;
+
+    record.entry = (int)readValue( header );
+    record.type = (FileType)(uint8_t)header[4];
+    record.hasChecksum = ( header[5] & SolidArchiveWriter::CHECKSUM_FLAG ) != 0;
+    record.fileMode = (int)readValue( header + 6 );
+    record.checksum = readValue( header + 10 );
+    record.relativePath.assign( path, pathLength );
+    record.data = path + pathLength;
+    record.length = dataLength;
+
+    m_offset += SolidArchiveWriter::HEADER_SIZE + pathLength + dataLength;
+
+    return true;
+}
+
+bool SolidArchiveReader::isValid() const
+{
+    return m_valid;
+}
+
+uint32_t SolidArchiveReader::readValue( const char* src )
+{
+    uint32_t value = 0;
+
+    for ( int i = 0; i < 4; i++ )
+    {
+        value |= (uint32_t)(uint8_t)src[i] << ( i * 8 );
+    }
+
+    return value;
+}
+
+};
@@ -0,0 +1,82 @@
+#pragma once
+#include "transfer_types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace srv
+{
+
+// Element of a solid batch, as unpacked by SolidArchiveReader
+struct PackedRecord
+{
+    int entry; // Index of the element in transfer's path list
+    FileType type;
+    int fileMode;
+    bool hasChecksum;
+    uint32_t checksum; // CRC-32C of the data
+    std::string relativePath; // UTF-8, separated by '/'
+    const char* data; // Points into the batch
+    size_t length;
+};
+
+// Packs whole small files and directories back to back into a batch,
+// so thousands of them go out in a few messages and compress together.
+// Every record is a little-endian header followed by the path and data.
+class SolidArchiveWriter
+{
+public:
+    SolidArchiveWriter();
+
+    // Starts a new batch in a buffer owned by the caller
+    void reset( char* buffer, size_t capacity );
+
+    bool fits( size_t pathLength, size_t dataLength ) const;
+
+    // Writes the header and path of a record that has to fit, returns
+    // where its data goes. Until endRecord is called, the record isn't
+    // part of the batch and the next one simply overwrites it.
+    char* beginRecord( int entry, FileType type,
+        const std::string& relativePath );
+    void endRecord( int fileMode, size_t dataLength, bool hasChecksum,
+        uint32_t checksum );
+
+    size_t getSize() const;
+    bool isEmpty() const;
+
+    static size_t getRecordSize( size_t pathLength, size_t dataLength );
+
+    static const size_t HEADER_SIZE;
+    static const uint8_t CHECKSUM_FLAG;
+
+private:
+    char* m_buffer;
+    size_t m_capacity;
+    size_t m_size;
+    size_t m_recordStart;
+    size_t m_dataStart;
+
+    static void writeValue( char* dest, uint32_t value );
+};
+
+// Walks the records of a batch without copying their data
+class SolidArchiveReader
+{
+public:
+    SolidArchiveReader( const char* batch, size_t length );
+
+    // False at the end of the batch, or at a malformed record
+    bool next( PackedRecord& record );
+    bool isValid() const;
+
+private:
+    const char* m_batch;
+    size_t m_length;
+    size_t m_offset;
+    bool m_valid;
+
+    static uint32_t readValue( const char* src );
+};
+
+};
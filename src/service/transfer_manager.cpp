@@ -1,6 +1,7 @@
 #include "transfer_manager.hpp"
 
 #include "../globals.hpp"
+#include "../thread_name.hpp"
 #include "auth_manager.hpp"
 #include "file_sender.hpp"
 #include "notification_accept_files.hpp"
@@ -11,29 +12,49 @@
 #include <wx/filename.h>
 #include <wx/mimetype.h>
 
+#include <algorithm>
 #include <memory>
 
 namespace srv
 {
 
 const long long TransferManager::PROGRESS_FREQ_MILLIS = 250;
+const long long TransferManager::FINISH_GRACE_MILLIS = 1000;
 const std::string TransferManager::DEFAULT_MIME_TYPE = "application/octet-stream";
 const std::string TransferManager::DIRECTORY_MIME_TYPE = "inode/directory";
 
 TransferManager::TransferManager( ObservableService* service )
     : m_running( ATOMIC_VAR_INIT( true ) )
     , m_remoteMgr( nullptr )
+    , m_limiter( std::make_shared<BandwidthLimiter>() )
     , m_srv( service )
     , m_lastId( 0 )
     , m_outputPath( L"" )
     , m_compressionLevel( 0 )
+    , m_compressionThreads( 0 )
+    , m_adaptiveCompression( false )
+    , m_readAheadDepth( 8 )
+    , m_mmapThreshold( 0 )
+    , m_parallelStreams( 1 )
     , m_mustAllowIncoming( true )
     , m_mustAllowOverwrite( true )
+    , m_verifyChecksums( false )
+    , m_streamedDeflate( false )
+    , m_presetDictionary( false )
+    , m_solidArchive( false )
+    , m_atomicWrites( false )
+    , m_syncPolicy( SyncPolicy::NONE )
+    , m_syncBatchFiles( 64 )
+    , m_syncBatchBytes( 64 * 1024 * 1024 )
     , m_filePerms( 0 )
     , m_execPerms( 0 )
     , m_dirPerms( 0 )
     , m_empty()
 {
+    m_progressThread = std::thread(
+        std::bind( &TransferManager::progressPublisherMain, this ) );
+    m_finishThread = std::thread(
+        std::bind( &TransferManager::finisherMain, this ) );
 }
 
 TransferManager::~TransferManager()
@@ -110,6 +131,82 @@ int TransferManager::getCompressionLevel()
     return m_compressionLevel;
 }
 
+void TransferManager::setCompressionThreads( int threads )
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    m_compressionThreads = threads;
+}
+
+int TransferManager::getCompressionThreads()
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    return m_compressionThreads;
+}
+
+void TransferManager::setAdaptiveCompression( bool adaptive )
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    m_adaptiveCompression = adaptive;
+}
+
+bool TransferManager::getAdaptiveCompression()
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    return m_adaptiveCompression;
+}
+
+void TransferManager::setReadAheadDepth( int chunks )
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    m_readAheadDepth = chunks;
+}
+
+int TransferManager::getReadAheadDepth()
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    return m_readAheadDepth;
+}
+
+void TransferManager::setMemoryMapThreshold( long long bytes )
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    m_mmapThreshold = bytes;
+}
+
+long long TransferManager::getMemoryMapThreshold()
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    return m_mmapThreshold;
+}
+
+void TransferManager::setParallelStreams( int streams )
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    m_parallelStreams = std::max( streams, 1 );
+}
+
+int TransferManager::getParallelStreams()
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    return m_parallelStreams;
+}
+
+void TransferManager::setBandwidthLimits( long long global, long long perRemote )
+{
+    // Limiter has a lock of its own, transfers don't wait for ours
+    m_limiter->setLimits( global, perRemote );
+}
+
 void TransferManager::setMustAllowIncoming( bool must )
 {
     std::lock_guard<std::mutex> guard( m_mtx );
@@ -152,6 +249,107 @@ bool TransferManager::getPreserveZoneInfo()
     return m_preserveZoneInfo;
 }
 
+void TransferManager::setVerifyChecksums( bool verify )
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    m_verifyChecksums = verify;
+}
+
+bool TransferManager::getVerifyChecksums()
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    return m_verifyChecksums;
+}
+
+void TransferManager::setStreamedDeflate( bool streamed )
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    m_streamedDeflate = streamed;
+}
+
+bool TransferManager::getStreamedDeflate()
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    return m_streamedDeflate;
+}
+
+void TransferManager::setPresetDictionary( bool enabled )
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    m_presetDictionary = enabled;
+}
+
+bool TransferManager::getPresetDictionary()
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    return m_presetDictionary;
+}
+
+void TransferManager::setSolidArchive( bool enabled )
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    m_solidArchive = enabled;
+}
+
+bool TransferManager::getSolidArchive()
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    return m_solidArchive;
+}
+
+void TransferManager::setAtomicWrites( bool atomic )
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    m_atomicWrites = atomic;
+}
+
+bool TransferManager::getAtomicWrites()
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    return m_atomicWrites;
+}
+
+void TransferManager::setSyncPolicy( SyncPolicy policy,
+    int batchFiles, long long batchBytes )
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    m_syncPolicy = policy;
+    m_syncBatchFiles = batchFiles;
+    m_syncBatchBytes = batchBytes;
+}
+
+SyncPolicy TransferManager::getSyncPolicy()
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    return m_syncPolicy;
+}
+
+int TransferManager::getSyncBatchFiles()
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    return m_syncBatchFiles;
+}
+
+long long TransferManager::getSyncBatchBytes()
+{
+    std::lock_guard<std::mutex> guard( m_mtx );
+
+    return m_syncBatchBytes;
+}
+
 void TransferManager::setUnixPermissionMasks( int file,
     int executable, int directory )
 {
@@ -185,7 +383,28 @@ int TransferManager::getUnixDirectoryPermissionMask()
 
 void TransferManager::stop()
 {
-    std::lock_guard<std::mutex> guard( m_mtx );
+    m_running = false;
+
+    {
+        std::lock_guard<std::mutex> guard( m_progressMtx );
+        m_progressCond.notify_all();
+    }
+
+    {
+        std::lock_guard<std::mutex> guard( m_finishMtx );
+        m_finishCond.notify_all();
+    }
+
+    if ( m_progressThread.joinable() )
+    {
+        m_progressThread.join();
+    }
+
+    // Pending ops are recorded right away, not dropped
+    if ( m_finishThread.joinable() )
+    {
+        m_finishThread.join();
+    }
 }
 
 TransferOpPtr TransferManager::registerTransfer( const std::string& remoteId,
@@ -207,10 +426,21 @@ TransferOpPtr TransferManager::registerTransfer( const std::string& remoteId,
         std::lock_guard<std::mutex> lock( *transfer.mutex );
 
         transfer.meta.sentBytes = 0;
+        if ( !transfer.intern.progress )
+        {
+            transfer.intern.progress
+                = std::make_shared<std::atomic<long long>>( 0 );
+        }
+        transfer.intern.progress->store( 0 );
 
         transfer.intern.fileCount = 0;
         transfer.intern.dirCount = 0;
         transfer.intern.remoteId = remoteId;
+        transfer.intern.finishedStreams = 0;
+        transfer.intern.failedStreams = 0;
+        transfer.intern.resumeEntry = -1;
+        transfer.intern.resumeOffset = 0;
+        transfer.intern.resumeInPlace = false;
 
         checkTransferDiskSpace( transfer );
         checkTransferMustOverwrite( transfer );
@@ -303,11 +533,7 @@ void TransferManager::resumeTransfer( const std::string& remoteId,
         return;
     }
 
-    {
-        std::lock_guard<std::mutex> lck( op->intern.pauseLock->mutex );
-        op->intern.pauseLock->value = false;
-        op->intern.pauseLock->condVar.notify_all();
-    }
+    wakeStreams( op );
 
     {
         std::lock_guard<std::mutex> lck( *op->mutex );
@@ -400,12 +626,47 @@ void TransferManager::stopTransfer( const std::string& remoteId,
 }
 
 void TransferManager::finishTransfer( const std::string& remoteId,
-    int transferId )
+    int transferId, OpStatus status )
 {
     std::lock_guard<std::mutex> guard( m_mtx );
+
+    TransferOpPtr op = getTransferInfo( remoteId, transferId );
+
+    if ( !op )
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( *op->mutex );
+
+        // A stop that arrived during the grace period wins
+        if ( op->status == OpStatus::TRANSFERRING
+            || op->status == OpStatus::PAUSED )
+        {
+            op->status = status;
+        }
+    }
+
     doFinishTransfer( remoteId, transferId );
 }
 
+void TransferManager::scheduleFinishTransfer( const std::string& remoteId,
+    int transferId, OpStatus status, long long delayMillis )
+{
+    auto deadline = std::chrono::steady_clock::now()
+        + std::chrono::milliseconds( delayMillis );
+
+    PendingFinish finish;
+    finish.remoteId = remoteId;
+    finish.transferId = transferId;
+    finish.status = status;
+
+    std::lock_guard<std::mutex> guard( m_finishMtx );
+    m_pendingFinishes.emplace( deadline, finish );
+    m_finishCond.notify_all();
+}
+
 void TransferManager::requestStopTransfer( const std::string& remoteId,
     int transferId, bool error )
 {
@@ -467,8 +728,12 @@ void TransferManager::requestStopTransfer( const std::string& remoteId,
 }
 
 bool TransferManager::handleOutcomingTransfer( const std::string& remoteId,
-    int transferId, grpc::ServerWriter<FileChunk>* writer, bool compress )
+    int transferId, grpc::ServerWriter<FileChunk>* writer,
+    const OpInfo& request )
 {
+    int streamIndex = request.stream_index();
+    int streamCount = request.stream_count();
+
     TransferOpPtr op;
     {
         std::lock_guard<std::mutex> guard( m_mtx );
@@ -480,8 +745,28 @@ bool TransferManager::handleOutcomingTransfer( const std::string& remoteId,
         return false;
     }
 
+    ResumePoint resume;
     {
         std::lock_guard<std::mutex> lck( *op->mutex );
+
+        // Receiver can't ask for more streams than we offered,
+        // and peers unaware of streams don't set the count at all
+        streamCount = std::max( std::min( streamCount,
+            op->intern.streamCount ), 1 );
+
+        if ( streamIndex < 0 || streamIndex >= streamCount )
+        {
+            return false;
+        }
+
+        // Receiver only knows what to skip if we told it what we send
+        if ( op->intern.manifestHash != 0 )
+        {
+            resume.setBitmap( request.resume_bitmap() );
+            resume.setPartial( request.resume_entry(),
+                request.resume_offset() );
+        }
+
         op->status = OpStatus::TRANSFERRING;
 
         sendStatusUpdateNotification( remoteId, op );
@@ -491,27 +776,68 @@ bool TransferManager::handleOutcomingTransfer( const std::string& remoteId,
 
     {
         std::lock_guard<std::mutex> guard( m_mtx );
-        sender.setCompressionLevel( compress ? m_compressionLevel : 0 );
+        sender.setCompressionLevel(
+            request.use_compression() ? m_compressionLevel : 0 );
+        sender.setCompressionThreads( m_compressionThreads );
+        sender.setAdaptiveCompression( m_adaptiveCompression );
+        sender.setReadAheadDepth( m_readAheadDepth );
+        sender.setMemoryMapThreshold( m_mmapThreshold );
         sender.setUnixPermissionMasks( m_filePerms, m_execPerms, m_dirPerms );
     }
+    sender.setBandwidthLimiter( m_limiter, remoteId );
+    sender.setShard( streamIndex, streamCount );
+    sender.setResumePoint( resume );
+    sender.setComputeChecksums( request.verify_checksums() );
+    sender.setStreamedDeflate( request.streamed_deflate() );
+    sender.setPresetDictionary( request.preset_dictionary() );
+    sender.setSolidArchive( request.solid_archive() );
 
-    bool result = sender.transferFiles( [&]()
-        { sendStatusUpdateNotification( remoteId, op ); } );
+    bool result = sender.transferFiles();
 
+    bool lastStream = false;
     {
         std::lock_guard<std::mutex> guard( *op->mutex );
-        if ( result )
+        op->intern.finishedStreams++;
+
+        // Like on the receiving side, the op is finished once, by
+        // the last of its streams. The others bail out early when
+        // one of them fails.
+        lastStream = op->intern.finishedStreams >= streamCount;
+
+        bool running = op->status == OpStatus::TRANSFERRING
+            || op->status == OpStatus::PAUSED;
+
+        if ( !result )
         {
-            op->status = OpStatus::FINISHED;
+            op->intern.failedStreams++;
+
+            // A single broken stream ruins the whole op
+            if ( running )
+            {
+                op->status = OpStatus::FAILED_UNRECOVERABLE;
+                sendStatusUpdateNotification( remoteId, op );
+            }
         }
-        else if ( op->status == OpStatus::TRANSFERRING 
-            || op->status == OpStatus::PAUSED )
+        else if ( lastStream && running )
         {
-            op->status = OpStatus::FAILED_UNRECOVERABLE;
+            op->intern.progress->store( op->totalSize );
+            sendStatusUpdateNotification( remoteId, op );
+
+            op->status = OpStatus::FINISHED;
         }
     }
 
-    doFinishTransfer( remoteId, op->id );
+    if ( !result )
+    {
+        // Lets the other streams see the failure instead of
+        // waiting off their bandwidth budget first
+        m_limiter->interrupt();
+    }
+
+    if ( lastStream )
+    {
+        doFinishTransfer( remoteId, op->id );
+    }
 
     return result;
 }
@@ -591,6 +917,8 @@ int TransferManager::createOutcomingTransfer( const std::string& remoteId,
         op.receiverNameUtf8 = "";
     }
     op.useCompression = m_compressionLevel > 0;
+    op.intern.streamCount = m_parallelStreams;
+    op.intern.manifestHash = 0;
 
     if ( files == 0 && folders == 1 )
     {
@@ -759,7 +1087,6 @@ void TransferManager::checkTransferMustOverwrite( TransferOp& op )
 void TransferManager::setTransferTimestamp( TransferOp& op )
 {
     op.meta.localTimestamp = time( NULL );
-    op.intern.lastProgressUpdate = std::chrono::steady_clock::now();
 }
 
 void TransferManager::setUpPauseLock( TransferOp& op )
@@ -768,6 +1095,116 @@ void TransferManager::setUpPauseLock( TransferOp& op )
     op.intern.pauseLock->value = false;
 }
 
+void TransferManager::wakeStreams( TransferOpPtr op )
+{
+    {
+        std::lock_guard<std::mutex> lck( op->intern.pauseLock->mutex );
+        op->intern.pauseLock->value = false;
+        op->intern.pauseLock->condVar.notify_all();
+    }
+
+    std::vector<std::function<void()>> handlers;
+    {
+        std::lock_guard<std::mutex> lck( *op->mutex );
+        handlers = op->intern.wakeHandlers;
+    }
+
+    for ( auto& handler : handlers )
+    {
+        handler();
+    }
+}
+
+void TransferManager::progressPublisherMain()
+{
+    setThreadName( "Transfer progress publisher" );
+
+    std::unique_lock<std::mutex> lock( m_progressMtx );
+
+    while ( true )
+    {
+        m_progressCond.wait_for( lock,
+            std::chrono::milliseconds( PROGRESS_FREQ_MILLIS ),
+            [this]() { return !m_running; } );
+
+        if ( !m_running )
+        {
+            break;
+        }
+
+        lock.unlock();
+        publishProgress();
+        lock.lock();
+    }
+}
+
+void TransferManager::finisherMain()
+{
+    setThreadName( "Transfer finisher" );
+
+    std::unique_lock<std::mutex> lock( m_finishMtx );
+
+    while ( true )
+    {
+        if ( m_pendingFinishes.empty() )
+        {
+            if ( !m_running )
+            {
+                break;
+            }
+
+            m_finishCond.wait( lock );
+            continue;
+        }
+
+        auto next = m_pendingFinishes.begin();
+
+        if ( m_running && std::chrono::steady_clock::now() < next->first )
+        {
+            m_finishCond.wait_until( lock, next->first );
+            continue;
+        }
+
+        PendingFinish finish = next->second;
+        m_pendingFinishes.erase( next );
+
+        // Ops stopped in the meantime are gone already,
+        // finishTransfer ignores them then
+        lock.unlock();
+        finishTransfer( finish.remoteId, finish.transferId, finish.status );
+        lock.lock();
+    }
+}
+
+void TransferManager::publishProgress()
+{
+    // Streams only bump their op's counter, this is the one place
+    // that takes locks and talks to observers about progress
+    std::vector<TransferOpPtr> ops;
+    {
+        std::lock_guard<std::mutex> guard( m_mtx );
+
+        for ( const auto& pair : m_transfers )
+        {
+            ops.insert( ops.end(), pair.second.begin(), pair.second.end() );
+        }
+    }
+
+    for ( const TransferOpPtr& op : ops )
+    {
+        std::lock_guard<std::mutex> lock( *op->mutex );
+
+        bool running = op->status == OpStatus::TRANSFERRING
+            || op->status == OpStatus::PAUSED;
+
+        if ( running && op->intern.progress
+            && op->intern.progress->load() != op->meta.sentBytes )
+        {
+            sendStatusUpdateNotification( op->intern.remoteId, op );
+        }
+    }
+}
+
 void TransferManager::sendNotifications( const std::string& remoteId,
     TransferOp& op, bool actionRequired )
 {
@@ -849,26 +1286,75 @@ void TransferManager::processStartTransfer( const std::string& remoteId,
 
         std::lock_guard<std::mutex> guard( info->mutex );
 
-        std::shared_ptr<grpc::ClientContext> ctx
-            = std::make_shared<grpc::ClientContext>();
+        int streamCount;
+        {
+            std::lock_guard<std::mutex> lck( *op->mutex );
+            streamCount = std::max( std::min( op->intern.streamCount,
+                m_parallelStreams ), 1 );
+            op->intern.streamCount = streamCount;
+        }
+
+        OpInfo baseRequest = convertOpToOpInfo( op, m_compressionLevel > 0 );
+        baseRequest.set_verify_checksums( m_verifyChecksums );
+        baseRequest.set_streamed_deflate( m_streamedDeflate );
+        baseRequest.set_preset_dictionary( m_presetDictionary );
+        baseRequest.set_solid_archive( m_solidArchive );
+
+        ResumePoint resume = loadResumePoint( remoteId, op );
+        if ( !resume.isEmpty() )
+        {
+            wxLogDebug( "TransferManager: resuming transfer (partial entry %d at %lld)",
+                resume.getPartialEntry(), resume.getPartialOffset() );
+
+            baseRequest.set_resume_bitmap( resume.getBitmap() );
+            baseRequest.set_resume_entry(
+                std::max( resume.getPartialEntry(), 0 ) );
+            baseRequest.set_resume_offset( resume.getPartialOffset() );
+        }
+
+        wxLogDebug( "TransferManager: starting transfer! (%d streams)",
+            streamCount );
 
-        std::shared_ptr<OpInfo> request = std::make_shared<OpInfo>(
-            convertOpToOpInfo( op, m_compressionLevel > 0 ) );
+        for ( int i = 0; i < streamCount; i++ )
+        {
+            std::shared_ptr<grpc::ClientContext> ctx
+                = std::make_shared<grpc::ClientContext>();
 
-        std::shared_ptr<StartTransferReactor> reactor
-            = std::make_shared<StartTransferReactor>();
-        reactor->setInstance( reactor );
-        reactor->setRefs( ctx, request );
-        reactor->setTransferPtr( op );
-        reactor->setRemoteId( remoteId );
-        reactor->setManager( this );
-        reactor->setCanOverwrite( op->meta.mustOverwrite );
+            std::shared_ptr<OpInfo> request
+                = std::make_shared<OpInfo>( baseRequest );
 
-        wxLogDebug( "TransferManager: starting transfer!" );
+            if ( streamCount > 1 )
+            {
+                request->set_stream_count( streamCount );
+                request->set_stream_index( i );
+            }
 
-        info->stub->async()->StartTransfer( ctx.get(), request.get(),
-            reactor.get() );
-        reactor->start();
+            std::shared_ptr<StartTransferReactor> reactor
+                = std::make_shared<StartTransferReactor>();
+            reactor->setInstance( reactor );
+            reactor->setRefs( ctx, request );
+            reactor->setTransferPtr( op );
+            reactor->setRemoteId( remoteId );
+            reactor->setManager( this );
+            reactor->setCanOverwrite( op->meta.mustOverwrite );
+            reactor->setVerifyChecksums( m_verifyChecksums );
+            reactor->setStreamedDeflate( m_streamedDeflate );
+
+            // Callers hold m_mtx already, so settings can't be
+            // fetched through the locking getters from start()
+            reactor->setOutputRoot( m_outputPath );
+            reactor->setSyncOptions( m_atomicWrites, m_syncPolicy,
+                m_syncBatchFiles, m_syncBatchBytes );
+
+            // Cores are shared by the streams of the op
+            reactor->setDecompressionThreads( m_compressionThreads > 0
+                    ? m_compressionThreads
+                    : (int)std::thread::hardware_concurrency() / streamCount );
+
+            info->stub->async()->StartTransfer( ctx.get(), request.get(),
+                reactor.get() );
+            reactor->start();
+        }
     }
 
     std::lock_guard<std::mutex> lck( *op->mutex );
@@ -876,6 +1362,111 @@ void TransferManager::processStartTransfer( const std::string& remoteId,
     sendStatusUpdateNotification( remoteId, op );
 }
 
+ResumePoint TransferManager::loadResumePoint( const std::string& remoteId,
+    TransferOpPtr op )
+{
+    ResumePoint point;
+    unsigned long long manifestHash;
+    {
+        std::lock_guard<std::mutex> lck( *op->mutex );
+        manifestHash = op->intern.manifestHash;
+    }
+
+    if ( manifestHash == 0 )
+    {
+        return point;
+    }
+
+    wxLogNull logNull;
+
+    std::vector<db::JournalEntry> journal = m_dbMgr->queryJournal(
+        wxString( remoteId ).ToStdWstring(), manifestHash );
+
+    std::vector<db::TransferElement> elements;
+    int fileCount = 0;
+    int dirCount = 0;
+    long long resumedBytes = 0;
+    int partialEntry = -1;
+    long long partialOffset = 0;
+    bool partialInPlace = false;
+
+    for ( const db::JournalEntry& entry : journal )
+    {
+        wxFileName fname( entry.relativePath );
+        fname.Normalize( wxPATH_NORM_DOTS | wxPATH_NORM_ABSOLUTE,
+            m_outputPath );
+
+        // A partial file is only looked for where the previous attempt
+        // was writing it. An older file under the final name doesn't count.
+        wxString path = fname.GetFullPath();
+        if ( !entry.complete && !entry.inPlace )
+        {
+            path = StartTransferReactor::getTempPath( path );
+        }
+
+        // Anything missing or changed since then is received again
+        long long onDisk = -1;
+        if ( entry.elementType == db::TransferElementType::FOLDER )
+        {
+            onDisk = wxDirExists( path ) ? 0 : -1;
+        }
+        else if ( wxFileExists( path ) )
+        {
+            wxULongLong size = wxFileName::GetSize( path );
+            onDisk = size == wxInvalidSize ? -1 : (long long)size.GetValue();
+        }
+
+        if ( entry.complete && onDisk == entry.bytes )
+        {
+            point.markCompleted( entry.entryIndex );
+            resumedBytes += entry.bytes;
+
+            db::TransferElement element;
+            element.elementType = entry.elementType;
+            element.relativePath = entry.relativePath;
+            element.absolutePath = fname.GetFullPath().ToStdWstring();
+            element.elementName = fname.GetFullName().ToStdWstring();
+            element.checksum = -1;
+            elements.push_back( element );
+
+            if ( entry.relativePath.find( '/' ) == std::wstring::npos )
+            {
+                if ( entry.elementType == db::TransferElementType::FILE )
+                {
+                    fileCount++;
+                }
+                else if ( entry.elementType == db::TransferElementType::FOLDER )
+                {
+                    dirCount++;
+                }
+            }
+        }
+        else if ( !entry.complete && onDisk >= entry.bytes
+            && entry.bytes > partialOffset )
+        {
+            // Sender continues a single file only, other partially
+            // received ones are sent again from the start
+            partialEntry = entry.entryIndex;
+            partialOffset = entry.bytes;
+            partialInPlace = entry.inPlace;
+        }
+    }
+
+    point.setPartial( partialEntry, partialOffset );
+
+    std::lock_guard<std::mutex> lck( *op->mutex );
+    op->intern.resumeEntry = point.getPartialEntry();
+    op->intern.resumeOffset = point.getPartialOffset();
+    op->intern.resumeInPlace = partialInPlace;
+    op->intern.elements.insert( op->intern.elements.end(),
+        elements.begin(), elements.end() );
+    op->intern.fileCount += fileCount;
+    op->intern.dirCount += dirCount;
+    op->intern.progress->store( resumedBytes + point.getPartialOffset() );
+
+    return point;
+}
+
 void TransferManager::processDeclineTransfer( const std::string& remoteId,
     TransferOpPtr op )
 {
@@ -937,6 +1528,12 @@ OpInfo TransferManager::convertOpToOpInfo( const TransferOpPtr op,
 void TransferManager::sendStatusUpdateNotification( const std::string& remoteId,
     const TransferOpPtr op )
 {
+    // Callers hold the op mutex
+    if ( op->intern.progress )
+    {
+        op->meta.sentBytes = op->intern.progress->load();
+    }
+
     m_srv->notifyObservers( [this, &remoteId, &op]( IServiceObserver* observer )
         { observer->onUpdateTransfer( remoteId, *op ); } );
 }
@@ -1003,6 +1600,9 @@ void TransferManager::doFinishTransfer( const std::string& remoteId,
         return;
     }
 
+    // Stopped or failed streams may still be throttled
+    m_limiter->interrupt();
+
     auto remoteInfo = m_remoteMgr->getRemoteInfo( remoteId );
 
     if ( remoteInfo )
@@ -1065,6 +1665,9 @@ void TransferManager::doFinishTransfer( const std::string& remoteId,
 
     m_dbMgr->addTransfer( record );
 
+    // Streams held back by a pause have to run to their end
+    wakeStreams( op );
+
     std::vector<TransferOpPtr>& transferArr = m_transfers[remoteId];
     for ( size_t i = 0; i < transferArr.size(); i++ )
     {
@@ -1077,6 +1680,14 @@ void TransferManager::doFinishTransfer( const std::string& remoteId,
 
     if ( record.status == db::TransferStatus::SUCCEEDED )
     {
+        // Resume state goes only once every stream got to its end
+        if ( !op->outcoming && op->intern.manifestHash != 0
+            && op->intern.failedStreams == 0
+            && op->intern.finishedStreams >= op->intern.streamCount )
+        {
+            m_dbMgr->clearJournal( record.targetId, op->intern.manifestHash );
+        }
+
         if ( op->outcoming )
         {
             sendSuccessNotification( remoteId,
@@ -1105,11 +1716,12 @@ void TransferManager::doSendRequestAfterCrawling( TransferOpPtr op,
         std::lock_guard<std::mutex> guard( *op->mutex );
         op->topDirBasenamesUtf8 = data.topDirBasenamesUtf8;
         op->totalSize = data.totalSize;
-        op->totalCount = data.paths->size();
+        op->totalCount = data.manifest->size();
         op->intern.fileCount = data.fileCount;
         op->intern.dirCount = data.folderCount;
         op->intern.rootDir = data.rootDir;
-        op->intern.relativePaths = data.paths;
+        op->intern.manifest = data.manifest;
+        op->intern.manifestHash = ResumePoint::hashManifest( *data.manifest );
         op->status = OpStatus::WAITING_PERMISSION;
 
         senderName = op->senderNameUtf8;
@@ -1122,6 +1734,8 @@ void TransferManager::doSendRequestAfterCrawling( TransferOpPtr op,
     }
 
     info = new OpInfo( convertOpToOpInfo( op, m_compressionLevel > 0 ) );
+    info->set_stream_count( op->intern.streamCount );
+    info->set_manifest_hash( op->intern.manifestHash );
 
     RemoteInfoPtr remote = m_remoteMgr->getRemoteInfo( op->intern.remoteId );
 
@@ -1134,7 +1748,7 @@ void TransferManager::doSendRequestAfterCrawling( TransferOpPtr op,
     request->set_receiver_name( receiverName );
     request->set_receiver( receiver );
     request->set_size( data.totalSize );
-    request->set_count( data.paths->size() );
+    request->set_count( data.manifest->size() );
     request->set_name_if_single( nameIfSingle );
     request->set_mime_if_single( mimeIfSingle );
     for ( auto& topDir : data.topDirBasenamesUtf8 )
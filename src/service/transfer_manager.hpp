@@ -1,9 +1,14 @@
 #pragma once
+#include "bandwidth_limiter.hpp"
+#include "crc32c.hpp"
 #include "database_manager.hpp"
 #include "event.hpp"
 #include "file_crawler.hpp"
 #include "observable_service.hpp"
+#include "receive_queue.hpp"
 #include "remote_manager.hpp"
+#include "resume_point.hpp"
+#include "solid_archive.hpp"
 #include "transfer_types.hpp"
 #include "zlib_deflate.hpp"
 
@@ -11,9 +16,11 @@
 #include <wx/wx.h>
 
 #include <atomic>
+#include <condition_variable>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <thread>
 #include <vector>
 
 namespace srv
@@ -43,6 +50,25 @@ public:
 
     void setCompressionLevel( int level );
     int getCompressionLevel();
+
+    void setCompressionThreads( int threads );
+    int getCompressionThreads();
+
+    void setAdaptiveCompression( bool adaptive );
+    bool getAdaptiveCompression();
+
+    void setReadAheadDepth( int chunks );
+    int getReadAheadDepth();
+
+    void setMemoryMapThreshold( long long bytes );
+    long long getMemoryMapThreshold();
+
+    // Upper bound of StartTransfer streams a single op is split into
+    void setParallelStreams( int streams );
+    int getParallelStreams();
+
+    // Bytes per second, 0 = unlimited. Applies to running transfers too.
+    void setBandwidthLimits( long long global, long long perRemote );
     
     void setMustAllowIncoming( bool must );
     bool getMustAllowIncoming();
@@ -53,6 +79,32 @@ public:
     void setPreserveZoneInfo( bool preserve );
     bool getPreserveZoneInfo();
 
+    // Asks senders for a CRC-32C of each file we receive
+    void setVerifyChecksums( bool verify );
+    bool getVerifyChecksums();
+
+    // Asks senders to deflate each file as one stream
+    void setStreamedDeflate( bool streamed );
+    bool getStreamedDeflate();
+
+    // Asks senders to prime small files with a preset dictionary
+    void setPresetDictionary( bool enabled );
+    bool getPresetDictionary();
+
+    // Asks senders to pack small files into solid batches
+    void setSolidArchive( bool enabled );
+    bool getSolidArchive();
+
+    // Incoming files get a temporary name until they are complete
+    void setAtomicWrites( bool atomic );
+    bool getAtomicWrites();
+
+    // Batch limits only matter for SyncPolicy::BATCHED
+    void setSyncPolicy( SyncPolicy policy, int batchFiles, long long batchBytes );
+    SyncPolicy getSyncPolicy();
+    int getSyncBatchFiles();
+    long long getSyncBatchBytes();
+
     void setUnixPermissionMasks( int file, int executable, int directory );
     int getUnixFilePermissionMask();
     int getUnixExecutablePermissionMask();
@@ -70,13 +122,19 @@ public:
     void resumeTransfer( const std::string& remoteId, int transferId );
     void pauseTransfer( const std::string& remoteId, int transferId );
     void stopTransfer( const std::string& remoteId, int transferId, bool error );
-    void finishTransfer( const std::string& remoteId, int transferId );
+    // Records the op with the status its streams ended with,
+    // unless it got stopped in the meantime
+    void finishTransfer( const std::string& remoteId, int transferId,
+        OpStatus status );
+    void scheduleFinishTransfer( const std::string& remoteId, int transferId,
+        OpStatus status, long long delayMillis );
     void requestStopTransfer( const std::string& remoteId, 
         int transferId, bool error );
 
     /* Blocking function, call on background thread only! */
     bool handleOutcomingTransfer( const std::string& remoteId, 
-        int transferId, grpc::ServerWriter<FileChunk>* writer, bool compress );
+        int transferId, grpc::ServerWriter<FileChunk>* writer,
+        const OpInfo& request );
     void failAll( const std::string& remoteId );
 
     int createOutcomingTransfer( const std::string& remoteId, 
@@ -102,14 +160,30 @@ private:
         void setRemoteId( const std::string& remoteId );
         void setManager( TransferManager* mgr );
         void setCanOverwrite( bool canOverwrite );
+        void setDecompressionThreads( int threads );
+        void setVerifyChecksums( bool verify );
+        void setStreamedDeflate( bool streamed );
+        void setOutputRoot( const std::wstring& outputRoot );
+        void setSyncOptions( bool atomicWrites, SyncPolicy policy,
+            int batchFiles, long long batchBytes );
 
         void start();
 
         void OnDone( const grpc::Status& s ) override;
         void OnReadDone( bool ok ) override;
+
+        // Where a file is written until it's complete, with atomic writes
+        static wxString getTempPath( const wxString& absolutePath );
     private:
         static const std::wstring ZONE_ID_STREAM;
         static const int INTRANET_ZONE;
+        static const long long JOURNAL_CHECKPOINT_BYTES;
+        static const long long JOURNAL_CHECKPOINT_MILLIS;
+        static const size_t WRITE_QUEUE_DEPTH;
+        static const int MAX_DECOMPRESSION_THREADS;
+        static const long long PREALLOCATE_MIN_SIZE;
+        static const std::wstring TEMP_FILE_SUFFIX;
+        static const int MAX_UNSYNCED_FILES;
 
         std::shared_ptr<StartTransferReactor> m_selfPtr;
 
@@ -121,24 +195,117 @@ private:
         TransferOpPtr m_transfer;
         std::string m_remoteId;
         TransferManager* m_mgr;
+        std::shared_ptr<TokenBucket> m_remoteBucket;
+        std::shared_ptr<std::atomic<long long>> m_progress;
 
+        // Chunks go from gRPC callbacks to a writer thread of their own,
+        // so a slow disk holds back this stream only. Compressed chunks
+        // may be inflated by workers in between, out of order, but the
+        // writer takes them in the order they were received.
         FileChunk m_chunk;
-        ZlibDeflate m_compressor;
+        ReceiveQueue m_writeQueue;
+        std::mutex m_queueMtx;
+        std::condition_variable m_queueCond;
+        bool m_readHeld;
+        bool m_streamEnded;
+        bool m_callDone; // Set by OnDone, along with the call's outcome
+        bool m_callOk;
+        std::thread m_writer;
+        int m_inflateThreads;
+        std::vector<std::thread> m_inflaters;
+
+        // Writer thread state
+        FileChunk m_current;
+        ChunkInflater m_inflater;
+        std::string m_inflated;
+        bool m_inflateOk;
+        bool m_failed; // Set by failOp, nothing reaches the disk after it
         bool m_useCompression;
+        bool m_streamedDeflate;
+        std::string m_dictionary; // Set once, before any file data
+        bool m_inflaterPrimed;
         bool m_canOverwrite;
         
         std::string m_filePtrPath;
         wxFile m_filePtr;
-
-        wxString getAbsolutePath( wxString relativePath );
-        void updatePaths();
+        bool m_preallocated;
+
+        // Written files are kept open until they're synced, only then
+        // they get their real name and are journaled as complete
+        struct FinishedFile
+        {
+            int fd;
+            wxString tempPath; // Empty when written in place
+            wxString finalPath;
+            int entry;
+            std::string relativePath;
+            long long bytes;
+        };
+
+        bool m_atomicWrites;
+        SyncPolicy m_syncPolicy;
+        int m_syncBatchFiles;
+        long long m_syncBatchBytes;
+        wxString m_finalPath;
+        wxString m_tempPath;
+        std::vector<FinishedFile> m_unsynced;
+        long long m_unsyncedBytes;
+
+        // Running checksum of the file being written
+        bool m_verifyChecksums;
+        Crc32c m_fileCrc;
+        bool m_fileCorrupt;
+        size_t m_elementIndex;
+
+        // Resume journal of the op, written in batches
+        unsigned long long m_manifestHash;
+        int m_resumeEntry;
+        long long m_resumeOffset;
+        bool m_resumeInPlace;
+        int m_fileEntry;
+        long long m_fileBytes;
+        long long m_uncheckpointedBytes;
+        std::chrono::steady_clock::time_point m_lastCheckpoint;
+        std::vector<db::JournalEntry> m_journal;
+
+        // Paths are resolved once per file. Other streams of the op append
+        // elements too, so the last one isn't necessarily ours.
+        std::wstring m_outputRoot;
+        std::string m_resolvedFor;
+        wxString m_resolvedPath;
+
+        void writerMain();
+        void finishStream( bool callOk );
+        void decompressorMain();
+        void writeChunk();
+        bool inflateChunk();
+        bool isPaused();
+        void resumeReading();
+        wxString getAbsolutePath( const wxString& relativePath );
+        bool resolvePath( const std::string& relativePath, int fileType );
         void updateProgress( long long chunkBytes );
         void processData( const std::string& dataChunk );
+        void unpackSolidBatch( const std::string& batch );
+        bool startFile( const wxString& absolutePath, int entry,
+            const std::string& relativePath, long long size );
+        void createDirectory( const wxString& absolutePath, int entry,
+            const std::string& relativePath );
+        bool openOutputFile( const wxString& absolutePath );
+        bool preallocateFile( long long size );
+        void releaseUnusedSpace();
+        void finishCurrentFile();
+        void syncFinishedFiles();
+        bool verifyChecksum( uint32_t expected );
+        void journalElement( int entry, db::TransferElementType type,
+            const std::string& relativePath, long long bytes, bool complete,
+            bool inPlace );
+        void checkpointJournal( bool force );
         void failOp();
         bool writeZoneStream( const wxString& absolutePath );
     };
 
     static const long long PROGRESS_FREQ_MILLIS;
+    static const long long FINISH_GRACE_MILLIS;
     static const std::string DEFAULT_MIME_TYPE;
     static const std::string DIRECTORY_MIME_TYPE;
 
@@ -146,6 +313,7 @@ private:
     std::shared_ptr<RemoteManager> m_remoteMgr;
     std::shared_ptr<DatabaseManager> m_dbMgr;
     std::shared_ptr<FileCrawler> m_crawler;
+    std::shared_ptr<BandwidthLimiter> m_limiter;
     std::map<int, TransferOpPtr> m_crawlJobs;
 
     ObservableService* m_srv;
@@ -153,9 +321,22 @@ private:
     std::mutex m_mtx;
     std::wstring m_outputPath;
     int m_compressionLevel;
+    int m_compressionThreads;
+    bool m_adaptiveCompression;
+    int m_readAheadDepth;
+    long long m_mmapThreshold;
+    int m_parallelStreams;
     bool m_mustAllowIncoming;
     bool m_mustAllowOverwrite;
     bool m_preserveZoneInfo;
+    bool m_verifyChecksums;
+    bool m_streamedDeflate;
+    bool m_presetDictionary;
+    bool m_solidArchive;
+    bool m_atomicWrites;
+    SyncPolicy m_syncPolicy;
+    int m_syncBatchFiles;
+    long long m_syncBatchBytes;
 
     int m_filePerms;
     int m_execPerms;
@@ -165,10 +346,34 @@ private:
 
     std::map<std::string, std::vector<TransferOpPtr>> m_transfers;
 
+    // Samples progress counters of running ops and notifies observers
+    std::thread m_progressThread;
+    std::mutex m_progressMtx;
+    std::condition_variable m_progressCond;
+
+    struct PendingFinish
+    {
+        std::string remoteId;
+        int transferId;
+        OpStatus status;
+    };
+
+    // Finished ops waiting to be recorded, by deadline. Streams hand
+    // them over instead of blocking a gRPC thread until then.
+    std::multimap<std::chrono::steady_clock::time_point,
+        PendingFinish> m_pendingFinishes;
+    std::thread m_finishThread;
+    std::mutex m_finishMtx;
+    std::condition_variable m_finishCond;
+
     void checkTransferDiskSpace( TransferOp& op );
     void checkTransferMustOverwrite( TransferOp& op );
     void setTransferTimestamp( TransferOp& op );
     void setUpPauseLock( TransferOp& op );
+    void wakeStreams( TransferOpPtr op );
+    void progressPublisherMain();
+    void publishProgress();
+    void finisherMain();
     void sendNotifications( const std::string& remoteId, TransferOp& op,
         bool actionRequired );
 
@@ -177,6 +382,7 @@ private:
         const std::string& remoteId, time_t timestamp );
 
     void processStartTransfer( const std::string& remoteId, TransferOpPtr op );
+    ResumePoint loadResumePoint( const std::string& remoteId, TransferOpPtr op );
     void processDeclineTransfer( const std::string& remoteId, TransferOpPtr op );
 
     OpInfo convertOpToOpInfo( const TransferOpPtr op, 
@@ -1,6 +1,8 @@
 #include "transfer_manager.hpp"
 
 #include "memory_manager.hpp"
+#include "service_utils.hpp"
+#include "../thread_name.hpp"
 
 #include <wx/filename.h>
 
@@ -10,6 +12,17 @@ namespace srv
 const std::wstring TransferManager::StartTransferReactor::ZONE_ID_STREAM
     = L":Zone.Identifier:$DATA";
 const int TransferManager::StartTransferReactor::INTRANET_ZONE = 1;
+const long long TransferManager::StartTransferReactor::JOURNAL_CHECKPOINT_BYTES
+    = 64 * 1024 * 1024; // 64 MB
+const long long TransferManager::StartTransferReactor::JOURNAL_CHECKPOINT_MILLIS
+    = 2000;
+const size_t TransferManager::StartTransferReactor::WRITE_QUEUE_DEPTH = 8;
+const int TransferManager::StartTransferReactor::MAX_DECOMPRESSION_THREADS = 16;
+const long long TransferManager::StartTransferReactor::PREALLOCATE_MIN_SIZE
+    = 1024 * 1024; // 1 MB
+const std::wstring TransferManager::StartTransferReactor::TEMP_FILE_SUFFIX
+    = L".winpinator-part";
+const int TransferManager::StartTransferReactor::MAX_UNSYNCED_FILES = 256;
 
 void TransferManager::StartTransferReactor::setInstance(
     std::shared_ptr<StartTransferReactor> selfPtr )
@@ -29,6 +42,20 @@ void TransferManager::StartTransferReactor::setTransferPtr( TransferOpPtr ptr )
 {
     m_transfer = ptr;
     m_useCompression = ptr->useCompression;
+
+    std::lock_guard<std::mutex> lock( *ptr->mutex );
+    m_manifestHash = ptr->intern.manifestHash;
+    m_resumeEntry = ptr->intern.resumeEntry;
+    m_resumeOffset = ptr->intern.resumeOffset;
+    m_resumeInPlace = ptr->intern.resumeInPlace;
+    m_progress = ptr->intern.progress;
+    m_fileEntry = -1;
+    m_fileBytes = 0;
+    m_uncheckpointedBytes = 0;
+    m_lastCheckpoint = std::chrono::steady_clock::now();
+    m_preallocated = false;
+    m_fileCorrupt = false;
+    m_elementIndex = 0;
 }
 
 void TransferManager::StartTransferReactor::setRemoteId(
@@ -47,8 +74,95 @@ void TransferManager::StartTransferReactor::setCanOverwrite( bool canOverwrite )
     m_canOverwrite = canOverwrite;
 }
 
+void TransferManager::StartTransferReactor::setDecompressionThreads(
+    int threads )
+{
+    m_inflateThreads = std::max( std::min( threads,
+        MAX_DECOMPRESSION_THREADS ), 1 );
+}
+
+void TransferManager::StartTransferReactor::setVerifyChecksums( bool verify )
+{
+    m_verifyChecksums = verify;
+}
+
+void TransferManager::StartTransferReactor::setStreamedDeflate( bool streamed )
+{
+    m_streamedDeflate = streamed;
+}
+
+void TransferManager::StartTransferReactor::setOutputRoot(
+    const std::wstring& outputRoot )
+{
+    m_outputRoot = outputRoot;
+}
+
+void TransferManager::StartTransferReactor::setSyncOptions( bool atomicWrites,
+    SyncPolicy policy, int batchFiles, long long batchBytes )
+{
+    m_atomicWrites = atomicWrites;
+    m_syncPolicy = policy;
+
+    // Batches hold file handles, so their count is bounded
+    m_syncBatchFiles = std::max( std::min( batchFiles,
+        MAX_UNSYNCED_FILES ), 1 );
+    m_syncBatchBytes = batchBytes;
+}
+
 void TransferManager::StartTransferReactor::start()
 {
+    m_remoteBucket = m_mgr->m_limiter->getRemoteBucket( m_remoteId );
+    m_resolvedFor.clear();
+    m_resolvedPath.clear();
+
+    m_tempPath.clear();
+    m_unsynced.clear();
+    m_unsyncedBytes = 0;
+    m_dictionary.clear();
+    m_inflaterPrimed = false;
+    m_readHeld = false;
+    m_streamEnded = false;
+    m_callDone = false;
+    m_callOk = false;
+    m_failed = false;
+
+    // A single thread inflates inline on the writer, like before.
+    // Pieces of a deflate stream have to be inflated in order.
+    if ( !m_useCompression || m_streamedDeflate )
+    {
+        m_inflateThreads = 1;
+    }
+
+    // Every worker needs a chunk of its own to stay busy
+    m_writeQueue.reset( std::max( WRITE_QUEUE_DEPTH,
+        (size_t)m_inflateThreads * 2 ) );
+
+    // Reads get issued from the writer thread too, so OnDone
+    // must wait until it lets go of the stream
+    AddHold();
+    m_writer = std::thread( std::bind( &StartTransferReactor::writerMain, this ) );
+
+    if ( m_inflateThreads > 1 )
+    {
+        for ( int i = 0; i < m_inflateThreads; i++ )
+        {
+            m_inflaters.emplace_back( std::bind(
+                &StartTransferReactor::decompressorMain, this ) );
+        }
+    }
+
+    std::weak_ptr<StartTransferReactor> weakSelf = m_selfPtr;
+    {
+        std::lock_guard<std::mutex> lock( *m_transfer->mutex );
+        m_transfer->intern.wakeHandlers.push_back( [weakSelf]()
+            {
+                if ( auto self = weakSelf.lock() )
+                {
+                    self->resumeReading();
+                }
+            } );
+    }
+
     StartRead( &m_chunk );
     StartCall();
 }
@@ -58,25 +172,198 @@ void TransferManager::StartTransferReactor::OnDone( const grpc::Status& s )
     wxLogDebug( "StartTransferReactor: Transfer completed, code=%d, msg=%s",
         (int)s.error_code(), s.error_message() );
 
+    // The writer has let go of the stream by now. Joining threads,
+    // syncing files and writing the journal is left to it, so gRPC's
+    // callback thread never waits for the disk.
+    std::lock_guard<std::mutex> lock( m_queueMtx );
+    m_callOk = s.ok();
+    m_callDone = true;
+    m_queueCond.notify_all();
+}
+
+void TransferManager::StartTransferReactor::OnReadDone( bool ok )
+{
+    std::unique_lock<std::mutex> lock( m_queueMtx );
+
+    if ( !ok )
+    {
+        m_streamEnded = true;
+        m_queueCond.notify_all();
+        lock.unlock();
+
+        // The writer may be waiting off its budget
+        m_mgr->m_limiter->interrupt();
+        return;
+    }
+
+    if ( m_chunk.deflate_framing() == (uint32_t)DeflateFraming::DICTIONARY )
+    {
+        // Only taken ahead of file data, so nothing that inflates
+        // ever sees it change
+        if ( !m_writeQueue.hasPublished() )
+        {
+            m_dictionary = m_chunk.chunk();
+        }
+
+        lock.unlock();
+        StartRead( &m_chunk );
+        return;
+    }
+
+    // Payload changes hands without being copied. m_chunk gets the buffers
+    // of a chunk written earlier, so parsing the next one into it
+    // doesn't allocate either.
+    m_writeQueue.publish( m_chunk, m_inflateThreads <= 1 );
+    m_queueCond.notify_all();
+
+    if ( m_writeQueue.isFull() || isPaused() )
     {
-        std::unique_lock<std::mutex> lock( *m_transfer->mutex );
+        // Disk can't keep up or the op is paused. The read gets issued by
+        // the writer once it catches up, or by resumeTransfer. Only this
+        // stream waits, no thread is blocked.
+        m_readHeld = true;
+        return;
+    }
 
-        if ( m_transfer->status == OpStatus::TRANSFERRING
-            || m_transfer->status == OpStatus::PAUSED )
+    lock.unlock();
+    StartRead( &m_chunk );
+}
+
+void TransferManager::StartTransferReactor::writerMain()
+{
+    setThreadName( "Transfer writer" );
+
+    while ( true )
+    {
+        bool resumeReading = false;
         {
-            // Wait for one second (in case a StopTransfer rpc arrives)
+            std::unique_lock<std::mutex> lock( m_queueMtx );
+            m_queueCond.wait( lock, [this]()
+                {
+                    return m_writeQueue.isNextReady()
+                        || ( m_writeQueue.isEmpty() && m_streamEnded );
+                } );
 
-            m_transfer->meta.sentBytes = m_transfer->totalSize + 1;
-            lock.unlock();
+            if ( m_writeQueue.isEmpty() )
+            {
+                break;
+            }
+
+            // Swapping keeps both sets of buffers alive for reuse
+            m_writeQueue.take( m_current, m_inflated, m_inflateOk );
+
+            resumeReading = m_readHeld && !isPaused();
+            if ( resumeReading )
+            {
+                m_readHeld = false;
+            }
+        }
 
-            updateProgress( -1 );
+        if ( resumeReading )
+        {
+            StartRead( &m_chunk );
+        }
 
-            std::this_thread::sleep_for( std::chrono::seconds( 1 ) );
+        // Once anything failed, chunks are only taken off the queue
+        // until the cancelled stream ends
+        if ( !m_failed )
+        {
+            writeChunk();
         }
     }
 
+    RemoveHold();
+
+    // Waits for the outcome of the call, gRPC may report it right
+    // from RemoveHold on this thread
+    bool callOk;
+    {
+        std::unique_lock<std::mutex> lock( m_queueMtx );
+        m_queueCond.wait( lock, [this]() { return m_callDone; } );
+        callOk = m_callOk;
+    }
+
+    finishStream( callOk );
+}
+
+void TransferManager::StartTransferReactor::finishStream( bool callOk )
+{
+    // Queue is drained, so the workers have nothing left to claim
+    for ( std::thread& inflater : m_inflaters )
+    {
+        inflater.join();
+    }
+    m_inflaters.clear();
+
+    // The stream may end fine after the writer gave up on it
+    bool ok = callOk && !m_failed;
+
+    if ( ok )
+    {
+        finishCurrentFile();
+    }
+
+    // Files that were complete get their names even if the stream failed
+    syncFinishedFiles();
+
+    // Whatever made it to disk is kept for the next attempt
+    checkpointJournal( true );
+    releaseUnusedSpace();
     m_filePtr.Close();
-    m_mgr->finishTransfer( m_remoteId, m_transfer->id );
+
+    bool lastStream = false;
+    bool running = false;
+    {
+        std::lock_guard<std::mutex> lock( *m_transfer->mutex );
+
+        m_transfer->intern.finishedStreams++;
+        lastStream = m_transfer->intern.finishedStreams
+            >= m_transfer->intern.streamCount;
+        running = m_transfer->status == OpStatus::TRANSFERRING
+            || m_transfer->status == OpStatus::PAUSED;
+
+        if ( !ok )
+        {
+            m_transfer->intern.failedStreams++;
+
+            // Remaining streams can't make up for the broken one,
+            // and a dropped last stream is no success either
+            if ( running )
+            {
+                m_transfer->status = OpStatus::FAILED;
+                m_mgr->sendStatusUpdateNotification( m_remoteId, m_transfer );
+            }
+        }
+        else if ( lastStream && running )
+        {
+            m_progress->store( m_transfer->totalSize );
+            m_mgr->sendStatusUpdateNotification( m_remoteId, m_transfer );
+        }
+    }
+
+    if ( lastStream )
+    {
+        // A StopTransfer rpc may still arrive, so a successful op is only
+        // recorded after a grace period. Nothing waits here meanwhile.
+        if ( ok && running )
+        {
+            m_mgr->scheduleFinishTransfer( m_remoteId, m_transfer->id,
+                OpStatus::FINISHED, TransferManager::FINISH_GRACE_MILLIS );
+        }
+        else
+        {
+            m_mgr->scheduleFinishTransfer( m_remoteId, m_transfer->id,
+                OpStatus::FAILED, 0 );
+        }
+    }
+    else if ( !ok && running )
+    {
+        // Tell the sender to stop the others
+        failOp();
+    }
+
+    // Nothing may touch the reactor once it's scheduled to be freed
+    m_writer.detach();
 
     StartTransferReactor* pointer = m_selfPtr.get();
     m_selfPtr = nullptr;
@@ -84,49 +371,147 @@ void TransferManager::StartTransferReactor::OnDone( const grpc::Status& s )
     MemoryManager::getInstance()->scheduleFreePointer( pointer );
 }
 
-void TransferManager::StartTransferReactor::OnReadDone( bool ok )
+void TransferManager::StartTransferReactor::decompressorMain()
 {
-    if ( ok )
+    setThreadName( "Transfer decompressor" );
+
+    // Each worker keeps its own inflate state
+    ChunkInflater inflater;
+    bool primed = false;
+
+    while ( true )
     {
-        wxLogDebug( "StartTransferReactor: Successfully received file chunk (name=%s, type=%d, mode=%d, size=%d)",
-            m_chunk.relative_path(), (int)m_chunk.file_type(), (int)m_chunk.file_mode(),
-            (int)m_chunk.chunk().size() );
+        ReceivedChunk* slot;
+        {
+            std::unique_lock<std::mutex> lock( m_queueMtx );
+            m_queueCond.wait( lock, [this]()
+                { return m_writeQueue.hasUnclaimed() || m_streamEnded; } );
+
+            slot = m_writeQueue.claim();
+            if ( !slot )
+            {
+                break;
+            }
 
-        updatePaths();
+            if ( !primed && !m_dictionary.empty() )
+            {
+                inflater.setDictionary( m_dictionary );
+                primed = true;
+            }
+        }
 
-        std::string original = m_chunk.chunk();
-        long long chunkSize = original.size();
-        std::string decompressed;
+        // Slot stays ours until marked processed, the writer waits for it.
+        // Streamed chunks only come when we asked for them, and then
+        // there are no workers.
+        slot->inflateOk = slot->message.deflate_framing()
+                == (uint32_t)DeflateFraming::PER_CHUNK
+            && inflater.inflate( slot->message, slot->inflated );
 
-        if ( m_useCompression )
+        std::lock_guard<std::mutex> lock( m_queueMtx );
+        slot->processed = true;
+        m_queueCond.notify_all();
+    }
+}
+
+void TransferManager::StartTransferReactor::writeChunk()
+{
+    wxLogDebug( "StartTransferReactor: Successfully received file chunk (name=%s, type=%d, mode=%d, size=%d)",
+        m_current.relative_path(), (int)m_current.file_type(), (int)m_current.file_mode(),
+        (int)m_current.chunk().size() );
+
+    // Packed elements carry paths of their own
+    if ( !m_current.solid_batch() )
+    {
+        resolvePath( m_current.relative_path(), m_current.file_type() );
+    }
+
+    // Data is written straight from the message, or from an inflate
+    // buffer that keeps its capacity from chunk to chunk
+    const std::string& payload = m_current.chunk();
+    const std::string* data = &payload;
+
+    if ( m_useCompression )
+    {
+        if ( m_inflateThreads <= 1 )
         {
-            decompressed = m_compressor.decompress( original );
-            chunkSize = decompressed.size();
+            m_inflateOk = inflateChunk();
         }
 
-        updateProgress( chunkSize );
-        processData( m_useCompression ? decompressed : original );
-
-        // Wait if op is paused
-        std::unique_lock<std::mutex> lck( m_transfer->intern.pauseLock->mutex );
-        if ( m_transfer->intern.pauseLock->value )
+        if ( !m_inflateOk )
         {
-            m_transfer->intern.pauseLock->condVar.wait( lck );
-            lck.unlock();
+            wxLogDebug( "StartTransferReactor: TRANSFER FAILED! Corrupt chunk of %s",
+                m_current.relative_path() );
+            failOp();
+            return;
         }
 
-        StartRead( &m_chunk );
+        data = &m_inflated;
+    }
+
+    if ( m_current.solid_batch() )
+    {
+        unpackSolidBatch( *data );
+    }
+    else
+    {
+        updateProgress( data->size() );
+        processData( *data );
+    }
+
+    // Journal never gets past data that didn't make it to disk
+    if ( !m_failed )
+    {
+        checkpointJournal( false );
     }
+
+    // Holding the next read back lets flow control slow the sender down
+    m_mgr->m_limiter->throttle( m_remoteBucket.get(), payload.size(),
+        [this]()
+        {
+            std::lock_guard<std::mutex> guard( m_queueMtx );
+            return m_streamEnded;
+        } );
+}
+
+bool TransferManager::StartTransferReactor::inflateChunk()
+{
+    if ( !m_inflaterPrimed && !m_dictionary.empty() )
+    {
+        m_inflater.setDictionary( m_dictionary );
+        m_inflaterPrimed = true;
+    }
+
+    return m_inflater.inflate( m_current, m_inflated );
+}
+
+bool TransferManager::StartTransferReactor::isPaused()
+{
+    std::lock_guard<std::mutex> lock( m_transfer->intern.pauseLock->mutex );
+    return m_transfer->intern.pauseLock->value;
+}
+
+void TransferManager::StartTransferReactor::resumeReading()
+{
+    std::unique_lock<std::mutex> lock( m_queueMtx );
+
+    if ( !m_readHeld || m_writeQueue.isFull() || isPaused() )
+    {
+        return;
+    }
+
+    m_readHeld = false;
+    lock.unlock();
+
+    StartRead( &m_chunk );
 }
 
 wxString TransferManager::StartTransferReactor::getAbsolutePath(
-    wxString relativePath )
+    const wxString& relativePath )
 {
     wxLogNull null;
 
-    std::wstring outputPath = m_mgr->getOutputPath();
     wxFileName fname( relativePath );
-    fname.Normalize( wxPATH_NORM_DOTS | wxPATH_NORM_ABSOLUTE, outputPath );
+    fname.Normalize( wxPATH_NORM_DOTS | wxPATH_NORM_ABSOLUTE, m_outputRoot );
 
     if ( !fname.IsOk() )
     {
@@ -134,8 +519,16 @@ wxString TransferManager::StartTransferReactor::getAbsolutePath(
     }
 
     wxString fullPath = fname.GetFullPath();
+    wxString rest;
+
+    // The root has to be a whole directory of the result,
+    // "C:\Out" doesn't contain "C:\Outside\file"
+    bool insideRoot = !m_outputRoot.empty()
+        && fullPath.StartsWith( m_outputRoot, &rest )
+        && ( rest.empty() || wxFileName::IsPathSeparator( rest[0] )
+            || wxFileName::IsPathSeparator( m_outputRoot.back() ) );
 
-    if ( !fullPath.Contains( outputPath ) )
+    if ( !insideRoot )
     {
         // We've been probably tricked to save outside the output path
         return wxEmptyString;
@@ -144,158 +537,544 @@ wxString TransferManager::StartTransferReactor::getAbsolutePath(
     return fullPath;
 }
 
-void TransferManager::StartTransferReactor::updatePaths()
+bool TransferManager::StartTransferReactor::resolvePath(
+    const std::string& relativePath, int fileType )
 {
-    wxLogNull logNull;
-
-    std::wstring lastPath = L"";
-    if ( !m_transfer->intern.elements.empty() )
+    // Chunks of the same file only cost a string comparison,
+    // conversion and validation happen when a new file starts
+    if ( relativePath == m_resolvedFor )
     {
-        lastPath = m_transfer->intern.elements.back().relativePath;
+        return !m_resolvedPath.empty();
     }
 
+    wxLogNull logNull;
+
+    m_resolvedFor = relativePath;
+    m_resolvedPath.clear();
+
     std::wstring currentPath;
-    currentPath = wxString::FromUTF8( m_chunk.relative_path() ).ToStdWstring();
+    currentPath = wxString::FromUTF8( m_resolvedFor ).ToStdWstring();
 
-    if ( currentPath.find( L':' ) != std::wstring::npos )
+    if ( currentPath.empty() || currentPath.find( L':' ) != std::wstring::npos )
     {
         wxLogDebug( "StartTransferReactor: Ignoring invalid path! (%s)",
             currentPath );
+        return false;
+    }
+
+    m_resolvedPath = getAbsolutePath( currentPath );
+
+    if ( m_resolvedPath.empty() )
+    {
+        wxLogDebug( "StartTransferReactor: Ignoring invalid path 2! (%s)",
+            currentPath );
+        return false;
+    }
+
+    wxLogDebug( "StartTransferReactor: Appending new path (%s, absolute: %s)",
+        currentPath, m_resolvedPath );
+
+    db::TransferElement element;
+    element.absolutePath = m_resolvedPath.ToStdWstring();
+    element.relativePath = currentPath;
+
+    if ( fileType == (int)FileType::REGULAR_FILE )
+    {
+        element.elementType = db::TransferElementType::FILE;
+    }
+    else if ( fileType == (int)FileType::DIRECTORY )
+    {
+        element.elementType = db::TransferElementType::FOLDER;
     }
-    else if ( lastPath != currentPath )
+
+    wxFileName fname( element.absolutePath );
+    element.elementName = fname.GetFullName().ToStdWstring();
+    element.checksum = -1;
+
+    std::lock_guard<std::mutex> guard( *m_transfer->mutex );
+    m_transfer->intern.elements.push_back( element );
+    m_elementIndex = m_transfer->intern.elements.size() - 1;
+
+    if ( currentPath.find( '/' ) == std::string::npos )
     {
-        wxString absolutePath = getAbsolutePath( currentPath );
+        // We want to count top level elements only
 
-        if ( absolutePath.empty() )
+        if ( fileType == (int)FileType::REGULAR_FILE )
         {
-            wxLogDebug( "StartTransferReactor: Ignoring invalid path 2! (%s)",
-                currentPath );
+            m_transfer->intern.fileCount++;
         }
-        else
+
+        if ( fileType == (int)FileType::DIRECTORY )
         {
-            wxLogDebug( "StartTransferReactor: Appending new path (%s, absolute: %s)",
-                currentPath, absolutePath );
+            m_transfer->intern.dirCount++;
+        }
+    }
+
+    return true;
+}
 
-            db::TransferElement element;
-            element.absolutePath = absolutePath.ToStdWstring();
-            element.relativePath = currentPath;
+void TransferManager::StartTransferReactor::updateProgress( long long chunkBytes )
+{
+    // Observers hear about it from the manager's progress publisher
+    m_progress->fetch_add( chunkBytes, std::memory_order_relaxed );
+}
 
-            if ( m_chunk.file_type() == (int)FileType::REGULAR_FILE )
-            {
-                element.elementType = db::TransferElementType::FILE;
-            }
-            else if ( m_chunk.file_type() == (int)FileType::DIRECTORY )
+void TransferManager::StartTransferReactor::processData( const std::string& chunk )
+{
+    const std::string& relativePath = m_current.relative_path();
+    const wxString& absolutePath = m_resolvedPath;
+
+    if ( absolutePath.empty() )
+    {
+        // Rejected by resolvePath, the data is dropped
+        return;
+    }
+
+    wxLogNull logNull;
+
+    if ( m_current.file_type() == (int)FileType::REGULAR_FILE )
+    {
+        if ( relativePath != m_filePtrPath
+            && !startFile( absolutePath, m_current.entry_index(),
+                relativePath, m_current.file_size() ) )
+        {
+            return;
+        }
+
+        // Only what really got written counts, for the journal too
+        size_t written = m_filePtr.Write( chunk.data(), chunk.size() );
+        m_fileBytes += written;
+        m_uncheckpointedBytes += written;
+
+        if ( written != chunk.size() )
+        {
+            wxLogDebug( "StartTransferReactor: TRANSFER FAILED! Can't write to %s", absolutePath );
+            failOp();
+            return;
+        }
+
+        if ( m_verifyChecksums )
+        {
+            m_fileCrc.update( chunk.data(), chunk.size() );
+
+            if ( m_current.file_crc32c_set()
+                && !verifyChecksum( m_current.file_crc32c() ) )
             {
-                element.elementType = db::TransferElementType::FOLDER;
+                wxLogDebug( "StartTransferReactor: TRANSFER FAILED! Checksum mismatch for %s", absolutePath );
+                failOp();
+                return;
             }
+        }
+    }
+    else if ( m_current.file_type() == (int)FileType::DIRECTORY )
+    {
+        createDirectory( absolutePath, m_current.entry_index(), relativePath );
+    }
+}
 
-            wxFileName fname( element.absolutePath );
-            element.elementName = fname.GetFullName().ToStdWstring();
+void TransferManager::StartTransferReactor::unpackSolidBatch(
+    const std::string& batch )
+{
+    wxLogNull logNull;
 
-            std::lock_guard<std::mutex> guard( *m_transfer->mutex );
-            m_transfer->intern.elements.push_back( element );
+    SolidArchiveReader reader( batch.data(), batch.size() );
+    PackedRecord record;
 
-            if ( currentPath.find( '/' ) == std::string::npos )
-            {
-                // We want to count top level elements only
+    while ( !m_failed && reader.next( record ) )
+    {
+        updateProgress( record.length );
 
-                if ( m_chunk.file_type() == (int)FileType::REGULAR_FILE )
-                {
-                    m_transfer->intern.fileCount++;
-                }
+        if ( !resolvePath( record.relativePath, (int)record.type ) )
+        {
+            // Rejected, like paths of elements sent on their own
+            continue;
+        }
 
-                if ( m_chunk.file_type() == (int)FileType::DIRECTORY )
-                {
-                    m_transfer->intern.dirCount++;
-                }
+        if ( record.type == FileType::DIRECTORY )
+        {
+            createDirectory( m_resolvedPath, record.entry,
+                record.relativePath );
+            continue;
+        }
+
+        if ( record.type != FileType::REGULAR_FILE )
+        {
+            continue;
+        }
+
+        if ( !startFile( m_resolvedPath, record.entry, record.relativePath,
+                 (long long)record.length ) )
+        {
+            return;
+        }
+
+        size_t written = m_filePtr.Write( record.data, record.length );
+        m_fileBytes += written;
+        m_uncheckpointedBytes += written;
+
+        if ( written != record.length )
+        {
+            // Left unfinished, so it isn't renamed or journaled complete
+            wxLogDebug( "StartTransferReactor: TRANSFER FAILED! Can't write to %s", m_resolvedPath );
+            failOp();
+            return;
+        }
+
+        if ( m_verifyChecksums && record.hasChecksum )
+        {
+            m_fileCrc.update( record.data, record.length );
+
+            if ( !verifyChecksum( record.checksum ) )
+            {
+                wxLogDebug( "StartTransferReactor: TRANSFER FAILED! Checksum mismatch for %s", m_resolvedPath );
+                finishCurrentFile();
+                failOp();
+                return;
             }
         }
+
+        // The whole file is here, it doesn't have to wait for the next one
+        finishCurrentFile();
+        m_filePtrPath.clear();
+    }
+
+    if ( !reader.isValid() )
+    {
+        wxLogDebug( "StartTransferReactor: TRANSFER FAILED! Corrupt solid batch" );
+        failOp();
     }
 }
 
-void TransferManager::StartTransferReactor::updateProgress( long long chunkBytes )
+bool TransferManager::StartTransferReactor::startFile(
+    const wxString& absolutePath, int entry, const std::string& relativePath,
+    long long size )
 {
-    using namespace std::chrono;
-    std::lock_guard<std::mutex> lock( m_mgr->m_mtx );
+    finishCurrentFile();
+    m_filePtrPath = relativePath;
+    m_fileEntry = entry;
+    m_fileBytes = 0;
+    m_fileCrc.reset();
+    m_fileCorrupt = false;
+
+    // With several streams, files can arrive before the stream
+    // carrying directories gets to their parent
+    wxFileName fname( absolutePath );
+    if ( !wxDirExists( fname.GetPath() ) )
+    {
+        wxFileName::Mkdir( fname.GetPath(), wxS_DIR_DEFAULT,
+            wxPATH_MKDIR_FULL );
+    }
 
+    if ( !openOutputFile( absolutePath ) )
     {
-        std::lock_guard<std::mutex> transferLock( *m_transfer->mutex );
-        m_transfer->meta.sentBytes += chunkBytes;
+        wxLogDebug( "StartTransferReactor: TRANSFER FAILED! Can't create file %s", absolutePath );
+        failOp();
+        return false;
     }
 
-    auto currentTime = std::chrono::steady_clock::now();
-    long long millisElapsed = duration_cast<milliseconds>(
-        currentTime - m_transfer->intern.lastProgressUpdate )
-                                  .count();
+    if ( !preallocateFile( size ) )
+    {
+        wxLogDebug( "StartTransferReactor: TRANSFER FAILED! Not enough space for %s", absolutePath );
+        failOp();
+        return false;
+    }
 
-    if ( millisElapsed > TransferManager::PROGRESS_FREQ_MILLIS || chunkBytes == -1 )
+    if ( m_mgr->getPreserveZoneInfo() )
     {
-        std::lock_guard<std::mutex> transferLock( *m_transfer->mutex );
+        // Renaming the file takes the stream along
+        writeZoneStream( m_tempPath.empty()
+                ? absolutePath
+                : m_tempPath );
+    }
+
+    return true;
+}
 
-        if ( m_transfer->status == OpStatus::TRANSFERRING
-            || m_transfer->status == OpStatus::PAUSED )
+void TransferManager::StartTransferReactor::createDirectory(
+    const wxString& absolutePath, int entry, const std::string& relativePath )
+{
+    if ( !wxDirExists( absolutePath ) )
+    {
+        if ( wxFileExists( absolutePath ) )
         {
-            m_mgr->sendStatusUpdateNotification( m_remoteId, m_transfer );
-            m_transfer->intern.lastProgressUpdate = currentTime;
+            wxRemoveFile( absolutePath );
+        }
+
+        if ( !wxMkdir( absolutePath ) )
+        {
+            wxLogDebug( "StartTransferReactor: TRANSFER FAILED! Can't create directory %s", absolutePath );
+            failOp();
+            return;
         }
     }
+
+    journalElement( entry, db::TransferElementType::FOLDER,
+        relativePath, 0, true, true );
 }
 
-void TransferManager::StartTransferReactor::processData( const std::string& chunk )
+bool TransferManager::StartTransferReactor::openOutputFile(
+    const wxString& absolutePath )
 {
-    std::string relativePath = m_chunk.relative_path();
-    wxString absolutePath = getAbsolutePath( wxString::FromUTF8( relativePath ) );
+    wxString tempPath = getTempPath( absolutePath );
+    m_finalPath = absolutePath;
+    m_tempPath.clear();
 
-    if ( absolutePath.empty() )
+    if ( m_manifestHash == 0 || m_fileEntry != m_resumeEntry )
+    {
+        if ( !m_atomicWrites )
+        {
+            return m_filePtr.Create( absolutePath, m_canOverwrite, wxS_DEFAULT );
+        }
+
+        // Existing file stays intact until the new one is complete
+        if ( !m_canOverwrite && wxFileExists( absolutePath ) )
+        {
+            return false;
+        }
+
+        m_tempPath = tempPath;
+        return m_filePtr.Create( m_tempPath, true, wxS_DEFAULT );
+    }
+
+    // Continue where the previous attempt stopped, in the file it was
+    // writing, the sender skips the same number of bytes. That attempt
+    // may have been made with the other write mode. A file that is gone
+    // isn't created again, it would miss the skipped part.
+    m_resumeEntry = -1;
+    m_fileBytes = m_resumeOffset;
+
+    if ( !m_resumeInPlace )
+    {
+        m_tempPath = tempPath;
+    }
+
+    return m_filePtr.Open( m_tempPath.empty() ? absolutePath : m_tempPath,
+               wxFile::read_write )
+        && m_filePtr.Seek( m_resumeOffset ) != wxInvalidOffset;
+}
+
+wxString TransferManager::StartTransferReactor::getTempPath(
+    const wxString& absolutePath )
+{
+    return absolutePath + TEMP_FILE_SUFFIX;
+}
+
+bool TransferManager::StartTransferReactor::preallocateFile( long long size )
+{
+    // Older peers don't send the size, and small files
+    // don't fragment enough to be worth it
+    if ( size < PREALLOCATE_MIN_SIZE )
+    {
+        return true;
+    }
+
+    bool outOfSpace = false;
+
+    if ( Utils::setFileAllocation( m_filePtr.fd(), size, outOfSpace ) )
+    {
+        m_preallocated = true;
+        return true;
+    }
+
+    // File systems without support for it just grow the file as before
+    return !outOfSpace;
+}
+
+void TransferManager::StartTransferReactor::releaseUnusedSpace()
+{
+    if ( !m_preallocated || !m_filePtr.IsOpened() )
     {
         return;
     }
 
+    m_preallocated = false;
+
+    // Length only ever covers what was written, so a file that ended
+    // early or failed gives back the rest of its reservation
+    wxFileOffset length = m_filePtr.Length();
+    bool outOfSpace;
+
+    if ( length != wxInvalidOffset )
+    {
+        Utils::setFileAllocation( m_filePtr.fd(), length, outOfSpace );
+    }
+}
+
+void TransferManager::StartTransferReactor::finishCurrentFile()
+{
+    if ( !m_filePtr.IsOpened() )
+    {
+        return;
+    }
+
+    releaseUnusedSpace();
+
+    if ( m_fileCorrupt )
+    {
+        // Keeps its temporary name and is sent again from the start
+        // when the op is resumed
+        m_filePtr.Close();
+        journalElement( m_fileEntry, db::TransferElementType::FILE,
+            m_filePtrPath, 0, false, m_tempPath.empty() );
+        return;
+    }
+
+    FinishedFile file;
+    file.fd = m_filePtr.Detach();
+    file.tempPath = m_tempPath;
+    file.finalPath = m_finalPath;
+    file.entry = m_fileEntry;
+    file.relativePath = m_filePtrPath;
+    file.bytes = m_fileBytes;
+
+    m_unsynced.push_back( file );
+    m_unsyncedBytes += m_fileBytes;
+
+    if ( m_syncPolicy != SyncPolicy::BATCHED
+        || (int)m_unsynced.size() >= m_syncBatchFiles
+        || m_unsyncedBytes >= m_syncBatchBytes )
+    {
+        syncFinishedFiles();
+    }
+}
+
+void TransferManager::StartTransferReactor::syncFinishedFiles()
+{
     wxLogNull logNull;
 
-    if ( m_chunk.file_type() == (int)FileType::REGULAR_FILE )
+    bool sync = m_syncPolicy != SyncPolicy::NONE;
+    bool renameFailed = false;
+
+    // Flushing the whole batch before renaming any of it means
+    // a file never shows up under its name with data missing
+    for ( FinishedFile& file : m_unsynced )
     {
-        if ( relativePath != m_filePtrPath )
+        wxFile handle( file.fd );
+
+        if ( sync )
         {
-            m_filePtr.Close();
-            m_filePtrPath = relativePath;
+            handle.Flush();
+        }
 
-            if ( !m_filePtr.Create( absolutePath, m_canOverwrite, wxS_DEFAULT ) )
-            {
-                wxLogDebug( "StartTransferReactor: TRANSFER FAILED! Can't create file %s", absolutePath );
-                failOp();
-                return;
-            }
+        // Open files can't be renamed
+        handle.Close();
+    }
 
-            if ( m_mgr->getPreserveZoneInfo() )
-            {
-                writeZoneStream( absolutePath );
-            }
+    for ( FinishedFile& file : m_unsynced )
+    {
+        if ( !file.tempPath.empty()
+            && !Utils::replaceFile( file.tempPath, file.finalPath, sync ) )
+        {
+            // Data is all there, a resume only has to retry the rename
+            wxLogDebug( "StartTransferReactor: TRANSFER FAILED! Can't rename %s to %s",
+                file.tempPath, file.finalPath );
+            journalElement( file.entry, db::TransferElementType::FILE,
+                file.relativePath, file.bytes, false, false );
+            renameFailed = true;
+            continue;
         }
 
-        m_filePtr.Write( chunk.data(), chunk.size() );
+        journalElement( file.entry, db::TransferElementType::FILE,
+            file.relativePath, file.bytes, true, true );
     }
-    else if ( m_chunk.file_type() == (int)FileType::DIRECTORY )
+
+    m_unsynced.clear();
+    m_unsyncedBytes = 0;
+
+    if ( renameFailed )
     {
-        if ( !wxDirExists( absolutePath ) )
-        {
-            if ( wxFileExists( absolutePath ) )
-            {
-                wxRemoveFile( absolutePath );
-            }
+        failOp();
+    }
+}
 
-            if ( !wxMkdir( absolutePath ) )
-            {
-                wxLogDebug( "StartTransferReactor: TRANSFER FAILED! Can't create directory %s", absolutePath );
-                failOp();
-                return;
-            }
-        }
+bool TransferManager::StartTransferReactor::verifyChecksum(
+    uint32_t expected )
+{
+    uint32_t checksum = m_fileCrc.getValue();
+
+    if ( checksum != expected )
+    {
+        m_fileCorrupt = true;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> guard( *m_transfer->mutex );
+    m_transfer->intern.elements[m_elementIndex].checksum = checksum;
+
+    return true;
+}
+
+void TransferManager::StartTransferReactor::journalElement( int entry,
+    db::TransferElementType type, const std::string& relativePath,
+    long long bytes, bool complete, bool inPlace )
+{
+    if ( m_manifestHash == 0 )
+    {
+        return;
     }
+
+    db::JournalEntry record;
+    record.targetId = wxString( m_remoteId ).ToStdWstring();
+    record.manifestHash = m_manifestHash;
+    record.entryIndex = entry;
+    record.elementType = type;
+    record.relativePath = wxString::FromUTF8( relativePath ).ToStdWstring();
+    record.bytes = bytes;
+    record.complete = complete;
+    record.inPlace = inPlace;
+
+    m_journal.push_back( record );
+}
+
+void TransferManager::StartTransferReactor::checkpointJournal( bool force )
+{
+    using namespace std::chrono;
+
+    if ( m_manifestHash == 0 )
+    {
+        return;
+    }
+
+    auto currentTime = steady_clock::now();
+    long long millisElapsed = duration_cast<milliseconds>(
+        currentTime - m_lastCheckpoint )
+                                  .count();
+
+    if ( !force && m_uncheckpointedBytes < JOURNAL_CHECKPOINT_BYTES
+        && millisElapsed < JOURNAL_CHECKPOINT_MILLIS )
+    {
+        return;
+    }
+
+    if ( m_filePtr.IsOpened() )
+    {
+        // Journal must never claim more than what's really on disk.
+        // Files finished since the last checkpoint were closed without
+        // syncing, so only a power loss (not a crash) can cost them.
+        // A file that failed its checksum is sent again from the start
+        m_filePtr.Flush();
+        journalElement( m_fileEntry, db::TransferElementType::FILE,
+            m_filePtrPath, m_fileCorrupt ? 0 : m_fileBytes, false,
+            m_tempPath.empty() );
+    }
+
+    if ( !m_journal.empty() )
+    {
+        m_mgr->m_dbMgr->updateJournal( m_journal );
+        m_journal.clear();
+    }
+
+    m_uncheckpointedBytes = 0;
+    m_lastCheckpoint = currentTime;
 }
 
 void TransferManager::StartTransferReactor::failOp()
 {
+    // Whatever is still queued or on its way gets dropped, and the
+    // stream is cut even if the sender can't be told to stop
+    m_failed = true;
+    m_clientCtx->TryCancel();
+
     m_mgr->requestStopTransfer( m_remoteId, m_transfer->id, true );
 }
 
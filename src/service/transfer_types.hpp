@@ -3,6 +3,8 @@
 
 #include <atomic>
 #include <chrono>
+#include <ctime>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -37,6 +39,43 @@ enum class FileType
     SYMBOLIC_LINK
 };
 
+// How the payload of a FileChunk was deflated
+enum class DeflateFraming
+{
+    PER_CHUNK, // Every chunk is a zlib stream of its own
+    STREAM_START, // First piece of the file's stream
+    STREAM_PART, // Continues where the previous chunk of the file ended
+    DICTIONARY // Carries the preset dictionary, not file data
+};
+
+// When received files are forced out to the disk
+enum class SyncPolicy
+{
+    NONE,
+    PER_FILE,
+    BATCHED // Once every few files or megabytes
+};
+
+enum class PermissionClass
+{
+    REGULAR,
+    EXECUTABLE, // Known from the name, contents don't have to be checked
+    DIRECTORY
+};
+
+// Everything the sender needs to know about an element, gathered
+// once while crawling
+struct ManifestEntry
+{
+    std::wstring relativePath;
+    FileType type;
+    long long size;
+    std::time_t mtime;
+    PermissionClass permClass;
+};
+
+typedef std::vector<ManifestEntry> TransferManifest;
+
 struct EventLock
 {
     std::mutex mutex;
@@ -78,19 +117,40 @@ struct TransferOp : public TransferOpPub
 {
     struct
     {
-        std::chrono::steady_clock::time_point lastProgressUpdate;
+        // Bytes moved so far. Streams only add to it without locking,
+        // the progress publisher copies it to meta.sentBytes.
+        std::shared_ptr<std::atomic<long long>> progress;
         std::shared_ptr<EventLock> pauseLock;
 
+        // Run when a paused op goes on or ends, receiving streams
+        // re-arm their reads from here instead of waiting on pauseLock
+        std::vector<std::function<void()>> wakeHandlers;
+
         std::vector<db::TransferElement> elements;
 
         std::string remoteId;
         std::wstring rootDir;
-        std::shared_ptr<std::vector<std::wstring>> relativePaths;
+        std::shared_ptr<TransferManifest> manifest;
 
         int fileCount;
         int dirCount;
 
         int crawlJobId;
+
+        // StartTransfer streams the op is split into, how many
+        // of them are already done and how many of those broke off
+        int streamCount;
+        int finishedStreams;
+        int failedStreams;
+
+        // Identifies the files of the op across restarts,
+        // 0 if the peer can't resume
+        unsigned long long manifestHash;
+
+        // Partially received entry the sender was asked to continue
+        int resumeEntry;
+        long long resumeOffset;
+        bool resumeInPlace; // Under its final name, not a temporary one
     } intern;
 };
 
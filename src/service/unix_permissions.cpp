@@ -3,6 +3,11 @@
 namespace srv
 {
 
+const std::vector<std::wstring> UnixPermissions::EXECUTABLE_EXTENSIONS = {
+    L"py",
+    L"sh"
+};
+
 UnixPermissions::UnixPermissions()
     : owner( { 0, 0, 0 } )
     , group( { 0, 0, 0 } )
@@ -74,6 +79,20 @@ bool UnixPermissions::checkElfHeader( const void* data, int length )
     return chr[0] == 0x7F && chr[1] == 'E' && chr[2] == 'L' && chr[3] == 'F';
 }
 
+bool UnixPermissions::hasExecutableExtension( const std::wstring& path )
+{
+    for ( const std::wstring& ext : EXECUTABLE_EXTENSIONS )
+    {
+        if ( path.size() >= ext.size()
+            && path.compare( path.size() - ext.size(), ext.size(), ext ) == 0 )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void UnixPermissions::setPermGroupToDigit(
     PermGroup& group, unsigned char digit )
 {
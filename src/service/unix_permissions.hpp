@@ -1,4 +1,6 @@
 #pragma once
+#include <string>
+#include <vector>
 
 namespace srv
 {
@@ -31,8 +33,11 @@ public:
     short convertToChmod();
 
     static bool checkElfHeader( const void* data, int length );
+    static bool hasExecutableExtension( const std::wstring& path );
 
 private:
+    static const std::vector<std::wstring> EXECUTABLE_EXTENSIONS;
+
     static void setPermGroupToDigit( PermGroup& group, unsigned char digit );
     static unsigned char getDigitFromPermGroup( const PermGroup& group );
 };
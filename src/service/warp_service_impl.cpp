@@ -182,6 +182,8 @@ Status WarpServiceImpl::ProcessTransferOpRequest( grpc::ServerContext* context,
         if ( existingOp->startTime == info.timestamp() )
         {
             existingOp->useCompression = info.use_compression();
+            existingOp->intern.streamCount = std::max( (int)info.stream_count(), 1 );
+            existingOp->intern.manifestHash = info.manifest_hash();
             existingOp->status = OpStatus::WAITING_PERMISSION;
 
             lock.unlock();
@@ -203,6 +205,8 @@ Status WarpServiceImpl::ProcessTransferOpRequest( grpc::ServerContext* context,
     op.mimeIfSingleUtf8 = request->mime_if_single();
     op.nameIfSingleUtf8 = request->name_if_single();
     op.useCompression = info.use_compression();
+    op.intern.streamCount = std::max( (int)info.stream_count(), 1 );
+    op.intern.manifestHash = info.manifest_hash();
 
     for ( std::string basename : request->top_dir_basenames() )
     {
@@ -230,8 +234,8 @@ Status WarpServiceImpl::StartTransfer( grpc::ServerContext* context,
             "Invalid sender ident" );
     }
 
-    bool result = m_transferMgr->handleOutcomingTransfer( 
-        id, op.id, writer, request->use_compression() );
+    bool result = m_transferMgr->handleOutcomingTransfer( id, op.id, writer,
+        *request );
 
     if ( result ) {
         return Status::OK;
@@ -294,11 +294,26 @@ void WinpinatorService::serviceMain()
     m_transferMgr->setRemoteManager( m_remoteMgr );
     m_transferMgr->setCompressionLevel(
         m_settings.useCompression ? m_settings.zlibCompressionLevel : 0 );
+    m_transferMgr->setCompressionThreads( m_settings.compressionThreads );
+    m_transferMgr->setAdaptiveCompression( m_settings.adaptiveCompression );
+    m_transferMgr->setStreamedDeflate( m_settings.streamedDeflate );
+    m_transferMgr->setPresetDictionary( m_settings.presetDictionary );
+    m_transferMgr->setSolidArchive( m_settings.solidArchive );
+    m_transferMgr->setReadAheadDepth( m_settings.readAheadChunks );
+    m_transferMgr->setMemoryMapThreshold(
+        m_settings.memoryMapThresholdMb * 1024LL * 1024LL );
+    m_transferMgr->setParallelStreams( m_settings.parallelStreams );
+    m_transferMgr->setBandwidthLimits( m_settings.bandwidthLimitKb * 1024LL,
+        m_settings.remoteBandwidthLimitKb * 1024LL );
     m_transferMgr->setDatabaseManager( m_db );
     m_transferMgr->setCrawlerPtr( m_crawler );
     m_transferMgr->setMustAllowIncoming( m_settings.askReceiveFiles );
     m_transferMgr->setMustAllowOverwrite( m_settings.askOverwriteFiles );
     m_transferMgr->setPreserveZoneInfo( m_settings.preserveZoneInfo );
+    m_transferMgr->setVerifyChecksums( m_settings.verifyChecksums );
+    m_transferMgr->setAtomicWrites( m_settings.atomicWrites );
+    m_transferMgr->setSyncPolicy( (SyncPolicy)m_settings.syncPolicy,
+        m_settings.syncBatchFiles, m_settings.syncBatchMb * 1024LL * 1024LL );
     m_transferMgr->setUnixPermissionMasks( 
         m_settings.filesDefaultPermissions,
         m_settings.executablesDefaultPermissions, 
@@ -474,6 +489,17 @@ void WinpinatorService::serviceMain()
         }
         else if ( ev.type == EventType::RESTART_SERVICE )
         {
+            if ( ev.eventData.restartData
+                && ev.eventData.restartData->canApplyLive( m_settings ) )
+            {
+                // Running transfers don't have to be interrupted
+                m_settings = *ev.eventData.restartData;
+                m_transferMgr->setBandwidthLimits(
+                    m_settings.bandwidthLimitKb * 1024LL,
+                    m_settings.remoteBandwidthLimitKb * 1024LL );
+                continue;
+            }
+
             if ( ev.eventData.restartData )
             {
                 m_settings = *ev.eventData.restartData;
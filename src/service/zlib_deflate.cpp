@@ -1,87 +1,389 @@
 #include "zlib_deflate.hpp"
 
 #include <algorithm>
+#include <unordered_map>
 
 namespace srv
 {
 
 const int ZlibDeflate::ZLIB_MAX_COMPRESSION_FACTOR = 1032;
+const size_t ZlibDeflate::INITIAL_INFLATE_FACTOR = 2;
+// Priming hashes the whole dictionary for every chunk, so it's kept
+// well below the 32 kB the deflate window would allow
+const size_t ZlibDeflate::MAX_DICTIONARY_SIZE = 8 * 1024; // 8 kB
+const size_t ZlibDeflate::MIN_DICTIONARY_LINE = 8;
 
 ZlibDeflate::ZlibDeflate( int maxChunkSize )
     : m_maxChunk( maxChunkSize )
+    , m_deflateStream()
+    , m_deflateReady( false )
+    , m_deflateLevel( 0 )
+    , m_inflateStream()
+    , m_inflateReady( false )
 {
 }
 
+ZlibDeflate::~ZlibDeflate()
+{
+    if ( m_deflateReady )
+    {
+        deflateEnd( &m_deflateStream );
+    }
+
+    if ( m_inflateReady )
+    {
+        inflateEnd( &m_inflateStream );
+    }
+}
+
 std::string ZlibDeflate::compress( const std::string& input,
     int compressionLevel )
 {
     std::string compressed;
-    z_stream stream = { 0 };
 
-    setupZlibStream( stream );
+    if ( !compress( input.data(), input.size(), compressed, compressionLevel ) )
+    {
+        return "";
+    }
 
-    stream.avail_in = input.size();
-    stream.next_in = (Bytef*)input.data();
+    compressed.shrink_to_fit();
+    return compressed;
+}
 
-    stream.avail_out = 0;
-    stream.next_out = Z_NULL;
+bool ZlibDeflate::compress( const char* input, size_t length,
+    std::string& output, int compressionLevel, bool useDictionary )
+{
+    output.clear();
 
-    if ( deflateInit( &stream, compressionLevel ) != Z_OK )
+    if ( !beginDeflate( compressionLevel, useDictionary )
+        || !deflatePart( input, length, output, Flush::FINISH ) )
     {
-        return "";
+        output.clear();
+        return false;
     }
 
-    uint32_t bufferSize = deflateBound( &stream, input.size() );
-    compressed.resize( bufferSize );
+    return true;
+}
 
-    stream.avail_out = bufferSize;
-    stream.next_out = (Bytef*)compressed.data();
+std::string ZlibDeflate::decompress( const std::string& input )
+{
+    std::string decompressed;
 
-    deflate( &stream, Z_FINISH );
-    uint32_t actualLength = bufferSize - stream.avail_out;
+    decompress( input.data(), input.size(), decompressed );
+    decompressed.shrink_to_fit();
 
-    compressed.resize( actualLength );
-    compressed.shrink_to_fit();
+    return decompressed;
+}
 
-    deflateEnd( &stream );
-    
-    return compressed;
+bool ZlibDeflate::decompress( const char* input, size_t length,
+    std::string& output )
+{
+    if ( length == 0 )
+    {
+        output.clear();
+        return true;
+    }
+
+    if ( !beginInflate() )
+    {
+        output.clear();
+        return false;
+    }
+
+    m_inflateStream.avail_in = length;
+    m_inflateStream.next_in = (Bytef*)input;
+
+    // Start with whatever room is left from earlier chunks,
+    // grow only when the data doesn't fit
+    const size_t limit = std::min( (size_t)m_maxChunk,
+        length * ZLIB_MAX_COMPRESSION_FACTOR );
+    size_t bufferSize = std::min( std::max( output.capacity(),
+                                      length * INITIAL_INFLATE_FACTOR ),
+        limit );
+
+    return inflateInto( output, 0, bufferSize, limit ) == Z_STREAM_END;
 }
 
-std::string ZlibDeflate::decompress( const std::string& input )
+bool ZlibDeflate::beginDeflate( int compressionLevel, bool useDictionary )
 {
-    std::string decompressed;
-    z_stream stream = { 0 };
+    // deflateInit allocates the window and hash chains, so it's done only once
+    if ( !m_deflateReady )
+    {
+        setupZlibStream( m_deflateStream );
+        m_deflateStream.avail_in = 0;
+        m_deflateStream.next_in = Z_NULL;
 
-    setupZlibStream( stream );
+        if ( deflateInit( &m_deflateStream, compressionLevel ) != Z_OK )
+        {
+            return false;
+        }
 
-    stream.avail_in = input.size();
-    stream.next_in = (Bytef*)input.data();
+        m_deflateReady = true;
+        m_deflateLevel = compressionLevel;
+    }
+    else if ( deflateReset( &m_deflateStream ) != Z_OK )
+    {
+        return false;
+    }
 
-    stream.avail_out = 0;
-    stream.next_out = Z_NULL;
+    // Has to come before anything is deflated, deflateParams included
+    if ( useDictionary && !m_dictionary.empty()
+        && deflateSetDictionary( &m_deflateStream,
+               (const Bytef*)m_dictionary.data(), m_dictionary.size() )
+            != Z_OK )
+    {
+        return false;
+    }
 
-    if ( inflateInit( &stream ) != Z_OK )
+    // Adaptive compression picks a level for every chunk
+    if ( compressionLevel != m_deflateLevel )
     {
-        return "";
+        if ( deflateParams( &m_deflateStream, compressionLevel,
+                 Z_DEFAULT_STRATEGY )
+            != Z_OK )
+        {
+            return false;
+        }
+
+        m_deflateLevel = compressionLevel;
     }
 
-    uint32_t bufferSize = std::min( (unsigned long long)m_maxChunk, 
-        (unsigned long long)input.size() * ZLIB_MAX_COMPRESSION_FACTOR );
-    decompressed.resize( bufferSize );
+    return true;
+}
 
-    stream.avail_out = bufferSize;
-    stream.next_out = (Bytef*)decompressed.data();
+bool ZlibDeflate::deflatePart( const char* input, size_t length,
+    std::string& output, Flush flush )
+{
+    if ( !m_deflateReady )
+    {
+        return false;
+    }
 
-    inflate( &stream, Z_NO_FLUSH );
-    uint32_t actualLength = bufferSize - stream.avail_out;
+    int mode = Z_NO_FLUSH;
+    if ( flush == Flush::SYNC )
+    {
+        mode = Z_SYNC_FLUSH;
+    }
+    else if ( flush == Flush::FINISH )
+    {
+        mode = Z_FINISH;
+    }
 
-    decompressed.resize( actualLength );
-    decompressed.shrink_to_fit();
+    z_stream& stream = m_deflateStream;
+    stream.avail_in = length;
+    stream.next_in = (Bytef*)input;
 
-    inflateEnd( &stream );
+    // Room for the whole input up front, so it normally takes a single
+    // pass. Shrinking the string afterwards keeps its capacity, so a buffer
+    // reused for every chunk is only allocated once.
+    size_t produced = output.size();
+    size_t bufferSize = std::max( output.capacity(),
+        produced + deflateBound( &stream, length ) );
+    int result;
 
-    return decompressed;
+    while ( true )
+    {
+        output.resize( bufferSize );
+        stream.avail_out = bufferSize - produced;
+        stream.next_out = (Bytef*)&output[produced];
+
+        result = deflate( &stream, mode );
+        produced = bufferSize - stream.avail_out;
+
+        // Output space left over means deflate had nothing more to give
+        if ( result == Z_STREAM_ERROR || stream.avail_out > 0 )
+        {
+            break;
+        }
+
+        bufferSize *= 2;
+    }
+
+    output.resize( produced );
+
+    if ( result == Z_STREAM_ERROR )
+    {
+        return false;
+    }
+
+    return mode != Z_FINISH || result == Z_STREAM_END;
+}
+
+bool ZlibDeflate::beginInflate()
+{
+    // inflateInit allocates the window, so it's done only once
+    if ( !m_inflateReady )
+    {
+        setupZlibStream( m_inflateStream );
+        m_inflateStream.avail_in = 0;
+        m_inflateStream.next_in = Z_NULL;
+
+        if ( inflateInit( &m_inflateStream ) != Z_OK )
+        {
+            return false;
+        }
+
+        m_inflateReady = true;
+        return true;
+    }
+
+    return inflateReset( &m_inflateStream ) == Z_OK;
+}
+
+bool ZlibDeflate::inflatePart( const char* input, size_t length,
+    std::string& output, bool& finished )
+{
+    finished = false;
+
+    if ( !m_inflateReady )
+    {
+        return false;
+    }
+
+    m_inflateStream.avail_in = length;
+    m_inflateStream.next_in = (Bytef*)input;
+
+    // A single piece may not inflate to more than a whole chunk
+    size_t start = output.size();
+    size_t limit = start + m_maxChunk;
+    size_t bufferSize = std::min( std::max( output.capacity(),
+                                      start + length * INITIAL_INFLATE_FACTOR ),
+        limit );
+
+    int result = inflateInto( output, start, bufferSize, limit );
+    finished = result == Z_STREAM_END;
+
+    // Z_BUF_ERROR only says the piece ended before the stream did
+    return finished
+        || ( ( result == Z_OK || result == Z_BUF_ERROR )
+            && m_inflateStream.avail_in == 0 );
+}
+
+int ZlibDeflate::inflateInto( std::string& output, size_t produced,
+    size_t bufferSize, size_t limit )
+{
+    z_stream& stream = m_inflateStream;
+    int result;
+
+    while ( true )
+    {
+        output.resize( bufferSize );
+        stream.avail_out = bufferSize - produced;
+        stream.next_out = (Bytef*)&output[produced];
+
+        result = inflate( &stream, Z_NO_FLUSH );
+        produced = bufferSize - stream.avail_out;
+
+        // Zlib checks it's the same dictionary the data was deflated with
+        if ( result == Z_NEED_DICT && !m_dictionary.empty()
+            && inflateSetDictionary( &stream,
+                   (const Bytef*)m_dictionary.data(), m_dictionary.size() )
+                == Z_OK )
+        {
+            continue;
+        }
+
+        if ( result != Z_OK || stream.avail_out > 0 || bufferSize >= limit )
+        {
+            break;
+        }
+
+        bufferSize = std::min( bufferSize * 2, limit );
+    }
+
+    output.resize( produced );
+
+    return result;
+}
+
+void ZlibDeflate::setDictionary( const std::string& dictionary )
+{
+    m_dictionary = dictionary.substr( 0, MAX_DICTIONARY_SIZE );
+}
+
+std::string ZlibDeflate::buildDictionary(
+    const std::vector<std::string>& samples )
+{
+    struct LineStats
+    {
+        int samples;
+        int lastSample;
+    };
+
+    std::unordered_map<std::string, LineStats> lines;
+
+    for ( int i = 0; i < (int)samples.size(); i++ )
+    {
+        const std::string& sample = samples[i];
+        size_t start = 0;
+
+        while ( start < sample.size() )
+        {
+            size_t end = sample.find( '\n', start );
+            end = end == std::string::npos ? sample.size() : end + 1;
+
+            if ( end - start >= MIN_DICTIONARY_LINE )
+            {
+                LineStats& stats = lines[sample.substr( start, end - start )];
+
+                if ( stats.samples == 0 || stats.lastSample != i )
+                {
+                    stats.samples++;
+                    stats.lastSample = i;
+                }
+            }
+
+            start = end;
+        }
+    }
+
+    // A line is worth as many bytes as it saves in the files repeating it
+    std::vector<std::pair<size_t, const std::string*>> common;
+    for ( const auto& pair : lines )
+    {
+        if ( pair.second.samples > 1 )
+        {
+            common.emplace_back( ( pair.second.samples - 1 ) * pair.first.size(),
+                &pair.first );
+        }
+    }
+
+    std::sort( common.begin(), common.end(),
+        []( const std::pair<size_t, const std::string*>& a,
+            const std::pair<size_t, const std::string*>& b )
+        {
+            return a.first != b.first ? a.first > b.first : *a.second < *b.second;
+        } );
+
+    std::vector<const std::string*> chosen;
+    size_t chosenSize = 0;
+
+    for ( const auto& candidate : common )
+    {
+        if ( chosenSize + candidate.second->size() <= MAX_DICTIONARY_SIZE )
+        {
+            chosen.push_back( candidate.second );
+            chosenSize += candidate.second->size();
+        }
+    }
+
+    // Room left over is filled with the samples themselves, they still
+    // share keywords and markup even where whole lines differ
+    std::string dictionary;
+    dictionary.reserve( MAX_DICTIONARY_SIZE );
+
+    for ( const std::string& sample : samples )
+    {
+        size_t room = MAX_DICTIONARY_SIZE - chosenSize - dictionary.size();
+        dictionary.append( sample, 0, std::min( room, sample.size() ) );
+    }
+
+    for ( auto it = chosen.rbegin(); it != chosen.rend(); it++ )
+    {
+        dictionary += **it;
+    }
+
+    return dictionary;
 }
 
 void ZlibDeflate::setupZlibStream( z_stream& stream )
@@ -2,22 +2,78 @@
 #include <zlib.h>
 
 #include <string>
+#include <vector>
 
 namespace srv
 {
 
+// Keeps one deflate and one inflate state for its whole lifetime,
+// chunks only reset them. Not thread safe, every thread needs its own.
 class ZlibDeflate
 {
 public:
+    enum class Flush
+    {
+        NONE,
+        SYNC, // Everything fed so far can be inflated on its own
+        FINISH
+    };
+
     explicit ZlibDeflate( int maxChunkSize = 8 * 1024 * 1024 );
+    ~ZlibDeflate();
+
+    ZlibDeflate( const ZlibDeflate& ) = delete;
+    ZlibDeflate& operator=( const ZlibDeflate& ) = delete;
 
     std::string compress( const std::string& input, int compressionLevel );
+
+    // Compresses into the given buffer, reusing its capacity. Chunks primed
+    // with the dictionary only inflate with the same one set.
+    bool compress( const char* input, size_t length, std::string& output,
+        int compressionLevel, bool useDictionary = false );
+
     std::string decompress( const std::string& input );
 
+    // Decompresses into the given buffer, reusing its capacity.
+    // Fails on corrupt or truncated data.
+    bool decompress( const char* input, size_t length, std::string& output );
+
+    // Incremental interface, a stream is started once and then fed
+    // any number of pieces. Output is appended to the given buffer.
+    bool beginDeflate( int compressionLevel, bool useDictionary = false );
+    bool deflatePart( const char* input, size_t length, std::string& output,
+        Flush flush );
+
+    bool beginInflate();
+    bool inflatePart( const char* input, size_t length, std::string& output,
+        bool& finished );
+
+    // Preset dictionary, used for inflating whenever a stream asks for it
+    void setDictionary( const std::string& dictionary );
+
+    // Picks what small files of a transfer have in common. Lines found
+    // in several samples go last, where they are cheapest to refer to.
+    static std::string buildDictionary( const std::vector<std::string>& samples );
+
+    static const size_t MAX_DICTIONARY_SIZE;
+
 private:
     static const int ZLIB_MAX_COMPRESSION_FACTOR;
+    static const size_t INITIAL_INFLATE_FACTOR;
+    static const size_t MIN_DICTIONARY_LINE;
     int m_maxChunk;
+    std::string m_dictionary;
+
+    // Set up by their first use, then only reset
+    z_stream m_deflateStream;
+    bool m_deflateReady;
+    int m_deflateLevel;
+
+    z_stream m_inflateStream;
+    bool m_inflateReady;
 
+    int inflateInto( std::string& output, size_t produced,
+        size_t bufferSize, size_t limit );
     void setupZlibStream( z_stream& stream );
 };
 
@@ -12,10 +12,25 @@ SettingsModel::SettingsModel()
     , autorunHidden( true )
     , useCompression( true )
     , zlibCompressionLevel( 5 )
+    , adaptiveCompression( true )
+    , streamedDeflate( false )
+    , presetDictionary( false )
+    , solidArchive( false )
+    , compressionThreads( 0 )
+    , readAheadChunks( 8 )
+    , memoryMapThresholdMb( 256 )
+    , parallelStreams( 1 )
+    , bandwidthLimitKb( 0 )
+    , remoteBandwidthLimitKb( 0 )
     , outputPath( wxEmptyString )
     , askReceiveFiles( true )
     , askOverwriteFiles( true )
     , preserveZoneInfo( true )
+    , verifyChecksums( false )
+    , atomicWrites( false )
+    , syncPolicy( 0 )
+    , syncBatchFiles( 64 )
+    , syncBatchMb( 64 )
     , filesDefaultPermissions( 664 )
     , foldersDefaultPermissions( 775 )
     , executablesDefaultPermissions( 775 )
@@ -48,10 +63,40 @@ void SettingsModel::loadFrom( wxConfigBase* config )
         "Transfer/UseCompression", getDefaults()->useCompression );
     zlibCompressionLevel = config->ReadLong(
         "Transfer/ZlibCompressionLevel", getDefaults()->zlibCompressionLevel );
+    adaptiveCompression = config->ReadBool(
+        "Transfer/AdaptiveCompression", getDefaults()->adaptiveCompression );
+    streamedDeflate = config->ReadBool(
+        "Transfer/StreamedDeflate", getDefaults()->streamedDeflate );
+    presetDictionary = config->ReadBool(
+        "Transfer/PresetDictionary", getDefaults()->presetDictionary );
+    solidArchive = config->ReadBool(
+        "Transfer/SolidArchive", getDefaults()->solidArchive );
+    compressionThreads = config->ReadLong(
+        "Transfer/CompressionThreads", getDefaults()->compressionThreads );
+    readAheadChunks = config->ReadLong(
+        "Transfer/ReadAheadChunks", getDefaults()->readAheadChunks );
+    memoryMapThresholdMb = config->ReadLong(
+        "Transfer/MemoryMapThresholdMB", getDefaults()->memoryMapThresholdMb );
+    parallelStreams = config->ReadLong(
+        "Transfer/ParallelStreams", getDefaults()->parallelStreams );
+    bandwidthLimitKb = config->ReadLong(
+        "Transfer/BandwidthLimitKB", getDefaults()->bandwidthLimitKb );
+    remoteBandwidthLimitKb = config->ReadLong(
+        "Transfer/RemoteBandwidthLimitKB", getDefaults()->remoteBandwidthLimitKb );
     outputPath = config->Read(
         "Transfer/OutputPath", getDefaults()->outputPath );
     askReceiveFiles = config->ReadBool(
         "Transfer/AskReceiveFiles", getDefaults()->askReceiveFiles );
+    verifyChecksums = config->ReadBool(
+        "Transfer/VerifyChecksums", getDefaults()->verifyChecksums );
+    atomicWrites = config->ReadBool(
+        "Transfer/AtomicWrites", getDefaults()->atomicWrites );
+    syncPolicy = config->ReadLong(
+        "Transfer/SyncPolicy", getDefaults()->syncPolicy );
+    syncBatchFiles = config->ReadLong(
+        "Transfer/SyncBatchFiles", getDefaults()->syncBatchFiles );
+    syncBatchMb = config->ReadLong(
+        "Transfer/SyncBatchMB", getDefaults()->syncBatchMb );
     askOverwriteFiles = config->ReadBool(
         "Transfer/AskOverwriteFiles", getDefaults()->askOverwriteFiles );
 
@@ -82,9 +127,24 @@ void SettingsModel::saveTo( wxConfigBase* config )
 
     config->Write( "Transfer/UseCompression", useCompression );
     config->Write( "Transfer/ZlibCompressionLevel", zlibCompressionLevel );
+    config->Write( "Transfer/AdaptiveCompression", adaptiveCompression );
+    config->Write( "Transfer/StreamedDeflate", streamedDeflate );
+    config->Write( "Transfer/PresetDictionary", presetDictionary );
+    config->Write( "Transfer/SolidArchive", solidArchive );
+    config->Write( "Transfer/CompressionThreads", compressionThreads );
+    config->Write( "Transfer/ReadAheadChunks", readAheadChunks );
+    config->Write( "Transfer/MemoryMapThresholdMB", memoryMapThresholdMb );
+    config->Write( "Transfer/ParallelStreams", parallelStreams );
+    config->Write( "Transfer/BandwidthLimitKB", bandwidthLimitKb );
+    config->Write( "Transfer/RemoteBandwidthLimitKB", remoteBandwidthLimitKb );
     config->Write( "Transfer/OutputPath", outputPath );
     config->Write( "Transfer/AskReceiveFiles", askReceiveFiles );
     config->Write( "Transfer/AskOverwriteFiles", askOverwriteFiles );
+    config->Write( "Transfer/VerifyChecksums", verifyChecksums );
+    config->Write( "Transfer/AtomicWrites", atomicWrites );
+    config->Write( "Transfer/SyncPolicy", syncPolicy );
+    config->Write( "Transfer/SyncBatchFiles", syncBatchFiles );
+    config->Write( "Transfer/SyncBatchMB", syncBatchMb );
 
     config->Write( "Permissions/File", filesDefaultPermissions );
     config->Write( "Permissions/Folder", foldersDefaultPermissions );
@@ -96,6 +156,41 @@ void SettingsModel::saveTo( wxConfigBase* config )
     config->Write( "Connection/RegistrationPort", registrationPort );
 }
 
+bool SettingsModel::canApplyLive( const SettingsModel& previous ) const
+{
+    // Bandwidth limits are the only ones adjustable on the fly
+    return localeName == previous.localeName
+        && openWindowOnStart == previous.openWindowOnStart
+        && autorun == previous.autorun
+        && autorunHidden == previous.autorunHidden
+        && useCompression == previous.useCompression
+        && zlibCompressionLevel == previous.zlibCompressionLevel
+        && adaptiveCompression == previous.adaptiveCompression
+        && streamedDeflate == previous.streamedDeflate
+        && presetDictionary == previous.presetDictionary
+        && solidArchive == previous.solidArchive
+        && compressionThreads == previous.compressionThreads
+        && readAheadChunks == previous.readAheadChunks
+        && memoryMapThresholdMb == previous.memoryMapThresholdMb
+        && parallelStreams == previous.parallelStreams
+        && outputPath == previous.outputPath
+        && askReceiveFiles == previous.askReceiveFiles
+        && askOverwriteFiles == previous.askOverwriteFiles
+        && preserveZoneInfo == previous.preserveZoneInfo
+        && verifyChecksums == previous.verifyChecksums
+        && atomicWrites == previous.atomicWrites
+        && syncPolicy == previous.syncPolicy
+        && syncBatchFiles == previous.syncBatchFiles
+        && syncBatchMb == previous.syncBatchMb
+        && filesDefaultPermissions == previous.filesDefaultPermissions
+        && executablesDefaultPermissions == previous.executablesDefaultPermissions
+        && foldersDefaultPermissions == previous.foldersDefaultPermissions
+        && groupCode == previous.groupCode
+        && networkInterface == previous.networkInterface
+        && transferPort == previous.transferPort
+        && registrationPort == previous.registrationPort;
+}
+
 inline SettingsModel* SettingsModel::getDefaults()
 {
     if ( !SettingsModel::s_defaultInstance )
@@ -12,6 +12,10 @@ public:
     void loadFrom( wxConfigBase* config );
     void saveTo( wxConfigBase* config );
 
+    // Whether the running service can take over these settings
+    // from the previous ones without being restarted
+    bool canApplyLive( const SettingsModel& previous ) const;
+
     // Settings fields
 
     wxString localeName;
@@ -21,10 +25,25 @@ public:
 
     bool useCompression;
     int zlibCompressionLevel;
+    bool adaptiveCompression;
+    bool streamedDeflate;
+    bool presetDictionary;
+    bool solidArchive;
+    int compressionThreads;
+    int readAheadChunks;
+    int memoryMapThresholdMb;
+    int parallelStreams;
+    int bandwidthLimitKb; // Per second, 0 = unlimited
+    int remoteBandwidthLimitKb;
     wxString outputPath;
     bool askReceiveFiles;
     bool askOverwriteFiles;
     bool preserveZoneInfo;
+    bool verifyChecksums;
+    bool atomicWrites;
+    int syncPolicy; // Values of srv::SyncPolicy
+    int syncBatchFiles;
+    int syncBatchMb;
 
     int filesDefaultPermissions;
     int executablesDefaultPermissions;
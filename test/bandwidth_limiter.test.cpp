@@ -0,0 +1,234 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../src/service/bandwidth_limiter.cpp"
+
+using namespace srv;
+
+class BandwidthLimiterTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        instance = std::make_shared<BandwidthLimiter>();
+        bucket = std::make_shared<TokenBucket>();
+    }
+
+    void TearDown() override
+    {
+        instance = nullptr;
+        bucket = nullptr;
+    }
+
+    // Runs one thread per remote id, each throttling bytes in chunks
+    // the way transfer streams do, returns the seconds it took
+    double RunStreams( const std::vector<std::string>& remotes,
+        long long bytesPerStream, long long chunkSize )
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> streams;
+
+        for ( const std::string& remoteId : remotes )
+        {
+            streams.emplace_back( [this, remoteId, bytesPerStream, chunkSize]()
+                {
+                    std::shared_ptr<TokenBucket> remote
+                        = instance->getRemoteBucket( remoteId );
+
+                    for ( long long sent = 0; sent < bytesPerStream;
+                          sent += chunkSize )
+                    {
+                        instance->throttle( remote.get(), chunkSize );
+                    }
+                } );
+        }
+
+        for ( std::thread& stream : streams )
+        {
+            stream.join();
+        }
+
+        return std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start )
+            .count();
+    }
+
+    static double Seconds( std::chrono::nanoseconds wait )
+    {
+        return std::chrono::duration<double>( wait ).count();
+    }
+
+    std::shared_ptr<BandwidthLimiter> instance;
+    std::shared_ptr<TokenBucket> bucket;
+};
+
+TEST_F( BandwidthLimiterTest, expectDebtBeyondBurstIsWaitedOff )
+{
+    bucket->setRate( 1024 * 1024, 256 * 1024 );
+
+    // 1 MB at 1 MB/s with a quarter of a second of burst
+    EXPECT_NEAR( Seconds( bucket->reserve( 1024 * 1024 ) ), 0.75, 0.05 );
+    EXPECT_NEAR( Seconds( bucket->reserve( 512 * 1024 ) ), 1.25, 0.05 );
+}
+
+TEST_F( BandwidthLimiterTest, expectConcurrentReservationsAreNeverLost )
+{
+    const int threadCount = 8;
+    const int reservations = 2048;
+    const long long chunk = 1024;
+
+    // 16 MB at 1 MB/s, nobody actually sleeps
+    bucket->setRate( 1024 * 1024, 256 * 1024 );
+
+    std::vector<std::vector<std::chrono::nanoseconds>> waits( threadCount );
+    std::vector<std::thread> threads;
+
+    for ( int i = 0; i < threadCount; i++ )
+    {
+        threads.emplace_back( [this, &waits, i, reservations, chunk]()
+            {
+                for ( int j = 0; j < reservations; j++ )
+                {
+                    waits[i].push_back( bucket->reserve( chunk ) );
+                }
+            } );
+    }
+
+    for ( std::thread& thread : threads )
+    {
+        thread.join();
+    }
+
+    std::vector<std::chrono::nanoseconds> all;
+    for ( const auto& thread : waits )
+    {
+        all.insert( all.end(), thread.begin(), thread.end() );
+    }
+
+    std::sort( all.begin(), all.end() );
+
+    // Every reservation got a slot of its own behind the one before it
+    EXPECT_NEAR( Seconds( all.back() ), 16.0 - 0.25, 0.05 );
+    for ( size_t i = 1; i < all.size(); i++ )
+    {
+        if ( all[i - 1].count() > 0 )
+        {
+            ASSERT_GT( all[i], all[i - 1] ) << "Reservation " << i;
+        }
+    }
+}
+
+TEST_F( BandwidthLimiterTest, expectStreamsShareGlobalLimit )
+{
+    // 4 MB/s and a burst of 1 MB for 4 MB in total
+    instance->setLimits( 4 * 1024 * 1024, 0 );
+
+    double seconds = RunStreams( { "a", "b", "c", "d" }, 1024 * 1024,
+        16 * 1024 );
+
+    EXPECT_NEAR( seconds, 0.75, 0.1 );
+}
+
+TEST_F( BandwidthLimiterTest, expectRemotesAreLimitedSeparately )
+{
+    // 1 MB/s with a burst of 256 kB per remote. Two streams of one
+    // remote share its budget, the other remote has its own.
+    instance->setLimits( 0, 1024 * 1024 );
+
+    double seconds = RunStreams( { "a", "a", "b" }, 384 * 1024, 16 * 1024 );
+
+    EXPECT_NEAR( seconds, 0.5, 0.1 );
+}
+
+TEST_F( BandwidthLimiterTest, expectStricterOfBothLimitsWins )
+{
+    // Remotes alone would allow 2 MB/s together, global allows 1 MB/s
+    instance->setLimits( 1024 * 1024, 1024 * 1024 );
+
+    double seconds = RunStreams( { "a", "b" }, 384 * 1024, 16 * 1024 );
+
+    EXPECT_NEAR( seconds, 0.5, 0.1 );
+}
+
+TEST_F( BandwidthLimiterTest, expectLiftedLimitReleasesRunningStreams )
+{
+    // Would take 16 seconds at this rate
+    instance->setLimits( 256 * 1024, 0 );
+
+    std::thread lifter( [this]()
+        {
+            std::this_thread::sleep_for( std::chrono::milliseconds( 200 ) );
+            instance->setLimits( 0, 0 );
+        } );
+
+    double seconds = RunStreams( { "a", "b", "c", "d" }, 1024 * 1024,
+        16 * 1024 );
+    lifter.join();
+
+    // Only the reservations already made are slept off
+    EXPECT_LT( seconds, 0.8 );
+}
+
+TEST_F( BandwidthLimiterTest, expectLimitChangeWakesWaitingStream )
+{
+    // A single chunk that would be waited off for 16 seconds
+    instance->setLimits( 256 * 1024, 0 );
+
+    std::thread lifter( [this]()
+        {
+            std::this_thread::sleep_for( std::chrono::milliseconds( 200 ) );
+            instance->setLimits( 0, 0 );
+        } );
+
+    auto start = std::chrono::steady_clock::now();
+    bool sent = instance->throttle( nullptr, 4 * 1024 * 1024 + 64 * 1024 );
+    double seconds = Seconds( std::chrono::steady_clock::now() - start );
+    lifter.join();
+
+    EXPECT_TRUE( sent );
+    EXPECT_LT( seconds, 0.5 );
+}
+
+TEST_F( BandwidthLimiterTest, expectInterruptStopsThrottling )
+{
+    instance->setLimits( 256 * 1024, 0 );
+
+    std::atomic<bool> stopped( false );
+    std::thread stopper( [this, &stopped]()
+        {
+            std::this_thread::sleep_for( std::chrono::milliseconds( 200 ) );
+            stopped = true;
+            instance->interrupt();
+        } );
+
+    auto start = std::chrono::steady_clock::now();
+    bool sent = instance->throttle( nullptr, 4 * 1024 * 1024 + 64 * 1024,
+        [&stopped]() { return stopped.load(); } );
+    double seconds = Seconds( std::chrono::steady_clock::now() - start );
+    stopper.join();
+
+    EXPECT_FALSE( sent );
+    EXPECT_LT( seconds, 0.5 );
+}
+
+TEST_F( BandwidthLimiterTest, expectReleasedRemoteBucketIsDropped )
+{
+    instance->setLimits( 0, 1024 * 1024 );
+
+    std::shared_ptr<TokenBucket> remote = instance->getRemoteBucket( "a" );
+    remote->reserve( 4 * 1024 * 1024 );
+
+    // Another stream of the same remote shares the debt
+    EXPECT_GT( Seconds( instance->getRemoteBucket( "a" )->reserve( 1024 ) ),
+        2.0 );
+
+    remote = nullptr;
+
+    // The last stream is gone, a new one starts with a clean budget
+    EXPECT_EQ( instance->getRemoteBucket( "a" )->reserve( 1024 ).count(), 0 );
+}
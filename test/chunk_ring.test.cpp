@@ -0,0 +1,277 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <zlib.h>
+
+#include "../src/service/chunk_ring.cpp"
+
+using namespace srv;
+
+class ChunkRingTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        instance = std::make_shared<ChunkRing>( 4, 64 );
+    }
+
+    void TearDown() override
+    {
+        instance = nullptr;
+    }
+
+    // Every chunk differs, and some compress much slower than others
+    static std::string ChunkContents( int index, size_t capacity )
+    {
+        std::mt19937 eng( index );
+        size_t length = capacity / 4 + eng() % ( capacity * 3 / 4 );
+        std::string data( length, '\0' );
+
+        for ( size_t i = 0; i < length; i++ )
+        {
+            data[i] = index % 3 == 0 ? (char)eng() : (char)( 'a' + i % 7 );
+        }
+
+        return data;
+    }
+
+    std::shared_ptr<ChunkRing> instance;
+};
+
+TEST_F( ChunkRingTest, expectChunksAreConsumedInOrder )
+{
+    const int count = 10000;
+
+    std::thread producer( [this, count]()
+        {
+            for ( int i = 0; i < count; i++ )
+            {
+                ChunkSlot* slot = instance->acquireFree();
+                slot->entry = i;
+                slot->length = i % 64;
+                instance->publish( slot );
+            }
+
+            instance->close();
+        } );
+
+    int expected = 0;
+    ChunkSlot* slot;
+    while ( ( slot = instance->acquireFilled() ) != nullptr )
+    {
+        EXPECT_EQ( slot->entry, expected );
+        EXPECT_EQ( slot->length, expected % 64 );
+        expected++;
+
+        instance->release( slot );
+    }
+
+    producer.join();
+
+    EXPECT_EQ( expected, count );
+}
+
+TEST_F( ChunkRingTest, expectCompressedChunksKeepOrderWithManyWorkers )
+{
+    const int count = 300;
+    const size_t chunkSize = 32 * 1024;
+    instance = std::make_shared<ChunkRing>( 8, chunkSize, true );
+
+    std::thread producer( [this, count, chunkSize]()
+        {
+            for ( int i = 0; i < count; i++ )
+            {
+                ChunkSlot* slot = instance->acquireFree();
+                std::string data = ChunkContents( i, chunkSize );
+
+                data.copy( &slot->data[0], data.size() );
+                slot->entry = i;
+                slot->length = data.size();
+                instance->publish( slot );
+            }
+
+            instance->close();
+        } );
+
+    // Like FileSender's compressor threads: each deflates into the
+    // slot's own buffer, at a level that depends on the chunk
+    std::vector<std::thread> workers;
+    for ( int i = 0; i < 4; i++ )
+    {
+        workers.emplace_back( [this]()
+            {
+                ChunkSlot* slot;
+                while ( ( slot = instance->acquireForProcessing() ) != nullptr )
+                {
+                    uLongf length = compressBound( slot->length );
+                    slot->compressed.resize( length );
+                    compress2( (Bytef*)&slot->compressed[0], &length,
+                        (const Bytef*)slot->data.data(), slot->length,
+                        slot->entry % 9 + 1 );
+                    slot->compressed.resize( length );
+
+                    instance->markProcessed( slot );
+                }
+            } );
+    }
+
+    int expected = 0;
+    ChunkSlot* slot;
+    std::string inflated( chunkSize, '\0' );
+    while ( ( slot = instance->acquireFilled() ) != nullptr )
+    {
+        ASSERT_EQ( slot->entry, expected );
+
+        uLongf length = inflated.size();
+        ASSERT_EQ( uncompress( (Bytef*)&inflated[0], &length,
+                       (const Bytef*)slot->compressed.data(),
+                       slot->compressed.size() ),
+            Z_OK );
+        EXPECT_EQ( inflated.substr( 0, length ),
+            ChunkContents( expected, chunkSize ) );
+        expected++;
+
+        instance->release( slot );
+    }
+
+    producer.join();
+    for ( std::thread& worker : workers )
+    {
+        worker.join();
+    }
+
+    EXPECT_EQ( expected, count );
+}
+
+TEST_F( ChunkRingTest, expectSlowWorkerHoldsBackLaterChunks )
+{
+    instance = std::make_shared<ChunkRing>( 4, 64, true );
+
+    for ( int i = 0; i < 4; i++ )
+    {
+        ChunkSlot* slot = instance->acquireFree();
+        slot->entry = i;
+        instance->publish( slot );
+    }
+
+    ChunkSlot* first = instance->acquireForProcessing();
+    ASSERT_EQ( first->entry, 0 );
+
+    // The others finish before the first one does
+    for ( int i = 1; i < 4; i++ )
+    {
+        instance->markProcessed( instance->acquireForProcessing() );
+    }
+
+    std::atomic<int> received( -1 );
+    std::thread consumer( [this, &received]()
+        {
+            ChunkSlot* slot = instance->acquireFilled();
+            received = slot ? slot->entry : -2;
+            instance->release( slot );
+        } );
+
+    std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+    EXPECT_EQ( received, -1 );
+
+    instance->markProcessed( first );
+    consumer.join();
+    EXPECT_EQ( received, 0 );
+
+    for ( int i = 1; i < 4; i++ )
+    {
+        ChunkSlot* slot = instance->acquireFilled();
+        ASSERT_NE( slot, nullptr );
+        EXPECT_EQ( slot->entry, i );
+        instance->release( slot );
+    }
+}
+
+TEST_F( ChunkRingTest, expectAbortStopsEveryStage )
+{
+    instance = std::make_shared<ChunkRing>( 4, 64, true );
+    std::atomic<int> produced( 0 );
+    std::atomic<int> stopped( 0 );
+
+    // Consumer gives up halfway, like a writer whose stream broke.
+    // Producer and workers are blocked on the ring at that point.
+    std::thread producer( [this, &produced, &stopped]()
+        {
+            ChunkSlot* slot;
+            while ( ( slot = instance->acquireFree() ) != nullptr )
+            {
+                slot->entry = produced++;
+                instance->publish( slot );
+            }
+
+            stopped++;
+        } );
+
+    std::vector<std::thread> workers;
+    for ( int i = 0; i < 3; i++ )
+    {
+        workers.emplace_back( [this, &stopped]()
+            {
+                ChunkSlot* slot;
+                while ( ( slot = instance->acquireForProcessing() ) != nullptr )
+                {
+                    instance->markProcessed( slot );
+                }
+
+                stopped++;
+            } );
+    }
+
+    for ( int i = 0; i < 10; i++ )
+    {
+        ChunkSlot* slot = instance->acquireFilled();
+        ASSERT_NE( slot, nullptr );
+        EXPECT_EQ( slot->entry, i );
+        instance->release( slot );
+    }
+
+    std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+    instance->abort();
+
+    producer.join();
+    for ( std::thread& worker : workers )
+    {
+        worker.join();
+    }
+
+    EXPECT_EQ( stopped, 4 );
+    EXPECT_LE( produced, 10 + instance->getDepth() );
+    EXPECT_EQ( instance->acquireFilled(), nullptr );
+    EXPECT_EQ( instance->acquireFree(), nullptr );
+}
+
+TEST_F( ChunkRingTest, expectFullSlotsAreLentNotCopied )
+{
+    ChunkSlot* slot = instance->acquireFree();
+    ASSERT_NE( slot, nullptr );
+
+    std::string message;
+    slot->data.assign( 64, 'x' );
+    slot->length = 64;
+    const char* buffer = slot->data.data();
+
+    std::string* lent = slot->lendPayload( false, message );
+    EXPECT_EQ( message.data(), buffer );
+
+    slot->reclaimPayload( lent, message );
+    EXPECT_EQ( slot->data.data(), buffer );
+    EXPECT_EQ( slot->data.size(), 64u );
+
+    // A tail is copied, the slot keeps its buffer
+    slot->length = 10;
+    lent = slot->lendPayload( false, message );
+    EXPECT_EQ( lent, nullptr );
+    EXPECT_EQ( message, std::string( 10, 'x' ) );
+    EXPECT_EQ( slot->data.data(), buffer );
+}
@@ -0,0 +1,194 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/service/compression_controller.cpp"
+
+using namespace srv;
+
+class CompressionControllerTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        instance = std::make_shared<CompressionController>( 6, 2 );
+        badLevels = 0;
+    }
+
+    void TearDown() override
+    {
+        instance = nullptr;
+    }
+
+    std::string RandomBytes( size_t length )
+    {
+        std::mt19937 gen( 1234 );
+        std::uniform_int_distribution<int> dist( 0, 255 );
+
+        std::string bytes( length, '\0' );
+        for ( char& c : bytes )
+        {
+            c = (char)dist( gen );
+        }
+
+        return bytes;
+    }
+
+    std::string RepeatedText( size_t length )
+    {
+        std::string text;
+        while ( text.size() < length )
+        {
+            text += "a rose by any other name would smell as sweet. ";
+        }
+
+        return text;
+    }
+
+    // Compressor workers taking chunks of random and text data in turns,
+    // reporting the given speed for whatever they compressed. Each runs
+    // until done returns true, counts levels outside of the allowed range.
+    template <typename Done>
+    void RunWorkers( int count, double secondsPerChunk, Done done )
+    {
+        const size_t chunkSize = 64 * 1024;
+        std::string random = RandomBytes( chunkSize );
+        std::string text = RepeatedText( chunkSize );
+        std::vector<std::thread> workers;
+
+        for ( int i = 0; i < count; i++ )
+        {
+            workers.emplace_back( [&, i]()
+                {
+                    for ( int n = i; !done(); n++ )
+                    {
+                        const std::string& chunk = n % 3 == 0 ? random : text;
+                        int level = instance->chooseLevel( chunk.data(),
+                            chunk.size() );
+
+                        if ( level < 0 || level > instance->getMaxLevel()
+                            || ( &chunk == &random && level != 0 ) )
+                        {
+                            badLevels++;
+                        }
+
+                        if ( level > 0 )
+                        {
+                            instance->reportCompressed( chunk.size(),
+                                chunk.size() * 2 / 5, secondsPerChunk );
+                        }
+
+                        std::this_thread::yield();
+                    }
+                } );
+        }
+
+        for ( std::thread& worker : workers )
+        {
+            worker.join();
+        }
+    }
+
+    std::shared_ptr<CompressionController> instance;
+    std::atomic<int> badLevels;
+};
+
+TEST_F( CompressionControllerTest, expectRandomDataIsStored )
+{
+    std::string data = RandomBytes( 1024 * 1024 );
+
+    EXPECT_GT( CompressionController::estimateEntropy( data.data(), data.size() ), 7.5 );
+    EXPECT_EQ( instance->chooseLevel( data.data(), data.size() ), 0 );
+
+    // Too short to judge, compressed like anything else
+    EXPECT_EQ( instance->chooseLevel( data.data(), 100 ), 6 );
+}
+
+TEST_F( CompressionControllerTest, expectLevelFollowsLinkWithConcurrentWorkers )
+{
+    instance = std::make_shared<CompressionController>( 6, 4 );
+    std::atomic<bool> slowLink( false );
+    std::atomic<bool> stop( false );
+
+    // Writer reports the link while the workers compress. It starts
+    // at 1 GB/s and drops to 1 MB/s once the level has reached 0.
+    std::thread writer( [&]()
+        {
+            while ( !stop )
+            {
+                if ( slowLink )
+                {
+                    instance->reportSent( 26214, 0.025 );
+                }
+                else
+                {
+                    instance->reportSent( 26214, 0.000025 );
+                }
+
+                std::this_thread::sleep_for( std::chrono::microseconds( 50 ) );
+            }
+        } );
+
+    // 64 kB in 3 ms is about 20 MB/s per worker
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds( 10 );
+    RunWorkers( 4, 0.003, [&]()
+        {
+            return instance->getCurrentLevel() == 0
+                || std::chrono::steady_clock::now() > deadline;
+        } );
+    EXPECT_EQ( instance->getCurrentLevel(), 0 );
+
+    slowLink = true;
+    RunWorkers( 4, 0.003, [&]()
+        {
+            return instance->getCurrentLevel() == 6
+                || std::chrono::steady_clock::now() > deadline;
+        } );
+    EXPECT_EQ( instance->getCurrentLevel(), 6 );
+
+    stop = true;
+    writer.join();
+
+    EXPECT_EQ( badLevels, 0 );
+}
+
+TEST_F( CompressionControllerTest, expectMoreWorkersKeepLevelUp )
+{
+    // 20 MB/s per worker against a 60 MB/s link: one worker can't keep
+    // up with it, four together can
+    for ( int workers : { 1, 4 } )
+    {
+        instance = std::make_shared<CompressionController>( 6, workers );
+
+        for ( int i = 0; i < 100; i++ )
+        {
+            instance->reportCompressed( 1000000, 400000, 0.05 );
+            instance->reportSent( 400000, 0.4 / 60 );
+        }
+
+        EXPECT_EQ( instance->getCurrentLevel(), workers == 1 ? 0 : 6 )
+            << workers << " workers";
+    }
+}
+
+TEST_F( CompressionControllerTest, expectBogusReportsKeepLevelInRange )
+{
+    // Empty chunks, zero or negative timings from a clock that jumped
+    for ( int i = 0; i < 100; i++ )
+    {
+        instance->reportCompressed( 0, 0, 0.0 );
+        instance->reportCompressed( 1000000, 2000000, 0.0 );
+        instance->reportCompressed( 1000000, 0, -1.0 );
+        instance->reportSent( 0, 0.0 );
+        instance->reportSent( 400000, -0.5 );
+
+        int level = instance->getCurrentLevel();
+        ASSERT_GE( level, 0 );
+        ASSERT_LE( level, instance->getMaxLevel() );
+    }
+}
@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/service/crc32c.cpp"
+
+using namespace srv;
+
+class Crc32cTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        instance = std::make_shared<Crc32c>();
+    }
+
+    void TearDown() override
+    {
+        instance = nullptr;
+    }
+
+    std::string RandomData( size_t length )
+    {
+        std::mt19937 eng( 1234 );
+        std::uniform_int_distribution<int> charDist( 0, 255 );
+
+        std::string data( length, '\0' );
+        for ( char& ch : data )
+        {
+            ch = (char)charDist( eng );
+        }
+
+        return data;
+    }
+
+    std::shared_ptr<Crc32c> instance;
+};
+
+TEST_F( Crc32cTest, expectKnownCheckValues )
+{
+    EXPECT_EQ( Crc32c::compute( "", 0 ), 0u );
+    EXPECT_EQ( Crc32c::compute( "123456789", 9 ), 0xE3069283u );
+
+    std::string zeros( 32, '\0' );
+    EXPECT_EQ( Crc32c::compute( zeros.data(), zeros.size() ), 0x8A9136AAu );
+
+    std::string ones( 32, '\xFF' );
+    EXPECT_EQ( Crc32c::compute( ones.data(), ones.size() ), 0x62A8AB43u );
+}
+
+TEST_F( Crc32cTest, expectRandomSplitsMatchOneShot )
+{
+    std::string data = RandomData( 200000 );
+    std::mt19937 eng( 99 );
+
+    // Chunks from the network come in any size, at any alignment
+    for ( int round = 0; round < 200; round++ )
+    {
+        size_t start = eng() % 16;
+        size_t end = data.size() - eng() % 16;
+        uint32_t whole = Crc32c::compute( data.data() + start, end - start );
+
+        instance->reset();
+        for ( size_t pos = start; pos < end; )
+        {
+            size_t length = std::min( (size_t)( eng() % ( round < 100 ? 64 : 70000 ) ),
+                end - pos );
+            instance->update( data.data() + pos, length );
+            pos += length;
+        }
+
+        ASSERT_EQ( instance->getValue(), whole ) << "Round " << round;
+    }
+}
+
+TEST_F( Crc32cTest, expectConcurrentStreamsDoNotInterfere )
+{
+    const int streamCount = 8;
+    std::vector<std::string> files;
+    std::vector<uint32_t> expected;
+
+    for ( int i = 0; i < streamCount; i++ )
+    {
+        files.push_back( RandomData( 300000 + i * 1001 ) );
+        files.back()[i] ^= (char)i;
+        expected.push_back( Crc32c::compute( files.back().data(),
+            files.back().size() ) );
+    }
+
+    // Like several receiving streams checksumming files at once
+    std::vector<uint32_t> results( streamCount );
+    std::vector<std::thread> streams;
+
+    for ( int i = 0; i < streamCount; i++ )
+    {
+        streams.emplace_back( [&files, &results, i]()
+            {
+                std::mt19937 eng( i );
+                Crc32c crc;
+
+                for ( int repeat = 0; repeat < 20; repeat++ )
+                {
+                    crc.reset();
+                    for ( size_t pos = 0; pos < files[i].size(); )
+                    {
+                        size_t length = std::min( (size_t)( eng() % 9000 ),
+                            files[i].size() - pos );
+                        crc.update( files[i].data() + pos, length );
+                        pos += length;
+                    }
+                }
+
+                results[i] = crc.getValue();
+            } );
+    }
+
+    for ( std::thread& stream : streams )
+    {
+        stream.join();
+    }
+
+    EXPECT_EQ( results, expected );
+}
+
+TEST_F( Crc32cTest, expectCorruptChunksAreDetected )
+{
+    std::string data = RandomData( 1024 );
+    uint32_t original = Crc32c::compute( data.data(), data.size() );
+
+    // Every single bit flip, and every burst of up to 32 bits
+    for ( size_t bit = 0; bit < data.size() * 8; bit++ )
+    {
+        std::string corrupt = data;
+        corrupt[bit / 8] ^= (char)( 1 << ( bit % 8 ) );
+        ASSERT_NE( Crc32c::compute( corrupt.data(), corrupt.size() ), original )
+            << "Bit " << bit;
+
+        for ( int burst = 2; burst <= 32 && bit + burst <= data.size() * 8;
+              burst += 5 )
+        {
+            size_t last = bit + burst - 1;
+            corrupt[last / 8] ^= (char)( 1 << ( last % 8 ) );
+            ASSERT_NE( Crc32c::compute( corrupt.data(), corrupt.size() ),
+                original )
+                << "Burst of " << burst << " at bit " << bit;
+            corrupt[last / 8] ^= (char)( 1 << ( last % 8 ) );
+        }
+    }
+
+    // Chunks that arrived in the wrong order, or cut short and padded
+    std::string swapped = data.substr( 512 ) + data.substr( 0, 512 );
+    EXPECT_NE( Crc32c::compute( swapped.data(), swapped.size() ), original );
+
+    std::string padded = data.substr( 0, 1000 ) + std::string( 24, '\0' );
+    EXPECT_NE( Crc32c::compute( padded.data(), padded.size() ), original );
+
+    instance->update( data.data(), 1000 );
+    EXPECT_NE( instance->getValue(), original );
+}
+
+TEST_F( Crc32cTest, reportThroughput )
+{
+    // Not a pass/fail criterion, just a number to compare against
+    // the transfer speeds it has to keep up with
+    std::string data = RandomData( 64 * 1024 * 1024 );
+
+    auto start = std::chrono::steady_clock::now();
+    instance->update( data.data(), data.size() );
+    std::chrono::duration<double> elapsed
+        = std::chrono::steady_clock::now() - start;
+
+    double mbPerSecond = data.size() / ( 1024.0 * 1024.0 ) / elapsed.count();
+    RecordProperty( "MBPerSecond", (int)mbPerSecond );
+    std::cout << "[          ] CRC32C: " << (int)mbPerSecond << " MB/s"
+              << std::endl;
+
+    EXPECT_NE( instance->getValue(), 0u );
+}
@@ -0,0 +1,282 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../src/service/resume_point.cpp"
+
+using namespace srv;
+
+class ResumePointTest : public ::testing::Test
+{
+protected:
+    // What the receiver's journal says about an element
+    struct Journaled
+    {
+        int entry;
+        long long bytes;
+        bool complete;
+    };
+
+    void SetUp() override
+    {
+        instance = std::make_shared<ResumePoint>();
+
+        manifest = {
+            { L"dir", FileType::DIRECTORY, 0, 1000, PermissionClass::DIRECTORY },
+            { L"dir\\a.txt", FileType::REGULAR_FILE, 1234, 1001,
+                PermissionClass::REGULAR },
+            { L"dir\\empty", FileType::REGULAR_FILE, 0, 1002,
+                PermissionClass::REGULAR },
+            { L"b.bin", FileType::REGULAR_FILE, 40000, 1003,
+                PermissionClass::REGULAR }
+        };
+
+        disk.assign( manifest.size(), std::string() );
+        onDisk.assign( manifest.size(), false );
+        journal.clear();
+    }
+
+    void TearDown() override
+    {
+        instance = nullptr;
+    }
+
+    std::string Contents( int entry ) const
+    {
+        std::string data( (size_t)manifest[entry].size, '\0' );
+        for ( size_t i = 0; i < data.size(); i++ )
+        {
+            data[i] = (char)( entry * 31 + i * 7 );
+        }
+
+        return data;
+    }
+
+    long long TotalSize() const
+    {
+        long long total = 0;
+        for ( const ManifestEntry& element : manifest )
+        {
+            total += element.size;
+        }
+
+        return total;
+    }
+
+    // Sends what the sender's resume point is missing, in chunks and
+    // entry by entry like FileSender does, until the connection drops
+    // after dropAfter bytes. Returns the payload bytes sent.
+    long long Transfer( const ResumePoint& point, long long dropAfter )
+    {
+        long long sent = 0;
+
+        for ( int entry = 0; entry < (int)manifest.size(); entry++ )
+        {
+            if ( point.isCompleted( entry ) )
+            {
+                continue;
+            }
+
+            const ManifestEntry& element = manifest[entry];
+            long long offset = std::min( point.getStartOffset( entry ),
+                element.size );
+            std::string data = Contents( entry );
+
+            // Receiver seeks to where the sender continues
+            onDisk[entry] = true;
+            disk[entry].resize( (size_t)offset );
+
+            while ( offset < element.size )
+            {
+                if ( sent == dropAfter )
+                {
+                    // Last checkpoint lags behind what's on disk
+                    journal.push_back( { entry, offset - offset % CHECKPOINT,
+                        false } );
+                    return sent;
+                }
+
+                long long length = std::min( { CHUNK, element.size - offset,
+                    dropAfter - sent } );
+                disk[entry].append( data, (size_t)offset, (size_t)length );
+                offset += length;
+                sent += length;
+            }
+
+            journal.push_back( { entry, element.size, true } );
+        }
+
+        return sent;
+    }
+
+    // Receiver's side, the way TransferManager::loadResumePoint reads
+    // its journal back, checked against what's on disk
+    ResumePoint LoadFromJournal() const
+    {
+        ResumePoint point;
+        int partialEntry = -1;
+        long long partialOffset = 0;
+
+        for ( const Journaled& record : journal )
+        {
+            long long size = onDisk[record.entry]
+                ? (long long)disk[record.entry].size()
+                : -1;
+
+            if ( record.complete && size == record.bytes )
+            {
+                point.markCompleted( record.entry );
+            }
+            else if ( !record.complete && size >= record.bytes
+                && record.bytes > partialOffset )
+            {
+                partialEntry = record.entry;
+                partialOffset = record.bytes;
+            }
+        }
+
+        point.setPartial( partialEntry, partialOffset );
+        return point;
+    }
+
+    // Sender only learns the resume point through the wire
+    static ResumePoint SendOver( const ResumePoint& point )
+    {
+        ResumePoint received;
+        received.setBitmap( point.getBitmap() );
+        received.setPartial( point.getPartialEntry(), point.getPartialOffset() );
+
+        return received;
+    }
+
+    void ExpectAllReceived()
+    {
+        for ( int entry = 0; entry < (int)manifest.size(); entry++ )
+        {
+            EXPECT_TRUE( onDisk[entry] ) << "Entry " << entry;
+            EXPECT_EQ( disk[entry], Contents( entry ) ) << "Entry " << entry;
+        }
+    }
+
+    static const long long CHUNK = 4096;
+    static const long long CHECKPOINT = 3 * 1024;
+
+    std::shared_ptr<ResumePoint> instance;
+    TransferManifest manifest;
+    std::vector<std::string> disk;
+    std::vector<bool> onDisk;
+    std::vector<Journaled> journal;
+};
+
+const long long ResumePointTest::CHUNK;
+const long long ResumePointTest::CHECKPOINT;
+
+TEST_F( ResumePointTest, expectBitmapSurvivesWireRoundTrip )
+{
+    instance->markCompleted( 0 );
+    instance->markCompleted( 9 );
+    instance->markCompleted( 17 );
+
+    ResumePoint copy;
+    copy.setBitmap( instance->getBitmap() );
+
+    for ( int i = 0; i < 24; i++ )
+    {
+        EXPECT_EQ( copy.isCompleted( i ), i == 0 || i == 9 || i == 17 )
+            << "Entry " << i;
+    }
+
+    EXPECT_FALSE( copy.isEmpty() );
+    EXPECT_FALSE( copy.isCompleted( 1000 ) );
+    EXPECT_FALSE( copy.isCompleted( -1 ) );
+}
+
+TEST_F( ResumePointTest, expectResumeAfterMidFileDropCompletesTransfer )
+{
+    const long long total = TotalSize();
+
+    // Drop at every chunk boundary and a few bytes around each
+    for ( long long drop = 0; drop < total; drop += CHUNK / 2 - 1 )
+    {
+        SetUp();
+
+        ASSERT_EQ( Transfer( ResumePoint(), drop ), drop );
+
+        ResumePoint resume = SendOver( LoadFromJournal() );
+        long long skipped = 0;
+        for ( int entry = 0; entry < (int)manifest.size(); entry++ )
+        {
+            skipped += resume.isCompleted( entry )
+                ? manifest[entry].size
+                : resume.getStartOffset( entry );
+        }
+
+        // Never more than what made it across, never a byte too many
+        EXPECT_LE( skipped, drop ) << "Dropped at " << drop;
+        EXPECT_GT( skipped + CHECKPOINT + CHUNK, drop ) << "Dropped at " << drop;
+
+        EXPECT_EQ( Transfer( resume, total ), total - skipped )
+            << "Dropped at " << drop;
+        ExpectAllReceived();
+    }
+}
+
+TEST_F( ResumePointTest, expectRepeatedDropsStillComplete )
+{
+    const long long total = TotalSize();
+    long long received = Transfer( ResumePoint(), 5000 );
+
+    // Each attempt makes a little progress before it breaks again
+    for ( int attempt = 0; attempt < 100 && received < total; attempt++ )
+    {
+        ResumePoint resume = SendOver( LoadFromJournal() );
+        Transfer( resume, 5000 );
+
+        received = 0;
+        for ( int entry = 0; entry < (int)manifest.size(); entry++ )
+        {
+            received += onDisk[entry] ? (long long)disk[entry].size() : 0;
+        }
+    }
+
+    Transfer( SendOver( LoadFromJournal() ), total );
+    ExpectAllReceived();
+}
+
+TEST_F( ResumePointTest, expectChangedPartialFileIsReceivedAgain )
+{
+    Transfer( ResumePoint(), 1234 + 20000 );
+
+    // Partial file was truncated behind our back, completed one removed
+    disk[3].resize( 100 );
+    onDisk[1] = false;
+    disk[1].clear();
+
+    ResumePoint resume = SendOver( LoadFromJournal() );
+
+    EXPECT_TRUE( resume.isCompleted( 0 ) );
+    EXPECT_FALSE( resume.isCompleted( 1 ) );
+    EXPECT_TRUE( resume.isCompleted( 2 ) );
+    EXPECT_EQ( resume.getPartialEntry(), -1 );
+    EXPECT_EQ( resume.getStartOffset( 3 ), 0 );
+
+    EXPECT_EQ( Transfer( resume, TotalSize() ), 1234 + 40000 );
+    ExpectAllReceived();
+}
+
+TEST_F( ResumePointTest, expectManifestHashFollowsContents )
+{
+    uint64_t hash = ResumePoint::hashManifest( manifest );
+
+    EXPECT_NE( hash, 0u );
+    EXPECT_EQ( hash, ResumePoint::hashManifest( manifest ) );
+
+    manifest[3].mtime++;
+    EXPECT_NE( hash, ResumePoint::hashManifest( manifest ) );
+
+    manifest[3].mtime--;
+    manifest[1].size++;
+    EXPECT_NE( hash, ResumePoint::hashManifest( manifest ) );
+}
@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+#include <string>
+
+#include "../src/service/solid_archive.cpp"
+
+using namespace srv;
+
+class SolidArchiveTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        instance = std::make_shared<SolidArchiveWriter>();
+        buffer.assign( 256, '\0' );
+        instance->reset( &buffer[0], buffer.size() );
+    }
+
+    void TearDown() override
+    {
+        instance = nullptr;
+    }
+
+    void AddFile( int entry, const std::string& path, const std::string& data,
+        int mode )
+    {
+        char* dest = instance->beginRecord( entry, FileType::REGULAR_FILE,
+            path );
+        data.copy( dest, data.size() );
+        instance->endRecord( mode, data.size(), true, 0xCAFEF00D );
+    }
+
+    std::shared_ptr<SolidArchiveWriter> instance;
+    std::string buffer;
+};
+
+TEST_F( SolidArchiveTest, expectRecordsSurviveRoundTrip )
+{
+    char* dest = instance->beginRecord( 3, FileType::DIRECTORY, "lib" );
+    EXPECT_NE( dest, nullptr );
+    instance->endRecord( 0755, 0, false, 0 );
+
+    AddFile( 4, "lib/index.js", "module.exports = 42;\n", 0644 );
+    AddFile( 5, "lib/empty", "", 0600 );
+
+    SolidArchiveReader reader( buffer.data(), instance->getSize() );
+    PackedRecord record;
+
+    ASSERT_TRUE( reader.next( record ) );
+    EXPECT_EQ( record.entry, 3 );
+    EXPECT_EQ( record.type, FileType::DIRECTORY );
+    EXPECT_EQ( record.fileMode, 0755 );
+    EXPECT_FALSE( record.hasChecksum );
+    EXPECT_EQ( record.relativePath, "lib" );
+    EXPECT_EQ( record.length, 0u );
+
+    ASSERT_TRUE( reader.next( record ) );
+    EXPECT_EQ( record.entry, 4 );
+    EXPECT_EQ( record.type, FileType::REGULAR_FILE );
+    EXPECT_EQ( record.fileMode, 0644 );
+    EXPECT_TRUE( record.hasChecksum );
+    EXPECT_EQ( record.checksum, 0xCAFEF00Du );
+    EXPECT_EQ( record.relativePath, "lib/index.js" );
+    EXPECT_EQ( std::string( record.data, record.length ),
+        "module.exports = 42;\n" );
+
+    ASSERT_TRUE( reader.next( record ) );
+    EXPECT_EQ( record.relativePath, "lib/empty" );
+    EXPECT_EQ( record.length, 0u );
+
+    EXPECT_FALSE( reader.next( record ) );
+    EXPECT_TRUE( reader.isValid() );
+}
+
+TEST_F( SolidArchiveTest, expectUnfinishedRecordIsNotPacked )
+{
+    AddFile( 0, "a.txt", "aaaa", 0644 );
+    size_t size = instance->getSize();
+
+    // A file that failed to read is never ended
+    instance->beginRecord( 1, FileType::REGULAR_FILE, "b.txt" );
+    EXPECT_EQ( instance->getSize(), size );
+
+    AddFile( 2, "c.txt", "cc", 0644 );
+
+    SolidArchiveReader reader( buffer.data(), instance->getSize() );
+    PackedRecord record;
+
+    ASSERT_TRUE( reader.next( record ) );
+    EXPECT_EQ( record.relativePath, "a.txt" );
+    ASSERT_TRUE( reader.next( record ) );
+    EXPECT_EQ( record.relativePath, "c.txt" );
+    EXPECT_FALSE( reader.next( record ) );
+}
+
+TEST_F( SolidArchiveTest, expectTruncatedBatchKeepsEarlierRecords )
+{
+    AddFile( 0, "a.txt", "some data", 0644 );
+    size_t firstEnd = instance->getSize();
+    AddFile( 1, "b.txt", "more data", 0644 );
+
+    PackedRecord record;
+
+    // Every cut that isn't on a record boundary leaves a malformed tail
+    for ( size_t cut = 1; cut < instance->getSize(); cut++ )
+    {
+        SolidArchiveReader reader( buffer.data(), cut );
+        bool gotFirst = reader.next( record );
+
+        EXPECT_EQ( gotFirst, cut >= firstEnd );
+        if ( gotFirst )
+        {
+            EXPECT_EQ( record.relativePath, "a.txt" );
+            EXPECT_EQ( std::string( record.data, record.length ), "some data" );
+        }
+
+        EXPECT_FALSE( reader.next( record ) );
+        EXPECT_EQ( reader.isValid(), cut == firstEnd );
+    }
+}
+
+TEST_F( SolidArchiveTest, expectCorruptLengthsAreRejected )
+{
+    AddFile( 0, "a.txt", "some data", 0644 );
+    size_t second = instance->getSize();
+    AddFile( 1, "b.txt", "more data", 0644 );
+
+    const size_t pathOffset = 14;
+    const size_t dataOffset = 18;
+    PackedRecord record;
+
+    // Lengths just past the end, up to ones whose sum with the offset
+    // would wrap around
+    for ( uint32_t length : { 10u, 0x10000u, 0x7FFFFFFFu, 0xFFFFFFF0u,
+              0xFFFFFFFFu } )
+    {
+        for ( size_t field : { pathOffset, dataOffset } )
+        {
+            std::string corrupt = buffer.substr( 0, instance->getSize() );
+            for ( int i = 0; i < 4; i++ )
+            {
+                corrupt[second + field + i] = (char)( length >> ( i * 8 ) );
+            }
+
+            SolidArchiveReader reader( corrupt.data(), corrupt.size() );
+
+            ASSERT_TRUE( reader.next( record ) );
+            EXPECT_EQ( record.relativePath, "a.txt" );
+            EXPECT_FALSE( reader.next( record ) );
+            EXPECT_FALSE( reader.isValid() );
+        }
+    }
+}
+
+TEST_F( SolidArchiveTest, expectGarbageIsNeverReadPastTheEnd )
+{
+    std::mt19937 eng( 7 );
+    PackedRecord record;
+
+    for ( int round = 0; round < 2000; round++ )
+    {
+        // Mostly small lengths, so some garbage parses for a while
+        std::string garbage( eng() % 200, '\0' );
+        for ( char& c : garbage )
+        {
+            c = (char)( eng() % 4 == 0 ? eng() : eng() % 8 );
+        }
+
+        SolidArchiveReader reader( garbage.data(), garbage.size() );
+        const char* end = garbage.data() + garbage.size();
+
+        while ( reader.next( record ) )
+        {
+            EXPECT_GE( record.data, garbage.data() );
+            EXPECT_LE( record.data + record.length, end );
+            EXPECT_LE( record.data - record.relativePath.size(), end );
+        }
+    }
+}
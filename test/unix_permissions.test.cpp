@@ -117,3 +117,11 @@ TEST_F( UnixPermissionsTest, expectElfHeaderDetectingWorks )
     data = '\x7f' + (std::string)"ELFsdfgkjhsdfhhfasduihuiasdhuiahsdfuifd";
     EXPECT_TRUE( UnixPermissions::checkElfHeader( data.data(), data.size() ) );
 }
+
+TEST_F( UnixPermissionsTest, expectScriptsHaveExecutableExtension )
+{
+    EXPECT_TRUE( UnixPermissions::hasExecutableExtension( L"tools\\build.sh" ) );
+    EXPECT_TRUE( UnixPermissions::hasExecutableExtension( L"main.py" ) );
+    EXPECT_FALSE( UnixPermissions::hasExecutableExtension( L"readme.txt" ) );
+    EXPECT_FALSE( UnixPermissions::hasExecutableExtension( L"h" ) );
+}
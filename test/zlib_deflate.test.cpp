@@ -1,4 +1,6 @@
 #include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
 #include <memory>
 #include <random>
 
@@ -29,6 +31,108 @@ protected:
         }
     }
 
+    // What every chunk used to cost: streams set up and torn down
+    // each time, output sized for the worst case and shrunk
+    static std::string LegacyCompress( const std::string& input, int level )
+    {
+        z_stream stream{};
+        deflateInit( &stream, level );
+
+        std::string output;
+        output.resize( deflateBound( &stream, input.size() ) );
+
+        stream.avail_in = input.size();
+        stream.next_in = (Bytef*)input.data();
+        stream.avail_out = output.size();
+        stream.next_out = (Bytef*)&output[0];
+
+        deflate( &stream, Z_FINISH );
+        output.resize( output.size() - stream.avail_out );
+        deflateEnd( &stream );
+
+        output.shrink_to_fit();
+        return output;
+    }
+
+    static std::string LegacyDecompress( const std::string& input,
+        size_t outputSize )
+    {
+        z_stream stream{};
+        inflateInit( &stream );
+
+        std::string output;
+        output.resize( outputSize );
+
+        stream.avail_in = input.size();
+        stream.next_in = (Bytef*)input.data();
+        stream.avail_out = output.size();
+        stream.next_out = (Bytef*)&output[0];
+
+        inflate( &stream, Z_FINISH );
+        output.resize( output.size() - stream.avail_out );
+        inflateEnd( &stream );
+
+        output.shrink_to_fit();
+        return output;
+    }
+
+    // Source files of a made up project: shared header, includes picked
+    // from a common set and bodies using per-file identifiers
+    static std::vector<std::string> SourceTree( int files )
+    {
+        std::mt19937 eng( 1234 );
+        std::uniform_int_distribution<int> nameDist( 0, 25 );
+        std::uniform_int_distribution<int> countDist( 2, 8 );
+        const char* includes[] = { "<memory>", "<string>", "<vector>",
+            "<mutex>", "<map>", "\"utils.hpp\"", "\"event.hpp\"",
+            "\"database_manager.hpp\"" };
+
+        std::vector<std::string> tree;
+
+        for ( int i = 0; i < files; i++ )
+        {
+            std::string name;
+            for ( int j = 0; j < 8; j++ )
+            {
+                name += (char)( 'a' + nameDist( eng ) );
+            }
+
+            std::string file = "// Copyright (c) The Example Project authors.\n"
+                               "// Licensed under the MIT license, see LICENSE.\n"
+                               "#pragma once\n";
+
+            int includeCount = countDist( eng );
+            for ( int j = 0; j < includeCount; j++ )
+            {
+                file += std::string( "#include " ) + includes[( i + j ) % 8] + "\n";
+            }
+
+            file += "\nnamespace srv\n{\n\nclass " + name + "\n{\npublic:\n";
+
+            int methodCount = countDist( eng );
+            for ( int j = 0; j < methodCount; j++ )
+            {
+                file += "    void set" + name + std::to_string( j )
+                    + "( const std::string& value );\n"
+                      "    std::string get"
+                    + name + std::to_string( j ) + "() const;\n";
+            }
+
+            file += "\nprivate:\n    std::mutex m_mtx;\n};\n\n};\n";
+            tree.push_back( file );
+        }
+
+        return tree;
+    }
+
+    static double MBPerSecond( size_t bytes,
+        std::chrono::steady_clock::time_point start )
+    {
+        std::chrono::duration<double> elapsed
+            = std::chrono::steady_clock::now() - start;
+        return bytes / ( 1024.0 * 1024.0 ) / elapsed.count();
+    }
+
     std::shared_ptr<ZlibDeflate> instance;
 };
 
@@ -88,3 +192,337 @@ TEST_F( ZlibDeflateTest, expectDeflateToBeReversible )
     }
 }
 
+
+TEST_F( ZlibDeflateTest, expectOutputBufferIsReused )
+{
+    std::string text = "a rose by any other name would smell as sweet.";
+    RepeatText( text, 20000 );
+
+    std::string output;
+    ASSERT_TRUE( instance->compress( text.data(), text.size(), output, 5 ) );
+    const char* buffer = output.data();
+
+    for ( int i = 0; i < 50; i++ )
+    {
+        size_t length = text.size() - i * 1000;
+        ASSERT_TRUE( instance->compress( text.data(), length, output, i % 9 + 1 ) );
+
+        // No reallocation means no copy of the compressed data either
+        EXPECT_EQ( output.data(), buffer );
+        EXPECT_EQ( instance->decompress( output ), text.substr( 0, length ) );
+    }
+}
+
+TEST_F( ZlibDeflateTest, expectDecompressionReusesOutputBuffer )
+{
+    std::string text = "the quick brown fox jumps over the lazy dog.";
+    RepeatText( text, 24000 ); // About 1 MB
+
+    std::string compressed = instance->compress( text, 6 );
+    std::string output;
+
+    // The first call sets up the inflate state and sizes the buffer
+    ASSERT_TRUE( instance->decompress( compressed.data(), compressed.size(),
+        output ) );
+    ASSERT_EQ( output, text );
+    const char* buffer = output.data();
+
+    // Allocations per GB are counted by chunk_bench
+    for ( int i = 0; i < 64; i++ )
+    {
+        ASSERT_TRUE( instance->decompress( compressed.data(),
+            compressed.size(), output ) );
+        EXPECT_EQ( output.data(), buffer );
+    }
+
+    EXPECT_EQ( output, text );
+}
+
+TEST_F( ZlibDeflateTest, expectCorruptChunkIsRejected )
+{
+    std::string text = "the quick brown fox jumps over the lazy dog.";
+    RepeatText( text, 1000 );
+
+    std::string compressed = instance->compress( text, 6 );
+    std::string output;
+
+    EXPECT_FALSE( instance->decompress( compressed.data(),
+        compressed.size() / 2, output ) );
+
+    compressed[compressed.size() / 2] ^= 0x5A;
+    compressed[compressed.size() / 2 + 1] ^= 0xA5;
+    EXPECT_FALSE( instance->decompress( compressed.data(),
+        compressed.size(), output ) );
+
+    // A failed chunk doesn't break the next one
+    compressed = instance->compress( text, 6 );
+    EXPECT_TRUE( instance->decompress( compressed.data(), compressed.size(),
+        output ) );
+    EXPECT_EQ( output, text );
+}
+
+TEST_F( ZlibDeflateTest, expectIncrementalStreamSurvivesAnySplit )
+{
+    std::mt19937 eng;
+    std::uniform_int_distribution<int> charDist( 'a', 'h' );
+    std::uniform_int_distribution<int> pieceDist( 1, 5000 );
+
+    std::string text( 200000, '\0' );
+    for ( char& ch : text )
+    {
+        ch = (char)charDist( eng );
+    }
+
+    std::string compressed;
+    ASSERT_TRUE( instance->beginDeflate( 6 ) );
+
+    for ( size_t pos = 0; pos < text.size(); )
+    {
+        size_t length = std::min( (size_t)pieceDist( eng ), text.size() - pos );
+        ZlibDeflate::Flush flush = pos % 3 == 0 ? ZlibDeflate::Flush::SYNC
+                                                : ZlibDeflate::Flush::NONE;
+
+        ASSERT_TRUE( instance->deflatePart( text.data() + pos, length,
+            compressed, flush ) );
+        pos += length;
+    }
+
+    ASSERT_TRUE( instance->deflatePart( nullptr, 0, compressed,
+        ZlibDeflate::Flush::FINISH ) );
+
+    // Inflated in pieces that have nothing to do with the ones deflated
+    std::string output;
+    bool finished = false;
+    ASSERT_TRUE( instance->beginInflate() );
+
+    for ( size_t pos = 0; pos < compressed.size(); )
+    {
+        size_t length = std::min( (size_t)pieceDist( eng ),
+            compressed.size() - pos );
+
+        ASSERT_TRUE( instance->inflatePart( compressed.data() + pos, length,
+            output, finished ) );
+        pos += length;
+    }
+
+    EXPECT_TRUE( finished );
+    EXPECT_EQ( output, text );
+}
+
+TEST_F( ZlibDeflateTest, expectSyncFlushMakesEverythingSoFarInflatable )
+{
+    std::string first = "a rose by any other name would smell as sweet.";
+    std::string second = "nothing is certain except for death and taxes.";
+    RepeatText( first, 100 );
+    RepeatText( second, 100 );
+
+    std::string compressed;
+    ASSERT_TRUE( instance->beginDeflate( 6 ) );
+    ASSERT_TRUE( instance->deflatePart( first.data(), first.size(),
+        compressed, ZlibDeflate::Flush::SYNC ) );
+
+    ZlibDeflate receiver;
+    std::string output;
+    bool finished = true;
+
+    ASSERT_TRUE( receiver.beginInflate() );
+    ASSERT_TRUE( receiver.inflatePart( compressed.data(), compressed.size(),
+        output, finished ) );
+    EXPECT_FALSE( finished );
+    EXPECT_EQ( output, first );
+
+    size_t sent = compressed.size();
+    ASSERT_TRUE( instance->deflatePart( second.data(), second.size(),
+        compressed, ZlibDeflate::Flush::FINISH ) );
+    ASSERT_TRUE( receiver.inflatePart( compressed.data() + sent,
+        compressed.size() - sent, output, finished ) );
+    EXPECT_TRUE( finished );
+    EXPECT_EQ( output, first + second );
+}
+
+TEST_F( ZlibDeflateTest, expectCompressionAtAnyLevelReusesOutputBuffer )
+{
+    std::string text = "the quick brown fox jumps over the lazy dog.";
+    RepeatText( text, 24000 ); // About 1 MB
+
+    std::string output;
+
+    // The first call sets up the deflate state and sizes the buffer
+    ASSERT_TRUE( instance->compress( text.data(), text.size(), output, 6 ) );
+    const char* buffer = output.data();
+
+    for ( int i = 0; i < 64; i++ )
+    {
+        // Level changes go through deflateParams, not a new stream
+        ASSERT_TRUE( instance->compress( text.data(), text.size(), output,
+            i % 9 + 1 ) );
+        EXPECT_EQ( output.data(), buffer );
+    }
+
+    EXPECT_EQ( instance->decompress( output ), text );
+}
+
+TEST_F( ZlibDeflateTest, reportThroughputAgainstPerChunkSetup )
+{
+    // Not a pass/fail criterion, the numbers show what reusing
+    // the streams buys at the chunk sizes transfers use
+    std::mt19937 eng;
+    std::uniform_int_distribution<int> wordDist( 0, 4 );
+    const char* words[] = { "rose ", "name ", "sweet ", "death ", "taxes " };
+
+    std::string corpus;
+    while ( corpus.size() < 16 * 1024 * 1024 )
+    {
+        corpus += words[wordDist( eng )];
+    }
+
+    for ( size_t chunkSize : { (size_t)64 * 1024, (size_t)1024 * 1024 } )
+    {
+        std::vector<std::string> chunks;
+        for ( size_t pos = 0; pos + chunkSize <= corpus.size(); pos += chunkSize )
+        {
+            chunks.push_back( corpus.substr( pos, chunkSize ) );
+        }
+
+        size_t total = chunks.size() * chunkSize;
+        std::vector<std::string> legacyCompressed;
+        std::string compressed;
+        std::string decompressed;
+
+        auto start = std::chrono::steady_clock::now();
+        for ( const std::string& chunk : chunks )
+        {
+            legacyCompressed.push_back( LegacyCompress( chunk, 6 ) );
+        }
+        double legacyDeflate = MBPerSecond( total, start );
+
+        start = std::chrono::steady_clock::now();
+        for ( const std::string& chunk : legacyCompressed )
+        {
+            LegacyDecompress( chunk, chunkSize );
+        }
+        double legacyInflate = MBPerSecond( total, start );
+
+        start = std::chrono::steady_clock::now();
+        for ( const std::string& chunk : chunks )
+        {
+            instance->compress( chunk.data(), chunk.size(), compressed, 6 );
+        }
+        double streamDeflate = MBPerSecond( total, start );
+
+        start = std::chrono::steady_clock::now();
+        for ( const std::string& chunk : legacyCompressed )
+        {
+            instance->decompress( chunk.data(), chunk.size(), decompressed );
+        }
+        double streamInflate = MBPerSecond( total, start );
+
+        std::cout << "[          ] " << chunkSize / 1024 << " kB chunks, MB/s:"
+                  << " deflate " << (int)legacyDeflate << " -> "
+                  << (int)streamDeflate << ", inflate " << (int)legacyInflate
+                  << " -> " << (int)streamInflate << std::endl;
+
+        // Same level, same data, so the output doesn't change either
+        EXPECT_EQ( compressed, legacyCompressed.back() );
+        EXPECT_EQ( decompressed, chunks.back() );
+    }
+}
+
+TEST_F( ZlibDeflateTest, expectPrimedChunkOnlyInflatesWithSameDictionary )
+{
+    std::string text = "the quick brown fox jumps over the lazy dog.\n";
+    RepeatText( text, 20 );
+
+    instance->setDictionary( "the quick brown fox jumps over the lazy dog.\n" );
+
+    std::string compressed;
+    ASSERT_TRUE( instance->compress( text.data(), text.size(), compressed,
+        6, true ) );
+
+    ZlibDeflate receiver;
+    std::string output;
+    EXPECT_FALSE( receiver.decompress( compressed.data(), compressed.size(),
+        output ) );
+
+    receiver.setDictionary( "a rose by any other name would smell as sweet." );
+    EXPECT_FALSE( receiver.decompress( compressed.data(), compressed.size(),
+        output ) );
+
+    receiver.setDictionary( "the quick brown fox jumps over the lazy dog.\n" );
+    ASSERT_TRUE( receiver.decompress( compressed.data(), compressed.size(),
+        output ) );
+    EXPECT_EQ( output, text );
+
+    // Chunks deflated without it are still fine
+    ASSERT_TRUE( instance->compress( text.data(), text.size(), compressed, 6 ) );
+    ASSERT_TRUE( receiver.decompress( compressed.data(), compressed.size(),
+        output ) );
+    EXPECT_EQ( output, text );
+}
+
+TEST_F( ZlibDeflateTest, expectDictionaryEndsWithSharedLines )
+{
+    std::vector<std::string> samples = SourceTree( 32 );
+    std::string dictionary = ZlibDeflate::buildDictionary( samples );
+
+    EXPECT_LE( dictionary.size(), ZlibDeflate::MAX_DICTIONARY_SIZE );
+    EXPECT_EQ( ZlibDeflate::buildDictionary( samples ), dictionary );
+
+    // Every file starts with the header, so it's the most valuable part
+    std::string header = "// Copyright (c) The Example Project authors.\n";
+    std::string license = "// Licensed under the MIT license, see LICENSE.\n";
+    std::string tail = dictionary.substr( dictionary.size() - 256 );
+
+    EXPECT_NE( tail.find( header ), std::string::npos );
+    EXPECT_NE( tail.find( license ), std::string::npos );
+}
+
+TEST_F( ZlibDeflateTest, reportDictionaryGainOnSourceTree )
+{
+    // Sender samples the first files of the op, the rest are
+    // compressed one by one like small files on the wire
+    std::vector<std::string> tree = SourceTree( 4000 );
+    std::vector<std::string> samples( tree.begin(), tree.begin() + 64 );
+    instance->setDictionary( ZlibDeflate::buildDictionary( samples ) );
+
+    ZlibDeflate receiver;
+    receiver.setDictionary( ZlibDeflate::buildDictionary( samples ) );
+
+    size_t total = 0;
+    size_t plainSize = 0;
+    size_t primedSize = 0;
+    std::string compressed;
+    std::string output;
+
+    auto start = std::chrono::steady_clock::now();
+    for ( const std::string& file : tree )
+    {
+        instance->compress( file.data(), file.size(), compressed, 6 );
+        plainSize += compressed.size();
+        total += file.size();
+    }
+    double plainSpeed = MBPerSecond( total, start );
+
+    start = std::chrono::steady_clock::now();
+    for ( const std::string& file : tree )
+    {
+        instance->compress( file.data(), file.size(), compressed, 6, true );
+        primedSize += compressed.size();
+    }
+    double primedSpeed = MBPerSecond( total, start );
+
+    for ( size_t i = 0; i < tree.size(); i += 97 )
+    {
+        instance->compress( tree[i].data(), tree[i].size(), compressed, 6, true );
+        ASSERT_TRUE( receiver.decompress( compressed.data(), compressed.size(),
+            output ) );
+        ASSERT_EQ( output, tree[i] );
+    }
+
+    std::cout << "[          ] " << tree.size() << " source files, ratio "
+              << (double)total / plainSize << " -> "
+              << (double)total / primedSize << ", MB/s " << (int)plainSpeed
+              << " -> " << (int)primedSpeed << std::endl;
+
+    EXPECT_LT( primedSize, plainSize );
+}